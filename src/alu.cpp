@@ -0,0 +1,23 @@
+#include "alu.h"
+
+using namespace emulator6502;
+
+AluTables::AluTables()
+{
+    for (u32 value = 0; value < 256; value++)
+    {
+        nz[value] = nz_flags(value);
+    }
+
+    for (u32 index = 0; index < ENTRIES; index++)
+    {
+        const bool carry = index >> 16;
+        const byte a = index >> 8;
+        const byte value = index;
+        adc[index] = adc_binary(a, value, carry);
+        adc_decimal[index] = emulator6502::adc_decimal(a, value, carry);
+        sbc_decimal[index] = emulator6502::sbc_decimal(a, value, carry);
+    }
+}
+
+const AluTables emulator6502::alu_tables;
@@ -0,0 +1,135 @@
+#ifndef _H_ALU
+#define _H_ALU
+
+#include "m6502.h"
+
+namespace emulator6502 {
+
+    // flag computation behind the CPU arithmetic, either looked up in the
+    // tables below (default) or computed per instruction when built with
+    // M6502_COMPUTED_FLAGS, the bench target of each can be compared
+
+    // ADC and SBC results are packed as the result in the low byte and its
+    // N, V, Z and C bits of PS in the high byte
+    constexpr byte ALU_FLAGS = FLAG_N | FLAG_V | FLAG_Z | FLAG_C;
+
+    constexpr byte nz_flags(byte value)
+    {
+        return (value & FLAG_N) | (value == 0 ? FLAG_Z : 0);
+    }
+
+    constexpr word pack_result(byte result, byte flags)
+    {
+        return result | (flags << 8);
+    }
+
+    // binary add with carry, SBC is an ADC of the complemented value
+    constexpr word adc_binary(byte a, byte value, bool carry)
+    {
+        const u32 sum = a + value + carry;
+        const byte result = sum;
+        const bool overflow = (a ^ result) & (value ^ result) & 0x80;
+        return pack_result(result, nz_flags(result)
+            | (overflow ? FLAG_V : 0) | (sum > 0xFF ? FLAG_C : 0));
+    }
+
+    // NMOS decimal add: Z comes from the binary sum, N and V from the sum
+    // after the low digit is adjusted, C from the decimal result
+    constexpr word adc_decimal(byte a, byte value, bool carry)
+    {
+        u32 low = (a & 0x0F) + (value & 0x0F) + carry;
+        if (low > 0x09) low += 0x06;
+        u32 sum = (a & 0xF0) + (value & 0xF0) + (low > 0x0F ? 0x10 : 0) + (low & 0x0F);
+
+        const bool zero = ((a + value + carry) & 0xFF) == 0;
+        const bool overflow = (a ^ sum) & ~(a ^ value) & 0x80;
+        const byte n = sum & FLAG_N;
+        if ((sum & 0x1F0) > 0x90) sum += 0x60;
+
+        return pack_result(sum, n | (zero ? FLAG_Z : 0)
+            | (overflow ? FLAG_V : 0) | ((sum & 0xFF0) > 0xF0 ? FLAG_C : 0));
+    }
+
+    // NMOS decimal subtract: every flag comes from the binary difference
+    constexpr word sbc_decimal(byte a, byte value, bool carry)
+    {
+        const byte flags = adc_binary(a, ~value, carry) >> 8;
+
+        u32 low = (a & 0x0F) - (value & 0x0F) - !carry;
+        u32 difference = (low & 0x10)
+            ? ((low - 0x06) & 0x0F) | ((a & 0xF0) - (value & 0xF0) - 0x10)
+            : (low & 0x0F) | ((a & 0xF0) - (value & 0xF0));
+        if (difference & 0x100) difference -= 0x60;
+
+        return pack_result(difference, flags);
+    }
+
+    /**
+     * Every result of the functions above, built once at startup. The
+     * arithmetic tables are indexed by carry << 16 | a << 8 | value.
+    */
+    struct AluTables
+    {
+        static constexpr u32 ENTRIES = 2 << 16;
+
+        byte nz[256];
+        word adc[ENTRIES];
+        word adc_decimal[ENTRIES];
+        word sbc_decimal[ENTRIES];
+
+        AluTables();
+    };
+
+    extern const AluTables alu_tables;
+
+    constexpr u32 alu_index(byte a, byte value, bool carry)
+    {
+        return (carry << 16) | (a << 8) | value;
+    }
+
+    inline byte alu_nz(byte value)
+    {
+    #if defined(M6502_COMPUTED_FLAGS)
+        return nz_flags(value);
+    #else
+        return alu_tables.nz[value];
+    #endif
+    }
+
+    /** @return packed result of ADC in the mode selected by ps */
+    inline word alu_adc(byte a, byte value, byte ps)
+    {
+        const bool carry = ps & FLAG_C;
+    #if defined(M6502_COMPUTED_FLAGS)
+        return (ps & FLAG_D) ? adc_decimal(a, value, carry) : adc_binary(a, value, carry);
+    #else
+        const u32 index = alu_index(a, value, carry);
+        return (ps & FLAG_D) ? alu_tables.adc_decimal[index] : alu_tables.adc[index];
+    #endif
+    }
+
+    /** @return packed result of SBC in the mode selected by ps */
+    inline word alu_sbc(byte a, byte value, byte ps)
+    {
+        const bool carry = ps & FLAG_C;
+    #if defined(M6502_COMPUTED_FLAGS)
+        return (ps & FLAG_D) ? sbc_decimal(a, value, carry) : adc_binary(a, ~value, carry);
+    #else
+        return (ps & FLAG_D)
+            ? alu_tables.sbc_decimal[alu_index(a, value, carry)]
+            : alu_tables.adc[alu_index(a, ~value, carry)];
+    #endif
+    }
+
+    /** @return N, Z and C of comparing reg with value, always binary */
+    inline byte alu_compare(byte reg, byte value)
+    {
+    #if defined(M6502_COMPUTED_FLAGS)
+        return nz_flags(reg - value) | (reg >= value ? FLAG_C : 0);
+    #else
+        return (alu_tables.adc[alu_index(reg, ~value, true)] >> 8) & (FLAG_N | FLAG_Z | FLAG_C);
+    #endif
+    }
+}
+
+#endif
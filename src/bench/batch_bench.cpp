@@ -0,0 +1,160 @@
+#include "cpu_batch.h"
+
+#include <chrono>
+#include <vector>
+
+// Aggregate throughput of CPUBatch against the same instances stepped one
+// CPU::execute call at a time
+
+using namespace emulator6502;
+
+namespace
+{
+    constexpr u32 INSTANCES = 1024;
+    constexpr s32 BUDGET = 20'000;
+    constexpr word LOOP_START = 0x0200;
+
+    struct Workload
+    {
+        const char* name;
+        std::vector<byte> program;
+        s32 loop_cycles;
+        s32 loop_instructions;
+    };
+
+    const Workload workloads[] = {
+        {
+            "registers",
+            {
+                CPU::INS_LDA_IM,  0x01,             // 2
+                CPU::INS_EOR_IM,  0x5A,             // 2
+                CPU::INS_AND_IM,  0x3C,             // 2
+                CPU::INS_ORA_IM,  0x81,             // 2
+                CPU::INS_LDX_IM,  0xF0,             // 2
+                CPU::INS_TXS,                       // 2
+                CPU::INS_TSX,                       // 2
+                CPU::INS_JMP_ABS, 0x00, 0x02,       // 3
+            },
+            17, 8
+        },
+        {
+            "memory",
+            {
+                CPU::INS_LDX_ZP,  0x10,             // 3
+                CPU::INS_LDA_ZPX, 0x20,             // 4
+                CPU::INS_EOR_IM,  0x5A,             // 2
+                CPU::INS_AND_ZP,  0x10,             // 3
+                CPU::INS_ORA_IM,  0x01,             // 2
+                CPU::INS_STA_ZP,  0x30,             // 3
+                CPU::INS_LDY_ZP,  0x30,             // 3
+                CPU::INS_STY_ZP,  0x10,             // 3
+                CPU::INS_JMP_ABS, 0x00, 0x02,       // 3
+            },
+            27, 9
+        },
+        {
+            // every instance takes the same branches
+            "counted",
+            {
+                CPU::INS_LDX_IM,  0x10,             // 2
+                CPU::INS_LDA_ZPX, 0x20,             // 4, 16 times
+                CPU::INS_EOR_IM,  0x5A,             // 2
+                CPU::INS_STA_ZPX, 0x40,             // 4
+                CPU::INS_DEX,                       // 2
+                CPU::INS_BNE,     0xF7,             // 3, 2 when done
+                CPU::INS_JMP_ABS, 0x00, 0x02,       // 3
+            },
+            244, 82
+        },
+        {
+            // the input parity picks the path and flips every pass, so half
+            // of the instances are always on the other side of the branch;
+            // loop figures are for two passes
+            "divergent",
+            {
+                CPU::INS_LDA_ZP,  0x10,             // 3
+                CPU::INS_CLC,                       // 2
+                CPU::INS_ADC_IM,  0x1D,             // 2
+                CPU::INS_STA_ZP,  0x10,             // 3
+                CPU::INS_AND_IM,  0x01,             // 2
+                CPU::INS_BEQ,     0x02,             // 3 taken, 2 not
+                CPU::INS_INY,                       // 2, not taken only
+                CPU::INS_INY,                       // 2, not taken only
+                CPU::INS_JMP_ABS, 0x00, 0x02,       // 3
+            },
+            39, 16
+        },
+    };
+
+    void load_workload(Memory& mem, const Workload& workload, byte input)
+    {
+        word address = LOOP_START;
+        for (byte b : workload.program)
+        {
+            mem[address++] = b;
+        }
+        mem[0x0010] = input;
+    }
+
+    void report(const char* engine, const Workload& workload, double seconds, double cycles)
+    {
+        const double instructions = cycles / workload.loop_cycles * workload.loop_instructions;
+        printf("%-10s %-10s %8.2f MIPS %8.2f emulated MHz (aggregate)\n",
+            workload.name, engine, instructions / seconds / 1e6, cycles / seconds / 1e6);
+    }
+
+    void run_separate(const Workload& workload)
+    {
+        std::vector<Memory> memories(INSTANCES);
+        std::vector<CPU> cpus;
+        cpus.reserve(INSTANCES);
+        for (u32 i = 0; i < INSTANCES; i++)
+        {
+            cpus.emplace_back(memories[i]);
+            cpus[i].reset(LOOP_START);
+            load_workload(memories[i], workload, (byte)i);
+        }
+
+        double cycles = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (CPU& cpu : cpus)
+        {
+            cycles += cpu.execute(BUDGET).cycles;
+        }
+        const auto end = std::chrono::steady_clock::now();
+        report("separate", workload, std::chrono::duration<double>(end - start).count(), cycles);
+    }
+
+    void run_batch(const Workload& workload)
+    {
+        CPUBatch batch(INSTANCES);
+        for (u32 i = 0; i < INSTANCES; i++)
+        {
+            batch.memory(i).init();
+            load_workload(batch.memory(i), workload, (byte)i);
+        }
+        batch.reset(LOOP_START);
+
+        const auto start = std::chrono::steady_clock::now();
+        batch.execute(BUDGET);
+        const auto end = std::chrono::steady_clock::now();
+
+        double cycles = 0;
+        for (u32 i = 0; i < INSTANCES; i++)
+        {
+            cycles += batch.cycles_used(i);
+        }
+        report("batch", workload, std::chrono::duration<double>(end - start).count(), cycles);
+    }
+}
+
+int main()
+{
+    for (const Workload& workload : workloads)
+    {
+        run_separate(workload);
+        run_batch(workload);
+    }
+
+    return 0;
+}
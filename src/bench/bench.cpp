@@ -0,0 +1,499 @@
+#include "m6502.h"
+#include "disassembler.h"
+#include "rewind.h"
+#include "trace.h"
+
+#include <chrono>
+#include <vector>
+#include <string.h>
+
+// Throughput of CPU::execute on fixed workloads, reported as JSON so runs can
+// be compared between releases. bench_computed_flags is the same program
+// built with M6502_COMPUTED_FLAGS, to compare against the flag tables.
+// Disassembly of memory ranges and traces is reported in lines per second,
+// and the cost of taking rewind checkpoints against running without them.
+//
+//  bench [-o file] [-r repetitions]
+
+using namespace emulator6502;
+
+namespace
+{
+    constexpr word LOOP_START = 0x0200;
+    constexpr s32 RUN_CYCLES = 50'000'000;
+
+    // each workload is a loop that ends by jumping back to LOOP_START, the
+    // class workloads stick to one group of instructions (plus the closing
+    // JMP and the flag or counter setup they need) so their cost can be
+    // tracked separately
+    struct Workload
+    {
+        const char* name;
+        const char* opcode_class;
+        std::vector<byte> program;
+    };
+
+    const Workload workloads[] = {
+        {
+            "load_store", "load/store",
+            {
+                CPU::INS_LDX_IM,  0x04,
+                CPU::INS_LDY_IM,  0x02,
+                CPU::INS_LDA_ZP,  0x10,
+                CPU::INS_STA_ZPX, 0x20,
+                CPU::INS_LDA_ABS, 0x00, 0x30,
+                CPU::INS_STA_AX,  0x00, 0x31,
+                CPU::INS_LDA_AY,  0x00, 0x30,
+                CPU::INS_STA_IX,  0x10,
+                CPU::INS_LDA_IY,  0x10,
+                CPU::INS_STX_ABS, 0x40, 0x30,
+                CPU::INS_STY_ZP,  0x30,
+                CPU::INS_JMP_ABS, 0x00, 0x02,
+            }
+        },
+        {
+            "logical", "logical",
+            {
+                CPU::INS_LDA_IM,  0x5A,
+                CPU::INS_AND_IM,  0x3C,
+                CPU::INS_EOR_ZP,  0x10,
+                CPU::INS_ORA_ZPX, 0x11,
+                CPU::INS_AND_ABS, 0x00, 0x30,
+                CPU::INS_EOR_AX,  0x01, 0x30,
+                CPU::INS_ORA_AY,  0x02, 0x30,
+                CPU::INS_AND_IX,  0x10,
+                CPU::INS_EOR_IY,  0x10,
+                CPU::INS_JMP_ABS, 0x00, 0x02,
+            }
+        },
+        {
+            "stack", "stack",
+            {
+                CPU::INS_PHA,
+                CPU::INS_PHP,
+                CPU::INS_PLP,
+                CPU::INS_PLA,
+                CPU::INS_TSX,
+                CPU::INS_TXS,
+                CPU::INS_PHA,
+                CPU::INS_PLA,
+                CPU::INS_JMP_ABS, 0x00, 0x02,
+            }
+        },
+        {
+            "jump", "jump/call",
+            {
+                CPU::INS_JSR,     0x10, 0x02,       // 0x0200
+                CPU::INS_JMP_I,   0x20, 0x00,       // 0x0203 through $0020 -> 0x0206
+                CPU::INS_JMP_ABS, 0x00, 0x02,       // 0x0206
+                0, 0, 0, 0, 0, 0, 0,                // padding up to 0x0210
+                CPU::INS_RTS,                       // 0x0210
+            }
+        },
+        {
+            "arithmetic", "arithmetic",
+            {
+                CPU::INS_CLC,
+                CPU::INS_LDA_IM,  0x37,
+                CPU::INS_ADC_IM,  0x59,
+                CPU::INS_ADC_ZP,  0x10,
+                CPU::INS_SBC_ABS, 0x00, 0x30,
+                CPU::INS_SBC_ZPX, 0x11,
+                CPU::INS_CMP_IM,  0x40,
+                CPU::INS_CPX_ZP,  0x10,
+                CPU::INS_CPY_ABS, 0x01, 0x30,
+                CPU::INS_BIT_ZP,  0x11,
+                CPU::INS_JMP_ABS, 0x00, 0x02,
+            }
+        },
+        {
+            "decimal", "arithmetic",
+            {
+                CPU::INS_SED,
+                CPU::INS_CLC,
+                CPU::INS_LDA_IM,  0x19,
+                CPU::INS_ADC_IM,  0x28,
+                CPU::INS_ADC_ZP,  0x10,
+                CPU::INS_SEC,
+                CPU::INS_SBC_IM,  0x46,
+                CPU::INS_SBC_ABS, 0x00, 0x30,
+                CPU::INS_CLD,
+                CPU::INS_JMP_ABS, 0x00, 0x02,
+            }
+        },
+        {
+            "shift_increment", "read-modify-write",
+            {
+                CPU::INS_LDA_IM,  0x81,
+                CPU::INS_ASL_A,
+                CPU::INS_ROL_ZP,  0x30,
+                CPU::INS_ROR_ABS, 0x31, 0x30,
+                CPU::INS_LSR_ZPX, 0x30,
+                CPU::INS_INC_ZP,  0x32,
+                CPU::INS_DEC_AX,  0x33, 0x30,
+                CPU::INS_INX,
+                CPU::INS_DEY,
+                CPU::INS_JMP_ABS, 0x00, 0x02,
+            }
+        },
+        {
+            "branch", "branch",
+            {
+                CPU::INS_LDX_IM,  0x08,             // 0x0200
+                CPU::INS_DEX,                       // 0x0202
+                CPU::INS_BNE,     0xFD,             // 0x0203
+                CPU::INS_CLC,
+                CPU::INS_BCC,     0x00,
+                CPU::INS_BCS,     0x00,
+                CPU::INS_JMP_ABS, 0x00, 0x02,
+            }
+        },
+        {
+            "mixed", "mixed",
+            {
+                CPU::INS_LDX_IM,  0x10,
+                CPU::INS_LDA_IM,  0x42,
+                CPU::INS_AND_ZP,  0x10,
+                CPU::INS_EOR_ABS, 0x34, 0x12,
+                CPU::INS_ORA_ZPX, 0x20,
+                CPU::INS_STA_ZP,  0x30,
+                CPU::INS_STA_AX,  0x00, 0x40,
+                CPU::INS_LDY_ZP,  0x30,
+                CPU::INS_PHA,
+                CPU::INS_PLA,
+                CPU::INS_JMP_ABS, 0x00, 0x02,
+            }
+        },
+    };
+
+    const char* engine_name()
+    {
+    #if defined(M6502_DISPATCH_SWITCH)
+        return "switch";
+    #elif defined(M6502_DISPATCH_TABLE) || !M6502_HAS_COMPUTED_GOTO
+        return "table";
+    #else
+        return "threaded";
+    #endif
+    }
+
+    const char* flags_name()
+    {
+    #if defined(M6502_COMPUTED_FLAGS)
+        return "computed";
+    #else
+        return "table";
+    #endif
+    }
+
+    void load_workload(Memory& mem, const Workload& workload)
+    {
+        mem.init();
+        word address = LOOP_START;
+        for (byte b : workload.program)
+        {
+            mem[address++] = b;
+        }
+        // operands for the indirect and indexed modes
+        mem[0x0010] = 0x00;
+        mem[0x0011] = 0x30;
+        mem[0x0020] = 0x06;
+        mem[0x0021] = 0x02;
+    }
+
+    struct Loop
+    {
+        s32 cycles = 0;
+        s32 instructions = 0;
+    };
+
+    // steps one iteration of the workload to find its length
+    Loop measure_loop(CPU& cpu)
+    {
+        Loop loop;
+        do
+        {
+            loop.cycles += cpu.execute(1).cycles;
+            loop.instructions++;
+        } while (cpu.PC != LOOP_START && loop.instructions < 1000);
+
+        if (cpu.PC != LOOP_START)
+        {
+            fprintf(stderr, "workload does not loop back to its start\n");
+            exit(1);
+        }
+        return loop;
+    }
+
+    struct Result
+    {
+        const Workload* workload;
+        Loop loop;
+        s64 instructions;
+        s32 cycles;
+        double seconds;
+    };
+
+    Result run(const Workload& workload, u32 repetitions)
+    {
+        Memory mem;
+        CPU cpu(mem);
+        load_workload(mem, workload);
+        cpu.reset(LOOP_START);
+
+        Result result = { &workload, measure_loop(cpu), 0, 0, 0 };
+        // whole iterations only, so the instruction count is exact
+        const s32 budget = RUN_CYCLES / result.loop.cycles * result.loop.cycles;
+
+        // best of the repetitions, the others are noise from the host
+        for (u32 i = 0; i < repetitions; i++)
+        {
+            cpu.reset(LOOP_START);
+            const auto start = std::chrono::steady_clock::now();
+            const s32 cycles = cpu.execute(budget).cycles;
+            const auto end = std::chrono::steady_clock::now();
+
+            const double seconds = std::chrono::duration<double>(end - start).count();
+            if (i == 0 || seconds < result.seconds)
+            {
+                result.seconds = seconds;
+                result.cycles = cycles;
+            }
+        }
+        result.instructions = (s64)(result.cycles / result.loop.cycles) * result.loop.instructions;
+        return result;
+    }
+
+    struct DisassemblyResult
+    {
+        const char* name;
+        u64 lines;
+        double seconds;
+    };
+
+    // best of the repetitions of write, which returns the lines it wrote
+    template<typename Write>
+    DisassemblyResult time_disassembly(const char* name, u32 repetitions, Write write)
+    {
+        FILE* sink = fopen("/dev/null", "w");
+        if (!sink)
+        {
+            fprintf(stderr, "cannot open /dev/null\n");
+            exit(1);
+        }
+
+        DisassemblyResult result = { name, 0, 0 };
+        for (u32 i = 0; i < repetitions; i++)
+        {
+            DisassemblyWriter writer(sink);
+            const auto start = std::chrono::steady_clock::now();
+            const u64 lines = write(writer);
+            writer.flush();
+            const auto end = std::chrono::steady_clock::now();
+
+            const double seconds = std::chrono::duration<double>(end - start).count();
+            if (i == 0 || seconds < result.seconds)
+            {
+                result.seconds = seconds;
+                result.lines = lines;
+            }
+        }
+        fclose(sink);
+        return result;
+    }
+
+    // the whole address space filled with copies of the workloads, and a
+    // full trace ring of the mixed workload
+    std::vector<DisassemblyResult> run_disassembly(u32 repetitions)
+    {
+        constexpr u32 RANGE_PASSES = 64;
+        constexpr u32 TRACE_RECORDS = 1 << 20;
+
+        Memory mem;
+        u32 address = 0;
+        while (address < Memory::MAX_MEMORY)
+        {
+            for (const Workload& workload : workloads)
+            {
+                const u32 size = std::min<u32>(workload.program.size(), Memory::MAX_MEMORY - address);
+                mem.load(address, workload.program.data(), size);
+                address += size;
+            }
+        }
+
+        std::vector<DisassemblyResult> results;
+        results.push_back(time_disassembly("range", repetitions, [&](DisassemblyWriter& writer) {
+            u64 lines = 0;
+            for (u32 pass = 0; pass < RANGE_PASSES; pass++)
+            {
+                lines += writer.write_range(mem, 0x0000, 0xFFFF);
+            }
+            return lines;
+        }));
+
+        const Workload& mixed = workloads[std::size(workloads) - 1];
+        Memory trace_mem;
+        CPU cpu(trace_mem);
+        load_workload(trace_mem, mixed);
+        cpu.reset(LOOP_START);
+        TraceRing trace(TRACE_RECORDS);
+        // no instruction takes more than 7 cycles, this fills the ring
+        cpu.execute(TRACE_RECORDS * 8, trace);
+        results.push_back(time_disassembly("trace", repetitions, [&](DisassemblyWriter& writer) {
+            return writer.write_trace(trace);
+        }));
+        return results;
+    }
+
+    struct RewindResult
+    {
+        u32 interval;
+        u32 checkpoints;
+        u32 bytes_used;
+        double seconds;
+        double plain_seconds;
+    };
+
+    // the mixed workload run through a RewindBuffer and straight, best of
+    // the repetitions of each
+    std::vector<RewindResult> run_rewind(u32 repetitions)
+    {
+        const Workload& mixed = workloads[std::size(workloads) - 1];
+        Memory mem;
+        CPU cpu(mem);
+        load_workload(mem, mixed);
+        const Memory image = mem;
+
+        std::vector<RewindResult> results;
+        for (u32 interval : { 1u << 12, RewindConfig().interval })
+        {
+            RewindResult result = { interval, 0, 0, 0, 0 };
+            for (u32 i = 0; i < repetitions; i++)
+            {
+                mem = image;
+                cpu.reset(LOOP_START);
+                auto start = std::chrono::steady_clock::now();
+                cpu.execute(RUN_CYCLES);
+                const double plain = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                mem = image;
+                cpu.reset(LOOP_START);
+                RewindBuffer rewind(cpu, mem, { interval, RewindConfig().memory_budget });
+                start = std::chrono::steady_clock::now();
+                rewind.execute(RUN_CYCLES);
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                if (i == 0 || plain < result.plain_seconds) result.plain_seconds = plain;
+                if (i == 0 || seconds < result.seconds)
+                {
+                    result.seconds = seconds;
+                    result.checkpoints = rewind.checkpoints();
+                    result.bytes_used = rewind.bytes_used();
+                }
+            }
+            results.push_back(result);
+        }
+        return results;
+    }
+
+    void write_json(FILE* out, const std::vector<Result>& results,
+        const std::vector<DisassemblyResult>& disassembly,
+        const std::vector<RewindResult>& rewind, u32 repetitions)
+    {
+        fprintf(out, "{\n");
+        fprintf(out, "  \"engine\": \"%s\",\n", engine_name());
+        fprintf(out, "  \"flags\": \"%s\",\n", flags_name());
+        fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+        fprintf(out, "  \"repetitions\": %u,\n", repetitions);
+        fprintf(out, "  \"workloads\": [\n");
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& r = results[i];
+            fprintf(out, "    {\n");
+            fprintf(out, "      \"name\": \"%s\",\n", r.workload->name);
+            fprintf(out, "      \"class\": \"%s\",\n", r.workload->opcode_class);
+            fprintf(out, "      \"loop_instructions\": %d,\n", r.loop.instructions);
+            fprintf(out, "      \"loop_cycles\": %d,\n", r.loop.cycles);
+            fprintf(out, "      \"instructions\": %lld,\n", (long long)r.instructions);
+            fprintf(out, "      \"cycles\": %d,\n", r.cycles);
+            fprintf(out, "      \"seconds\": %.6f,\n", r.seconds);
+            fprintf(out, "      \"emulated_mhz\": %.3f,\n", r.cycles / r.seconds / 1e6);
+            fprintf(out, "      \"mips\": %.3f,\n", r.instructions / r.seconds / 1e6);
+            fprintf(out, "      \"ns_per_instruction\": %.3f\n", r.seconds * 1e9 / r.instructions);
+            fprintf(out, "    }%s\n", i + 1 < results.size() ? "," : "");
+        }
+        fprintf(out, "  ],\n");
+        fprintf(out, "  \"disassembly\": [\n");
+        for (size_t i = 0; i < disassembly.size(); i++)
+        {
+            const DisassemblyResult& r = disassembly[i];
+            fprintf(out, "    {\n");
+            fprintf(out, "      \"name\": \"%s\",\n", r.name);
+            fprintf(out, "      \"lines\": %llu,\n", r.lines);
+            fprintf(out, "      \"seconds\": %.6f,\n", r.seconds);
+            fprintf(out, "      \"lines_per_second\": %.0f\n", r.lines / r.seconds);
+            fprintf(out, "    }%s\n", i + 1 < disassembly.size() ? "," : "");
+        }
+        fprintf(out, "  ],\n");
+        fprintf(out, "  \"rewind\": [\n");
+        for (size_t i = 0; i < rewind.size(); i++)
+        {
+            const RewindResult& r = rewind[i];
+            fprintf(out, "    {\n");
+            fprintf(out, "      \"interval\": %u,\n", r.interval);
+            fprintf(out, "      \"checkpoints\": %u,\n", r.checkpoints);
+            fprintf(out, "      \"bytes_used\": %u,\n", r.bytes_used);
+            fprintf(out, "      \"seconds\": %.6f,\n", r.seconds);
+            fprintf(out, "      \"plain_seconds\": %.6f,\n", r.plain_seconds);
+            fprintf(out, "      \"overhead_percent\": %.2f\n", (r.seconds / r.plain_seconds - 1) * 100);
+            fprintf(out, "    }%s\n", i + 1 < rewind.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n");
+        fprintf(out, "}\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* output = nullptr;
+    u32 repetitions = 5;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            repetitions = std::max(1, atoi(argv[++i]));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-o file] [-r repetitions]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    for (const Workload& workload : workloads)
+    {
+        results.push_back(run(workload, repetitions));
+    }
+
+    const std::vector<DisassemblyResult> disassembly = run_disassembly(repetitions);
+    const std::vector<RewindResult> rewind = run_rewind(repetitions);
+
+    FILE* out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "cannot open %s\n", output);
+        return 1;
+    }
+    write_json(out, results, disassembly, rewind, repetitions);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "m6502.h"
+#include "block_cache.h"
+#include "profiler.h"
+
+#include <chrono>
+
+// Compares the throughput of the dispatch engines behind CPU::execute, and
+// of the predecoded block engine with and without its native tier. The
+// functional row uses the default engine with per instruction counting,
+// the profiled row the default interpreter counting into a Profiler
+
+using namespace emulator6502;
+
+namespace
+{
+    constexpr word LOOP_START = 0x0200;
+    constexpr s32 LOOP_CYCLES = 36;
+    constexpr s32 LOOP_INSTRUCTIONS = 11;
+    constexpr s32 ITERATIONS = 2'000'000;
+
+    // load/logical/store/stack mix that jumps back to its start
+    void load_workload(Memory& mem)
+    {
+        const byte program[] = {
+            CPU::INS_LDX_IM,  0x10,             // 2
+            CPU::INS_LDA_IM,  0x42,             // 2
+            CPU::INS_AND_ZP,  0x10,             // 3
+            CPU::INS_EOR_ABS, 0x34, 0x12,       // 4
+            CPU::INS_ORA_ZPX, 0x20,             // 4
+            CPU::INS_STA_ZP,  0x30,             // 3
+            CPU::INS_STA_AX,  0x00, 0x40,       // 5
+            CPU::INS_LDY_ZP,  0x30,             // 3
+            CPU::INS_PHA,                       // 3
+            CPU::INS_PLA,                       // 4
+            CPU::INS_JMP_ABS, 0x00, 0x02,       // 3
+        };
+
+        word address = LOOP_START;
+        for (byte b : program)
+        {
+            mem[address++] = b;
+        }
+    }
+
+    template<typename F>
+    void run(const char* name, Memory& mem, CPU& cpu, F engine)
+    {
+        cpu.reset(LOOP_START);
+        load_workload(mem);
+        if (engine(cpu, LOOP_CYCLES) != LOOP_CYCLES || cpu.PC != LOOP_START)
+        {
+            printf("%-10s workload out of sync\n", name);
+            exit(1);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        s32 cycles_used = engine(cpu, LOOP_CYCLES * ITERATIONS);
+        const auto end = std::chrono::steady_clock::now();
+
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        const double instructions = (double)(cycles_used / LOOP_CYCLES) * LOOP_INSTRUCTIONS;
+        printf("%-10s %8.2f MIPS %8.2f emulated MHz\n",
+            name, instructions / seconds / 1e6, cycles_used / seconds / 1e6);
+    }
+}
+
+int main()
+{
+    Memory mem;
+    CPU cpu(mem);
+
+    run("switch", mem, cpu, [](CPU& c, s32 n) { return c.execute_switch(n).cycles; });
+    run("table", mem, cpu, [](CPU& c, s32 n) { return c.execute_table(n).cycles; });
+#if M6502_HAS_COMPUTED_GOTO
+    run("threaded", mem, cpu, [](CPU& c, s32 n) { return c.execute_threaded(n).cycles; });
+#endif
+    run("functional", mem, cpu, [](CPU& c, s32 n) { return c.execute<Functional>(n).cycles; });
+    Profiler profiler;
+    run("profiled", mem, cpu, [&profiler](CPU& c, s32 n) { return c.execute(n, profiler).cycles; });
+    BlockCache cache(mem);
+    run("blocks", mem, cpu, [&cache](CPU& c, s32 n) { return c.execute(n, cache).cycles; });
+    BlockCache jit_cache(mem);
+    if (jit_cache.enable_jit(16))
+    {
+        run("jit", mem, cpu, [&jit_cache](CPU& c, s32 n) { return c.execute(n, jit_cache).cycles; });
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "fleet.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Aggregate throughput of Fleet for 1 thread up to every hardware thread,
+// with scaling relative to the single thread run
+
+using namespace emulator6502;
+
+namespace
+{
+    constexpr u32 JOBS_PER_THREAD = 16;
+    constexpr s32 LOOP_CYCLES = 27;
+
+    FleetJob make_job(u32 index)
+    {
+        FleetJob job;
+        job.image = {
+            CPU::INS_LDX_ZP,  0x10,             // 3
+            CPU::INS_LDA_ZPX, 0x20,             // 4
+            CPU::INS_EOR_IM,  0x5A,             // 2
+            CPU::INS_AND_ZP,  0x10,             // 3
+            CPU::INS_ORA_IM,  0x01,             // 2
+            CPU::INS_STA_ZP,  0x30,             // 3
+            CPU::INS_LDY_ZP,  0x30,             // 3
+            CPU::INS_STY_ZP,  0x10,             // 3
+            CPU::INS_JMP_ABS, 0x00, 0x02,       // 3
+        };
+        job.load_address = 0x0200;
+        job.PC = 0x0200;
+        job.A = index;
+        // uneven budgets, so threads finish their share at different times
+        job.cycles = LOOP_CYCLES * (200'000 + (index * 7919) % 200'000);
+        job.capture = { { 0x0010, 0x30 } };
+        return job;
+    }
+}
+
+int main()
+{
+    const u32 max_threads = std::max(1u, std::thread::hardware_concurrency());
+    const u32 job_count = max_threads * JOBS_PER_THREAD;
+
+    std::vector<FleetJob> jobs;
+    for (u32 i = 0; i < job_count; i++)
+    {
+        jobs.push_back(make_job(i));
+    }
+
+    // powers of two, then every hardware thread
+    std::vector<u32> thread_counts;
+    for (u32 threads = 1; threads < max_threads; threads *= 2)
+    {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    double single_rate = 0;
+    for (u32 threads : thread_counts)
+    {
+        Fleet fleet(threads);
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<FleetResult> results = fleet.run(jobs);
+        const auto end = std::chrono::steady_clock::now();
+
+        double cycles = 0;
+        for (const FleetResult& result : results)
+        {
+            cycles += result.cycles_used;
+        }
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        const double rate = cycles / seconds / 1e6;
+        if (threads == 1) single_rate = rate;
+        printf("%3u threads %10.2f emulated MHz (aggregate) %6.2fx\n", threads, rate, rate / single_rate);
+    }
+
+    return 0;
+}
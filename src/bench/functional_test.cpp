@@ -0,0 +1,150 @@
+#include "m6502.h"
+#include "loader.h"
+
+#include <chrono>
+#include <cstring>
+
+// Runs a full CPU functional test image, such as Klaus Dormann's
+// 6502_functional_test.bin, until it settles in a trap: a jump or branch
+// to itself that leaves PC unchanged. Reaching the success trap passes,
+// any other trap fails at its PC. The image is supplied locally, the
+// defaults match the prebuilt binary of that suite (loaded at 0x0000,
+// started at 0x0400, success trap at 0x3469).
+//
+// exit status: 0 passed, 1 failed, 2 no trap within the cycle limit,
+// 64 usage or load error
+
+using namespace emulator6502;
+
+namespace
+{
+    constexpr int USAGE_ERROR = 64;
+    // traps are looked for between slices
+    constexpr s32 SLICE = 1 << 20;
+
+    int usage(const char* program)
+    {
+        fprintf(stderr,
+            "usage: %s [options] image\n"
+            "  -a address   load address of a raw image, default 0x0000\n"
+            "  -p address   start address, default 0x0400\n"
+            "  -s address   success trap, default 0x3469\n"
+            "  -c cycles    give up after this many cycles, default 2000000000\n",
+            program);
+        return USAGE_ERROR;
+    }
+
+    bool parse_number(const char* text, u64 max, u64& value)
+    {
+        char* end;
+        value = strtoull(text, &end, 0);
+        return *text && !*end && value <= max;
+    }
+
+    // JMP abs to its own address, or a branch with a displacement of -2
+    bool jumps_to_self(const Memory& mem, word pc)
+    {
+        const byte opcode = mem.peek(pc);
+        if (opcode == CPU::INS_JMP_ABS)
+        {
+            return (mem.peek(pc + 1) | mem.peek(pc + 2) << 8) == pc;
+        }
+        return (opcode & 0x1F) == 0x10 && mem.peek(pc + 1) == 0xFE;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    u64 load_address = 0x0000, start = 0x0400, success = 0x3469, limit = 2'000'000'000;
+    const char* image = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-a") == 0 && has_value)
+        {
+            if (!parse_number(argv[++i], 0xFFFF, load_address)) return usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && has_value)
+        {
+            if (!parse_number(argv[++i], 0xFFFF, start)) return usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && has_value)
+        {
+            if (!parse_number(argv[++i], 0xFFFF, success)) return usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && has_value)
+        {
+            if (!parse_number(argv[++i], ~0ull, limit)) return usage(argv[0]);
+        }
+        else if (argv[i][0] != '-' && !image)
+        {
+            image = argv[i];
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+    if (!image) return usage(argv[0]);
+
+    Memory mem;
+    CPU cpu(mem);
+    if (load_file(mem, image, (word)load_address).size == 0)
+    {
+        fprintf(stderr, "%s: cannot load %s\n", argv[0], image);
+        return USAGE_ERROR;
+    }
+    cpu.reset((word)start);
+
+    ExecuteResult result{};
+    u64 cycles = 0;
+    bool trapped = false;
+    const auto begin = std::chrono::steady_clock::now();
+    while (cycles < limit)
+    {
+        result = cpu.execute((s32)std::min<u64>(SLICE, limit - cycles));
+        cycles += result.cycles;
+        if (result.reason != StopReason::BUDGET) break;
+
+        // a trap only counts once running it leaves PC where it was
+        if (jumps_to_self(mem, cpu.PC))
+        {
+            const word pc = cpu.PC;
+            result = cpu.execute(1);
+            cycles += result.cycles;
+            if (cpu.PC == pc)
+            {
+                trapped = true;
+                break;
+            }
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    int status;
+    if (trapped && cpu.PC == success)
+    {
+        printf("passed: success trap at 0x%04X\n", cpu.PC);
+        status = 0;
+    }
+    else if (trapped)
+    {
+        printf("failed: trap at 0x%04X, A=%02X X=%02X Y=%02X SP=%02X PS=%02X\n",
+            cpu.PC, cpu.A, cpu.X, cpu.Y, cpu.SP, cpu.PS);
+        status = 1;
+    }
+    else if (result.reason != StopReason::BUDGET)
+    {
+        printf("failed: stopped on opcode 0x%02X at 0x%04X\n", result.opcode, result.PC);
+        status = 1;
+    }
+    else
+    {
+        printf("failed: no trap within %llu cycles, PC at 0x%04X\n", limit, cpu.PC);
+        status = 2;
+    }
+    printf("%llu cycles in %.3f s, %.2f emulated MHz\n",
+        cycles, seconds, seconds > 0 ? cycles / seconds / 1e6 : 0.0);
+    return status;
+}
@@ -0,0 +1,112 @@
+#include "block_cache.h"
+#include "jit_x64.h"
+
+using namespace emulator6502;
+
+BlockCache::BlockCache(Memory& memory)
+    : mem(memory)
+{
+    attach();
+}
+
+BlockCache::~BlockCache()
+{
+    if (mem.has_code_observer(this))
+    {
+        mem.set_code_observer(nullptr, nullptr);
+    }
+}
+
+void BlockCache::flush()
+{
+    for (u32 page = 0; page < Memory::PAGE_COUNT; page++)
+    {
+        for (word start : page_starts[page])
+        {
+            set_entry(start, 0);
+        }
+        page_starts[page].clear();
+    }
+    ops.clear();
+    blocks.clear();
+    live_blocks = 0;
+#if M6502_HAS_JIT
+    if (jit) jit->reset();
+#endif
+}
+
+bool BlockCache::enable_jit(u32 threshold)
+{
+#if M6502_HAS_JIT
+    if (!jit) jit.reset(new X64Jit(*this));
+    jit_threshold = threshold;
+    return true;
+#else
+    (void)threshold;
+    return false;
+#endif
+}
+
+void BlockCache::attach()
+{
+    if (!mem.has_code_observer(this))
+    {
+        flush();
+        mem.set_code_observer(&BlockCache::code_written, this);
+    }
+}
+
+// registers a block whose ops were appended from first_op, pages holds its code pages
+const BlockCache::Block* BlockCache::add_block(word pc, u32 first_op, u64 (&pages)[Memory::PAGE_COUNT / 64])
+{
+    Block block;
+    block.first_op = first_op;
+    block.op_count = (u32)ops.size() - first_op;
+    block.start = pc;
+    blocks.push_back(block);
+    set_entry(pc, (u32)blocks.size());
+    live_blocks++;
+
+    for (u32 i = 0; i < Memory::PAGE_COUNT / 64; i++)
+    {
+        for (u64 bits = pages[i]; bits; bits &= bits - 1)
+        {
+            const byte page = i * 64 + std::countr_zero(bits);
+            page_starts[page].push_back(pc);
+            mem.protect_code(page);
+        }
+    }
+    return &blocks.back();
+}
+
+void BlockCache::set_entry(word pc, u32 entry)
+{
+    std::unique_ptr<u32[]>& page = entries[pc >> 8];
+    if (!page)
+    {
+        if (!entry) return;
+        page.reset(new u32[Memory::PAGE_SIZE]());
+    }
+    page[pc & 0xFF] = entry;
+}
+
+void BlockCache::invalidate_page(byte page)
+{
+    for (word start : page_starts[page])
+    {
+        // a block spanning two pages is listed under both
+        if (find(start))
+        {
+            set_entry(start, 0);
+            live_blocks--;
+            invalidated_blocks++;
+        }
+    }
+    page_starts[page].clear();
+    invalidated = true;
+}
+
+void BlockCache::code_written(void* context, byte page)
+{
+    static_cast<BlockCache*>(context)->invalidate_page(page);
+}
@@ -0,0 +1,114 @@
+#ifndef _H_BLOCK_CACHE
+#define _H_BLOCK_CACHE
+
+#include "m6502.h"
+
+#include <memory>
+#include <vector>
+
+namespace emulator6502 {
+
+    class X64Jit;
+    struct JitState;
+
+    /**
+     * Predecoded straight-line runs of instructions, keyed by the address
+     * of their first instruction, for CPU::execute(s32, BlockCache&). Each
+     * instruction is stored as its resolved handler and operand so running
+     * a cached block skips the opcode and operand fetches.
+     *
+     * A block ends after an instruction that sets PC, before an unknown
+     * opcode or I/O page, or after MAX_BLOCK_OPS instructions. Its pages
+     * are write protected through Memory::protect_code, any write to them
+     * drops the blocks decoded from that page.
+     *
+     * Several caches may share a Memory, but only the one last used by
+     * CPU::execute observes its writes; switching between them flushes.
+    */
+    class BlockCache
+    {
+    public:
+        explicit BlockCache(Memory&);
+        ~BlockCache();
+        BlockCache(const BlockCache&) = delete;
+        BlockCache& operator=(const BlockCache&) = delete;
+
+        Memory& memory() { return mem; }
+        // drop every block
+        void flush();
+        /** @return number of blocks that can currently be entered */
+        u32 size() const { return live_blocks; }
+        /** @return number of blocks dropped because their code was written */
+        u64 invalidations() const { return invalidated_blocks; }
+
+        /**
+         * Compile blocks to native code once they have been entered
+         * threshold times, 0 compiles every block before its first run.
+         * @return false when the JIT is not available (see M6502_HAS_JIT)
+        */
+        bool enable_jit(u32 threshold);
+        /** @return number of blocks compiled to native code */
+        u64 compiled_blocks() const { return compiled; }
+
+    private:
+        friend struct CPU;
+        friend class X64Jit;
+
+        static constexpr u32 MAX_BLOCK_OPS = 32;
+        static constexpr u32 MAX_OPS = 1 << 16;
+
+        struct Op
+        {
+            void (CPU::*handler)(word);
+            word operand;
+            byte size; // opcode and operand bytes
+            byte opcode;
+        };
+
+        struct Block
+        {
+            u32 first_op;
+            u32 op_count;
+            word start;
+            // native tier, see enable_jit
+            u32 hits = 0;
+            bool native_failed = false;
+            s32 native_max_cycles = 0;
+            void (*native)(JitState*) = nullptr;
+        };
+
+        Memory& mem;
+        std::vector<Op> ops;
+        std::vector<Block> blocks;
+        // block index + 1 by start address, 0 when there is none, one table
+        // per page allocated on first use
+        std::unique_ptr<u32[]> entries[Memory::PAGE_COUNT];
+        // start addresses of the blocks decoded from each page
+        std::vector<word> page_starts[Memory::PAGE_COUNT];
+        u32 live_blocks = 0;
+        u64 invalidated_blocks = 0;
+        // set when a write dropped blocks, the running block stops after it
+        bool invalidated = false;
+
+        std::unique_ptr<X64Jit> jit;
+        u32 jit_threshold = 0;
+        u64 compiled = 0;
+
+        Block* find(word pc)
+        {
+            const u32* page = entries[pc >> 8].get();
+            const u32 entry = page ? page[pc & 0xFF] : 0;
+            return entry ? &blocks[entry - 1] : nullptr;
+        }
+
+        // become the observer of mem's code pages, flushing if another
+        // cache observed them in the meantime
+        void attach();
+        const Block* add_block(word pc, u32 first_op, u64 (&pages)[Memory::PAGE_COUNT / 64]);
+        void set_entry(word pc, u32 entry);
+        void invalidate_page(byte page);
+        static void code_written(void* context, byte page);
+    };
+}
+
+#endif
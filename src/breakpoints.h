@@ -0,0 +1,107 @@
+#ifndef _H_BREAKPOINTS
+#define _H_BREAKPOINTS
+
+#include "m6502.h"
+
+namespace emulator6502 {
+
+    /**
+     * Set of PCs for CPU::run_until, one bit per address so checking the
+     * PC of an instruction is a single load and test.
+    */
+    class Breakpoints
+    {
+    public:
+        void add(word address)
+        {
+            if (!contains(address)) count++;
+            bits[address >> 6] |= 1ull << (address & 63);
+        }
+
+        void remove(word address)
+        {
+            if (contains(address)) count--;
+            bits[address >> 6] &= ~(1ull << (address & 63));
+        }
+
+        void clear()
+        {
+            std::fill(std::begin(bits), std::end(bits), 0);
+            count = 0;
+        }
+
+        M6502_ALWAYS_INLINE bool contains(word address) const
+        {
+            return (bits[address >> 6] >> (address & 63)) & 1;
+        }
+
+        /** @return number of addresses in the set */
+        u32 size() const { return count; }
+        bool empty() const { return count == 0; }
+
+    private:
+        u64 bits[Memory::MAX_MEMORY / 64] = {};
+        u32 count = 0;
+    };
+
+    // conditions for CPU::run_until on top of the cycle budget, unset ones
+    // are left out of the dispatch loop
+    struct RunUntil
+    {
+        // stop before an instruction at any of these addresses
+        const Breakpoints* breakpoints = nullptr;
+        // stop after this many instructions, 0 for no limit
+        u64 instructions = 0;
+        // stop once this returns true after an instruction
+        bool (*predicate)(void* context, const CPU&) = nullptr;
+        void* context = nullptr;
+    };
+
+    /**
+     * Stop policies for the CPU dispatch loops, checked after every
+     * instruction only when enabled is set, so NoStop compiles to the
+     * plain loop.
+    */
+    struct NoStop
+    {
+        static constexpr bool enabled = false;
+    };
+
+    // RunUntil conditions in use, as bits
+    constexpr u32 UNTIL_BREAKPOINT = 1, UNTIL_INSTRUCTIONS = 2, UNTIL_PREDICATE = 4;
+
+    // checks the UNTIL_ bits in conditions, each one in use costs one test
+    // per instruction
+    template<u32 conditions>
+    struct StopWhen
+    {
+        static constexpr bool enabled = true;
+
+        const RunUntil& until;
+        u64 instructions_left;
+
+        explicit StopWhen(const RunUntil& until)
+            : until(until), instructions_left(until.instructions)
+        {}
+
+        /** @return the reason to stop before the next instruction, BUDGET to go on */
+        M6502_ALWAYS_INLINE StopReason check(const CPU& cpu)
+        {
+            if constexpr ((conditions & UNTIL_BREAKPOINT) != 0)
+            {
+                if (until.breakpoints->contains(cpu.PC)) [[unlikely]] return StopReason::BREAKPOINT;
+            }
+            if constexpr ((conditions & UNTIL_INSTRUCTIONS) != 0)
+            {
+                if (--instructions_left == 0) [[unlikely]] return StopReason::INSTRUCTION_LIMIT;
+            }
+            if constexpr ((conditions & UNTIL_PREDICATE) != 0)
+            {
+                if (until.predicate(until.context, cpu)) [[unlikely]] return StopReason::PREDICATE;
+            }
+            return StopReason::BUDGET;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,704 @@
+#include "cpu_batch.h"
+#include "alu.h"
+#include "opcodes.h"
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+using namespace emulator6502;
+
+// the vector helpers below are internal, the ABI notes about returning
+// wide vectors without AVX do not apply
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace
+{
+    // lane width of the register/flag kernels, the compiler lowers these
+    // vectors to AVX2 (one op), SSE2 (two ops) or scalar code
+    constexpr u32 LANES = 32;
+    // instances run to completion a tile at a time
+    constexpr u32 TILE = 256;
+    constexpr u32 CACHE_LINE = 64;
+    constexpr u32 MEMORY_STRIDE = (sizeof(Memory) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE + CACHE_LINE;
+    // scalar slice for an instance that runs alone
+    constexpr s32 DIVERGED_SLICE = 128;
+
+    typedef byte lanes8 __attribute__((vector_size(LANES)));
+    typedef signed char slanes8 __attribute__((vector_size(LANES)));
+    typedef word lanes16 __attribute__((vector_size(LANES * sizeof(word))));
+    typedef s32 lanes32 __attribute__((vector_size(LANES * sizeof(s32))));
+
+    lanes8 load8(const byte* src)
+    {
+        lanes8 v;
+        std::memcpy(&v, src, sizeof(v));
+        return v;
+    }
+
+    void store8(byte* dst, const lanes8& v)
+    {
+        std::memcpy(dst, &v, sizeof(v));
+    }
+
+    lanes16 load16(const word* src)
+    {
+        lanes16 v;
+        std::memcpy(&v, src, sizeof(v));
+        return v;
+    }
+
+    void store16(word* dst, const lanes16& v)
+    {
+        std::memcpy(dst, &v, sizeof(v));
+    }
+
+    lanes32 load32(const s32* src)
+    {
+        lanes32 v;
+        std::memcpy(&v, src, sizeof(v));
+        return v;
+    }
+
+    void store32(s32* dst, const lanes32& v)
+    {
+        std::memcpy(dst, &v, sizeof(v));
+    }
+
+    // horizontal sum of per lane counters
+    u32 sum(const lanes8& v)
+    {
+        u32 total = 0;
+        for (u32 i = 0; i < LANES; i++)
+        {
+            total += v[i];
+        }
+        return total;
+    }
+
+    lanes8 blend(const lanes8& old_value, const lanes8& new_value, const lanes8& mask)
+    {
+        return (old_value & ~mask) | (new_value & mask);
+    }
+
+    // dst = src in masked lanes
+    void masked_assign(byte* dst, const byte* src, const byte* mask, u32 n)
+    {
+        for (u32 i = 0; i < n; i += LANES)
+        {
+            store8(dst + i, blend(load8(dst + i), load8(src + i), load8(mask + i)));
+        }
+    }
+
+    // dst = dst (op) src in masked lanes
+    template<typename Op>
+    void masked_logic(byte* dst, const byte* src, const byte* mask, u32 n, Op op)
+    {
+        for (u32 i = 0; i < n; i += LANES)
+        {
+            lanes8 d = load8(dst + i);
+            store8(dst + i, blend(d, op(d, load8(src + i)), load8(mask + i)));
+        }
+    }
+
+    // zero and negative flags of reg into ps, in masked lanes
+    void masked_zero_and_negative(const byte* reg, byte* ps, const byte* mask, u32 n)
+    {
+        constexpr byte Z = 1 << 1, N = 1 << 7;
+        for (u32 i = 0; i < n; i += LANES)
+        {
+            lanes8 r = load8(reg + i);
+            lanes8 p = load8(ps + i);
+            lanes8 flags = (r & N) | ((lanes8)(r == 0) & Z);
+            store8(ps + i, blend(p, (p & (byte)~(Z | N)) | flags, load8(mask + i)));
+        }
+    }
+
+    // dst += delta in masked lanes
+    void masked_add(byte* dst, byte delta, const byte* mask, u32 n)
+    {
+        for (u32 i = 0; i < n; i += LANES)
+        {
+            lanes8 d = load8(dst + i);
+            store8(dst + i, blend(d, d + delta, load8(mask + i)));
+        }
+    }
+
+    // sets or clears flag in masked lanes
+    void masked_flag(byte* ps, byte flag, bool set, const byte* mask, u32 n)
+    {
+        for (u32 i = 0; i < n; i += LANES)
+        {
+            lanes8 p = load8(ps + i);
+            store8(ps + i, blend(p, set ? p | flag : p & (byte)~flag, load8(mask + i)));
+        }
+    }
+
+    // CMP, CPX and CPY: flags of reg - value in masked lanes
+    void masked_compare(const byte* reg, const byte* value, byte* ps, const byte* mask, u32 n)
+    {
+        for (u32 i = 0; i < n; i += LANES)
+        {
+            lanes8 r = load8(reg + i);
+            lanes8 v = load8(value + i);
+            lanes8 p = load8(ps + i);
+            lanes8 diff = r - v;
+            lanes8 flags = (diff & FLAG_N) | ((lanes8)(diff == 0) & FLAG_Z) | ((lanes8)(r >= v) & FLAG_C);
+            store8(ps + i, blend(p, (p & (byte)~(FLAG_N | FLAG_Z | FLAG_C)) | flags, load8(mask + i)));
+        }
+    }
+
+    // ADC, or SBC as an ADC of the inverted value, in masked lanes; binary
+    // lanes run here, the few in decimal mode go through the scalar ALU
+    void masked_add_with_carry(byte* a, const byte* value, byte* ps, const byte* mask, u32 n, bool subtract)
+    {
+        lanes8 decimal = {};
+        for (u32 i = 0; i < n; i += LANES)
+        {
+            lanes8 r = load8(a + i);
+            lanes8 v = subtract ? ~load8(value + i) : load8(value + i);
+            lanes8 p = load8(ps + i);
+            lanes8 m = load8(mask + i);
+            lanes8 decimal_mode = (lanes8)((p & FLAG_D) != 0);
+            lanes8 binary = m & ~decimal_mode;
+            decimal |= m & decimal_mode;
+
+            lanes16 total = __builtin_convertvector(r, lanes16) + __builtin_convertvector(v, lanes16)
+                + __builtin_convertvector(p & FLAG_C, lanes16);
+            lanes8 result = __builtin_convertvector(total, lanes8);
+            lanes8 carry = __builtin_convertvector(total >> 8, lanes8);
+            lanes8 overflow = ((r ^ result) & (v ^ result) & FLAG_N) >> 1;
+            lanes8 flags = (result & FLAG_N) | ((lanes8)(result == 0) & FLAG_Z) | overflow | carry;
+            store8(a + i, blend(r, result, binary));
+            store8(ps + i, blend(p, (p & (byte)~ALU_FLAGS) | flags, binary));
+        }
+        if (!sum(decimal & 1)) return;
+
+        for (u32 i = 0; i < n; i++)
+        {
+            if (!mask[i] || !(ps[i] & FLAG_D)) continue;
+            const word packed = subtract ? alu_sbc(a[i], value[i], ps[i]) : alu_adc(a[i], value[i], ps[i]);
+            a[i] = (byte)packed;
+            ps[i] = (ps[i] & ~ALU_FLAGS) | (packed >> 8);
+        }
+    }
+
+    // lockstep instructions, everything else goes through CPU::execute
+    enum LaneKind : byte
+    {
+        SCALAR, LOAD, STORE, AND, EOR, ORA, TSX, TXS, JMP,
+        ADC, SBC, COMPARE, INCREMENT, DECREMENT, TRANSFER, SET_FLAG, CLEAR_FLAG, BRANCH, NOP,
+    };
+    enum LaneMode : byte { IMPLIED, IMMEDIATE, ZERO_PAGE, ZERO_PAGE_X, ZERO_PAGE_Y, ABSOLUTE, ABSOLUTE_X, ABSOLUTE_Y, RELATIVE };
+    enum LaneReg : byte { REG_A, REG_X, REG_Y };
+
+    struct LaneInstruction
+    {
+        LaneKind kind = SCALAR;
+        LaneMode mode = IMPLIED;
+        LaneReg reg = REG_A;
+        LaneReg source = REG_A; // TRANSFER copies source into reg
+        byte flag = 0;          // of SET_FLAG, CLEAR_FLAG and the flag a BRANCH tests
+        bool set = false;       // a BRANCH is taken when flag is set
+    };
+
+    constexpr std::array<LaneInstruction, 256> make_lane_table()
+    {
+        std::array<LaneInstruction, 256> t{};
+
+        t[CPU::INS_LDA_IM]  = { LOAD, IMMEDIATE, REG_A };
+        t[CPU::INS_LDA_ZP]  = { LOAD, ZERO_PAGE, REG_A };
+        t[CPU::INS_LDA_ZPX] = { LOAD, ZERO_PAGE_X, REG_A };
+        t[CPU::INS_LDA_ABS] = { LOAD, ABSOLUTE, REG_A };
+        t[CPU::INS_LDA_AX]  = { LOAD, ABSOLUTE_X, REG_A };
+        t[CPU::INS_LDA_AY]  = { LOAD, ABSOLUTE_Y, REG_A };
+        t[CPU::INS_LDX_IM]  = { LOAD, IMMEDIATE, REG_X };
+        t[CPU::INS_LDX_ZP]  = { LOAD, ZERO_PAGE, REG_X };
+        t[CPU::INS_LDX_ZPY] = { LOAD, ZERO_PAGE_Y, REG_X };
+        t[CPU::INS_LDX_ABS] = { LOAD, ABSOLUTE, REG_X };
+        t[CPU::INS_LDX_AY]  = { LOAD, ABSOLUTE_Y, REG_X };
+        t[CPU::INS_LDY_IM]  = { LOAD, IMMEDIATE, REG_Y };
+        t[CPU::INS_LDY_ZP]  = { LOAD, ZERO_PAGE, REG_Y };
+        t[CPU::INS_LDY_ZPX] = { LOAD, ZERO_PAGE_X, REG_Y };
+        t[CPU::INS_LDY_ABS] = { LOAD, ABSOLUTE, REG_Y };
+        t[CPU::INS_LDY_AX]  = { LOAD, ABSOLUTE_X, REG_Y };
+
+        t[CPU::INS_STA_ZP]  = { STORE, ZERO_PAGE, REG_A };
+        t[CPU::INS_STA_ZPX] = { STORE, ZERO_PAGE_X, REG_A };
+        t[CPU::INS_STA_ABS] = { STORE, ABSOLUTE, REG_A };
+        t[CPU::INS_STA_AX]  = { STORE, ABSOLUTE_X, REG_A };
+        t[CPU::INS_STA_AY]  = { STORE, ABSOLUTE_Y, REG_A };
+        t[CPU::INS_STX_ZP]  = { STORE, ZERO_PAGE, REG_X };
+        t[CPU::INS_STX_ZPY] = { STORE, ZERO_PAGE_Y, REG_X };
+        t[CPU::INS_STX_ABS] = { STORE, ABSOLUTE, REG_X };
+        t[CPU::INS_STY_ZP]  = { STORE, ZERO_PAGE, REG_Y };
+        t[CPU::INS_STY_ZPX] = { STORE, ZERO_PAGE_X, REG_Y };
+        t[CPU::INS_STY_ABS] = { STORE, ABSOLUTE, REG_Y };
+
+        const byte logical[6][6] = {
+            { CPU::INS_AND_IM, CPU::INS_AND_ZP, CPU::INS_AND_ZPX, CPU::INS_AND_ABS, CPU::INS_AND_AX, CPU::INS_AND_AY },
+            { CPU::INS_EOR_IM, CPU::INS_EOR_ZP, CPU::INS_EOR_ZPX, CPU::INS_EOR_ABS, CPU::INS_EOR_AX, CPU::INS_EOR_AY },
+            { CPU::INS_ORA_IM, CPU::INS_ORA_ZP, CPU::INS_ORA_ZPX, CPU::INS_ORA_ABS, CPU::INS_ORA_AX, CPU::INS_ORA_AY },
+            { CPU::INS_ADC_IM, CPU::INS_ADC_ZP, CPU::INS_ADC_ZPX, CPU::INS_ADC_ABS, CPU::INS_ADC_AX, CPU::INS_ADC_AY },
+            { CPU::INS_SBC_IM, CPU::INS_SBC_ZP, CPU::INS_SBC_ZPX, CPU::INS_SBC_ABS, CPU::INS_SBC_AX, CPU::INS_SBC_AY },
+            { CPU::INS_CMP_IM, CPU::INS_CMP_ZP, CPU::INS_CMP_ZPX, CPU::INS_CMP_ABS, CPU::INS_CMP_AX, CPU::INS_CMP_AY },
+        };
+        const LaneKind logical_kind[6] = { AND, EOR, ORA, ADC, SBC, COMPARE };
+        const LaneMode logical_mode[6] = { IMMEDIATE, ZERO_PAGE, ZERO_PAGE_X, ABSOLUTE, ABSOLUTE_X, ABSOLUTE_Y };
+        for (u32 op = 0; op < 6; op++)
+        {
+            for (u32 mode = 0; mode < 6; mode++)
+            {
+                t[logical[op][mode]] = { logical_kind[op], logical_mode[mode], REG_A };
+            }
+        }
+
+        t[CPU::INS_CPX_IM]  = { COMPARE, IMMEDIATE, REG_X };
+        t[CPU::INS_CPX_ZP]  = { COMPARE, ZERO_PAGE, REG_X };
+        t[CPU::INS_CPX_ABS] = { COMPARE, ABSOLUTE, REG_X };
+        t[CPU::INS_CPY_IM]  = { COMPARE, IMMEDIATE, REG_Y };
+        t[CPU::INS_CPY_ZP]  = { COMPARE, ZERO_PAGE, REG_Y };
+        t[CPU::INS_CPY_ABS] = { COMPARE, ABSOLUTE, REG_Y };
+
+        t[CPU::INS_INX]     = { INCREMENT, IMPLIED, REG_X };
+        t[CPU::INS_INY]     = { INCREMENT, IMPLIED, REG_Y };
+        t[CPU::INS_DEX]     = { DECREMENT, IMPLIED, REG_X };
+        t[CPU::INS_DEY]     = { DECREMENT, IMPLIED, REG_Y };
+        t[CPU::INS_TAX]     = { TRANSFER, IMPLIED, REG_X, REG_A };
+        t[CPU::INS_TAY]     = { TRANSFER, IMPLIED, REG_Y, REG_A };
+        t[CPU::INS_TXA]     = { TRANSFER, IMPLIED, REG_A, REG_X };
+        t[CPU::INS_TYA]     = { TRANSFER, IMPLIED, REG_A, REG_Y };
+        t[CPU::INS_TSX]     = { TSX, IMPLIED, REG_X };
+        t[CPU::INS_TXS]     = { TXS, IMPLIED, REG_X };
+
+        t[CPU::INS_CLC]     = { CLEAR_FLAG, IMPLIED, REG_A, REG_A, FLAG_C };
+        t[CPU::INS_CLD]     = { CLEAR_FLAG, IMPLIED, REG_A, REG_A, FLAG_D };
+        t[CPU::INS_CLI]     = { CLEAR_FLAG, IMPLIED, REG_A, REG_A, FLAG_I };
+        t[CPU::INS_CLV]     = { CLEAR_FLAG, IMPLIED, REG_A, REG_A, FLAG_V };
+        t[CPU::INS_SEC]     = { SET_FLAG, IMPLIED, REG_A, REG_A, FLAG_C };
+        t[CPU::INS_SED]     = { SET_FLAG, IMPLIED, REG_A, REG_A, FLAG_D };
+        t[CPU::INS_SEI]     = { SET_FLAG, IMPLIED, REG_A, REG_A, FLAG_I };
+
+        t[CPU::INS_BCC]     = { BRANCH, RELATIVE, REG_A, REG_A, FLAG_C, false };
+        t[CPU::INS_BCS]     = { BRANCH, RELATIVE, REG_A, REG_A, FLAG_C, true };
+        t[CPU::INS_BNE]     = { BRANCH, RELATIVE, REG_A, REG_A, FLAG_Z, false };
+        t[CPU::INS_BEQ]     = { BRANCH, RELATIVE, REG_A, REG_A, FLAG_Z, true };
+        t[CPU::INS_BPL]     = { BRANCH, RELATIVE, REG_A, REG_A, FLAG_N, false };
+        t[CPU::INS_BMI]     = { BRANCH, RELATIVE, REG_A, REG_A, FLAG_N, true };
+        t[CPU::INS_BVC]     = { BRANCH, RELATIVE, REG_A, REG_A, FLAG_V, false };
+        t[CPU::INS_BVS]     = { BRANCH, RELATIVE, REG_A, REG_A, FLAG_V, true };
+
+        t[CPU::INS_JMP_ABS] = { JMP, ABSOLUTE, REG_A };
+        t[CPU::INS_NOP]     = { NOP, IMPLIED, REG_A };
+
+        return t;
+    }
+
+    constexpr std::array<LaneInstruction, 256> lane_table = make_lane_table();
+
+    // lengths and base cycles come from opcode_info, the lane modes have to
+    // match it
+    constexpr bool lane_table_matches_opcode_info()
+    {
+        constexpr AddressMode modes[] = {
+            AddressMode::IMPLIED, AddressMode::IMMEDIATE, AddressMode::ZERO_PAGE,
+            AddressMode::ZERO_PAGE_X, AddressMode::ZERO_PAGE_Y, AddressMode::ABSOLUTE,
+            AddressMode::ABSOLUTE_X, AddressMode::ABSOLUTE_Y, AddressMode::RELATIVE,
+        };
+        for (u32 opcode = 0; opcode < 256; opcode++)
+        {
+            const LaneInstruction& ins = lane_table[opcode];
+            if (ins.kind != SCALAR && modes[ins.mode] != opcode_info[opcode].mode) return false;
+        }
+        return true;
+    }
+    static_assert(lane_table_matches_opcode_info());
+}
+
+CPUBatch::CPUBatch(u32 instances)
+    : count(instances),
+      padded_count((instances + LANES - 1) / LANES * LANES),
+      memory_storage(new byte[instances * MEMORY_STRIDE + CACHE_LINE])
+{
+    // line up the first instance, then skew each one by a line
+    byte* storage = memory_storage.get();
+    storage += (CACHE_LINE - (std::uintptr_t)storage % CACHE_LINE) % CACHE_LINE;
+    memories.reserve(count);
+    for (u32 i = 0; i < count; i++)
+    {
+        memories.push_back(new (storage + i * MEMORY_STRIDE) Memory);
+    }
+
+    PC.resize(padded_count);
+    SP.resize(padded_count);
+    A.resize(padded_count);
+    X.resize(padded_count);
+    Y.resize(padded_count);
+    PS.resize(padded_count);
+    cycles.resize(padded_count);
+    active.resize(padded_count);
+    stops.resize(count);
+    stopped_cycles.resize(count);
+    group.resize(padded_count);
+    values.resize(padded_count);
+    cost.resize(padded_count);
+    address.resize(padded_count);
+
+    cpus.reserve(count);
+    for (u32 i = 0; i < count; i++)
+    {
+        cpus.emplace_back(*memories[i]);
+    }
+
+    reset();
+}
+
+CPUBatch::~CPUBatch()
+{
+    for (Memory* mem : memories)
+    {
+        mem->~Memory();
+    }
+}
+
+void CPUBatch::reset(word reset_vector)
+{
+    std::fill(PC.begin(), PC.end(), reset_vector);
+    std::fill(SP.begin(), SP.end(), 0xFF);
+    std::fill(A.begin(), A.end(), 0);
+    std::fill(X.begin(), X.end(), 0);
+    std::fill(Y.begin(), Y.end(), 0);
+    std::fill(PS.begin(), PS.end(), 0);
+}
+
+void CPUBatch::execute(s32 cycle_count)
+{
+    budget = cycle_count;
+    std::fill(cycles.begin(), cycles.begin() + count, cycle_count);
+    std::fill(active.begin(), active.begin() + count, cycle_count > 0 ? 0xFF : 0x00);
+    std::fill(stops.begin(), stops.end(), StopReason::BUDGET);
+
+    // tiles keep the working set (registers plus the touched lines of each
+    // instance's memory) small enough to stay in cache
+    for (first = 0; first < padded_count; first += TILE)
+    {
+        last = std::min(first + TILE, padded_count);
+        last_instance = std::min(last, count);
+        execute_tile();
+    }
+}
+
+void CPUBatch::execute_tile()
+{
+    // a group that just stepped together still shares its PC, so it keeps
+    // running without being selected again
+    u32 members = 0;
+    u32 leader = 0;
+
+    while (true)
+    {
+        const bool reselect = members < 2 || verify_code;
+        if (reselect)
+        {
+            // the instance furthest behind leads, keeping instances close in
+            // time so the ones that branched apart can meet again
+            s32 most_cycles = 0;
+            for (u32 i = first; i < last_instance; i++)
+            {
+                most_cycles = std::max(most_cycles, cycles[i]);
+            }
+            if (most_cycles <= 0) break;
+
+            leader = first;
+            while (cycles[leader] != most_cycles) leader++;
+        }
+
+        const word pc = PC[leader];
+        const Memory& mem = *memories[leader];
+        const byte code[3] = { mem.peek(pc), mem.peek(pc + 1), mem.peek(pc + 2) };
+
+        const LaneInstruction ins = lane_table[code[0]];
+        if (reselect)
+        {
+            const u32 length = ins.kind == SCALAR ? 1 : opcode_info[code[0]].length;
+            members = select_group(pc, code, length);
+        }
+
+        if (members < 2)
+        {
+            step_scalar(leader, DIVERGED_SLICE);
+            members = 0;
+        }
+        else if (ins.kind == SCALAR)
+        {
+            // keep the group together, one instruction each
+            for (u32 i = first; i < last_instance; i++)
+            {
+                if (group[i]) step_scalar(i, 1);
+            }
+            members = 0;
+        }
+        else
+        {
+            members = step_group(pc, code, leader);
+        }
+    }
+}
+
+/** @return number of instances in lockstep with the leader */
+u32 CPUBatch::select_group(word pc, const byte* code, u32 length)
+{
+    lanes8 members = {};
+    for (u32 i = first; i < last; i += LANES)
+    {
+        lanes8 same_pc = __builtin_convertvector((lanes16)(load16(&PC[i]) == pc), lanes8);
+        lanes8 g = same_pc & load8(&active[i]);
+        store8(&group[i], g);
+        members += g & 1;
+    }
+    if (!verify_code) return sum(members);
+
+    // instances only share the instruction if their code bytes agree
+    u32 verified = 0;
+    for (u32 i = first; i < last_instance; i++)
+    {
+        if (!group[i]) continue;
+
+        const Memory& mem = *memories[i];
+        for (u32 b = 0; b < length; b++)
+        {
+            if (mem.peek(pc + b) != code[b])
+            {
+                group[i] = 0;
+                break;
+            }
+        }
+        verified += group[i] & 1;
+    }
+    return verified;
+}
+
+/**
+ * executes one instruction for every instance in the group
+ * @return number of instances still in the group, leader is set to the first
+ */
+u32 CPUBatch::step_group(word pc, const byte* code, u32& leader)
+{
+    const LaneInstruction ins = lane_table[code[0]];
+    const OpInfo& info = opcode_info[code[0]];
+    const u32 length = info.length;
+    const word operand = code[1] | (code[2] << 8);
+    byte* reg = ins.reg == REG_A ? A.data() : ins.reg == REG_X ? X.data() : Y.data();
+
+    compute_addresses(ins.mode, operand);
+
+    switch (ins.kind)
+    {
+    case LOAD:
+    case AND:
+    case EOR:
+    case ORA:
+    case ADC:
+    case SBC:
+    case COMPARE:
+    {
+        if (ins.mode == IMMEDIATE)
+        {
+            std::fill(values.begin() + first, values.begin() + last, code[1]);
+        }
+        else
+        {
+            for (u32 i = first; i < last_instance; i++)
+            {
+                if (group[i]) values[i] = memories[i]->read(address[i]);
+            }
+        }
+
+        if (ins.kind == LOAD)
+            masked_assign(reg + first, values.data() + first, group.data() + first, last - first);
+        else if (ins.kind == AND)
+            masked_logic(reg + first, values.data() + first, group.data() + first, last - first, [](const lanes8& a, const lanes8& b) { return a & b; });
+        else if (ins.kind == EOR)
+            masked_logic(reg + first, values.data() + first, group.data() + first, last - first, [](const lanes8& a, const lanes8& b) { return a ^ b; });
+        else if (ins.kind == ORA)
+            masked_logic(reg + first, values.data() + first, group.data() + first, last - first, [](const lanes8& a, const lanes8& b) { return a | b; });
+        else if (ins.kind == COMPARE)
+        {
+            masked_compare(reg + first, values.data() + first, PS.data() + first, group.data() + first, last - first);
+            break;
+        }
+        else
+        {
+            masked_add_with_carry(A.data() + first, values.data() + first, PS.data() + first, group.data() + first, last - first, ins.kind == SBC);
+            break;
+        }
+
+        masked_zero_and_negative(reg + first, PS.data() + first, group.data() + first, last - first);
+    } break;
+    case STORE:
+    {
+        for (u32 i = first; i < last_instance; i++)
+        {
+            if (group[i]) memories[i]->write(address[i], reg[i]);
+        }
+    } break;
+    case TSX:
+    {
+        masked_assign(X.data() + first, SP.data() + first, group.data() + first, last - first);
+        masked_zero_and_negative(X.data() + first, PS.data() + first, group.data() + first, last - first);
+    } break;
+    case TXS:
+    {
+        masked_assign(SP.data() + first, X.data() + first, group.data() + first, last - first);
+    } break;
+    case INCREMENT:
+    case DECREMENT:
+    {
+        masked_add(reg + first, ins.kind == INCREMENT ? 1 : 0xFF, group.data() + first, last - first);
+        masked_zero_and_negative(reg + first, PS.data() + first, group.data() + first, last - first);
+    } break;
+    case TRANSFER:
+    {
+        const byte* source = ins.source == REG_A ? A.data() : ins.source == REG_X ? X.data() : Y.data();
+        masked_assign(reg + first, source + first, group.data() + first, last - first);
+        masked_zero_and_negative(reg + first, PS.data() + first, group.data() + first, last - first);
+    } break;
+    case SET_FLAG:
+    case CLEAR_FLAG:
+    {
+        masked_flag(PS.data() + first, ins.flag, ins.kind == SET_FLAG, group.data() + first, last - first);
+    } break;
+    case BRANCH:
+    {
+        // values marks the lanes that take the branch, cost their one or two
+        // extra cycles
+        const word next = pc + length;
+        const word target = next + (signed char)code[1];
+        const byte taken_cost = 1 + ((next ^ target) >> 8 != 0);
+        for (u32 i = first; i < last; i += LANES)
+        {
+            lanes8 flag_set = (lanes8)((load8(&PS[i]) & ins.flag) != 0);
+            lanes8 taken = (ins.set ? flag_set : ~flag_set) & load8(&group[i]);
+            store8(&values[i], taken);
+            store8(&cost[i], taken & taken_cost);
+        }
+    } break;
+    default:
+        break;
+    }
+
+    const word next_pc = ins.kind == JMP ? operand : (word)(pc + length);
+    // lanes marked in values go here instead, only branches mark any
+    const word taken_pc = ins.kind == BRANCH ? (word)(next_pc + (signed char)code[1]) : next_pc;
+    const byte base_cycles = info.cycles;
+    // only reads pay the page crossing cycle compute_addresses found, a
+    // branch charges all of its extra cycles
+    const byte extra_cycles = ins.kind == BRANCH ? 0xFF : info.page_penalty;
+
+    // advance PC and cycles, drop instances that ran out of cycles
+    lanes8 members = {};
+    for (u32 i = first; i < last; i += LANES)
+    {
+        const lanes8 g = load8(&group[i]);
+        const lanes16 g16 = __builtin_convertvector((slanes8)g, lanes16);
+        const lanes16 taken16 = __builtin_convertvector((slanes8)load8(&values[i]), lanes16);
+        const lanes32 used = __builtin_convertvector(((load8(&cost[i]) & extra_cycles) + base_cycles) & g, lanes32);
+
+        lanes32 c = load32(&cycles[i]) - used;
+        store32(&cycles[i], c);
+        const lanes16 to = (next_pc & ~taken16) | (taken_pc & taken16);
+        store16(&PC[i], (load16(&PC[i]) & ~g16) | (to & g16));
+
+        // sign of (cycles - 1) instead of a compare, which gcc scalarises
+        const lanes8 alive = ~(lanes8)__builtin_convertvector((c - 1) >> 31, slanes8);
+        store8(&active[i], load8(&active[i]) & (alive | ~g));
+        store8(&group[i], g & alive);
+        members += g & alive & 1;
+    }
+
+    u32 remaining = sum(members);
+    if (remaining)
+    {
+        leader = first;
+        while (!group[leader]) leader++;
+    }
+    if (remaining && ins.kind == BRANCH)
+    {
+        // the group goes on with the instances that went where the leader
+        // did, the others are selected again later
+        const word leader_pc = PC[leader];
+        members = lanes8{};
+        for (u32 i = first; i < last; i += LANES)
+        {
+            const lanes8 same_pc = __builtin_convertvector((lanes16)(load16(&PC[i]) == leader_pc), lanes8);
+            const lanes8 g = load8(&group[i]) & same_pc;
+            store8(&group[i], g);
+            members += g & 1;
+        }
+        remaining = sum(members);
+    }
+    return remaining;
+}
+
+// effective address and page crossing penalty of every instance
+void CPUBatch::compute_addresses(byte mode, word operand)
+{
+    switch (mode)
+    {
+    case ZERO_PAGE:
+    case ABSOLUTE:
+        std::fill(address.begin() + first, address.begin() + last, operand & (mode == ZERO_PAGE ? 0xFF : 0xFFFF));
+        std::fill(cost.begin() + first, cost.begin() + last, 0);
+        break;
+    case ZERO_PAGE_X:
+    case ZERO_PAGE_Y:
+    case ABSOLUTE_X:
+    case ABSOLUTE_Y:
+    {
+        const bool zero_page = mode == ZERO_PAGE_X || mode == ZERO_PAGE_Y;
+        const byte* index = mode == ZERO_PAGE_X || mode == ABSOLUTE_X ? X.data() : Y.data();
+        for (u32 i = first; i < last; i += LANES)
+        {
+            lanes16 addr = operand + __builtin_convertvector(load8(index + i), lanes16);
+            if (zero_page) addr &= 0xFF;
+            const lanes16 crossed = (lanes16)(((operand ^ addr) >> 8) != 0);
+            store16(&address[i], addr);
+            store8(&cost[i], zero_page ? lanes8{} : __builtin_convertvector(crossed, lanes8) & 1);
+        }
+    } break;
+    default:
+        std::fill(cost.begin() + first, cost.begin() + last, 0);
+        break;
+    }
+}
+
+// runs one instance alone through the regular interpreter
+void CPUBatch::step_scalar(u32 instance, s32 slice)
+{
+    CPU& cpu = cpus[instance];
+    cpu.PC = PC[instance];
+    cpu.SP = SP[instance];
+    cpu.A = A[instance];
+    cpu.X = X[instance];
+    cpu.Y = Y[instance];
+    cpu.PS = PS[instance];
+
+    const ExecuteResult result = cpu.execute(std::min(cycles[instance], slice));
+    cycles[instance] -= result.cycles;
+
+    PC[instance] = cpu.PC;
+    SP[instance] = cpu.SP;
+    A[instance] = cpu.A;
+    X[instance] = cpu.X;
+    Y[instance] = cpu.Y;
+    PS[instance] = cpu.PS;
+
+    if (result.reason != StopReason::BUDGET)
+    {
+        // no cycles left keeps it out of the leader and group selection
+        stops[instance] = result.reason;
+        stopped_cycles[instance] = cycles[instance];
+        cycles[instance] = 0;
+    }
+    active[instance] = cycles[instance] > 0 ? 0xFF : 0x00;
+}
@@ -0,0 +1,87 @@
+#ifndef _H_CPU_BATCH
+#define _H_CPU_BATCH
+
+#include "m6502.h"
+
+#include <memory>
+#include <vector>
+
+namespace emulator6502 {
+
+    /**
+     * Runs many independent 6502 instances in lockstep. Registers are kept as
+     * structure of arrays so instances sitting on the same PC execute their
+     * instruction together, with the register and flag work done across SIMD
+     * lanes. Instances are expected to share their program: the code bytes are
+     * read from the leading instance (see set_code_verification). Instances
+     * that diverge and instructions without a lane implementation are stepped
+     * one at a time through CPU::execute.
+     *
+     * Build with -march=native (M6502_NATIVE) to get AVX2 lanes, otherwise
+     * the compiler falls back to SSE2 or scalar code.
+     */
+    class CPUBatch
+    {
+    public:
+        explicit CPUBatch(u32 instances);
+        ~CPUBatch();
+        CPUBatch(const CPUBatch&) = delete;
+        CPUBatch& operator=(const CPUBatch&) = delete;
+
+        u32 size() const { return count; }
+        Memory& memory(u32 instance) { return *memories[instance]; }
+
+        // reset registers of every instance, memory is left untouched
+        void reset(word = 0xFFFC);
+        // run every instance for the given number of cycles
+        void execute(s32);
+        // compare code bytes of every instance before running them together,
+        // only needed when instances may run different code at the same PC
+        void set_code_verification(bool enabled) { verify_code = enabled; }
+        /** @return cycles used by an instance in the last execute */
+        s32 cycles_used(u32 instance) const
+        {
+            return budget - (stops[instance] == StopReason::BUDGET ? cycles[instance] : stopped_cycles[instance]);
+        }
+        // an instance stopped by an opcode sits out the rest of execute
+        /** @return why an instance stopped in the last execute */
+        StopReason stop_reason(u32 instance) const { return stops[instance]; }
+
+        // register file, one entry per instance (padded to the lane width)
+        std::vector<word> PC;
+        std::vector<byte> SP, A, X, Y, PS;
+
+    private:
+        u32 count;
+        u32 padded_count;
+        s32 budget = 0;
+        bool verify_code = false;
+
+        // instance memories share one allocation, staggered by a cache line
+        // so the same address in neighbouring instances maps to different
+        // cache sets
+        std::unique_ptr<byte[]> memory_storage;
+        std::vector<Memory*> memories;
+        std::vector<CPU> cpus; // scalar fallback, one per instance
+
+        std::vector<s32> cycles;
+        std::vector<byte> active;   // 0xFF while an instance has cycles left
+        std::vector<StopReason> stops;
+        std::vector<s32> stopped_cycles; // cycles left when an opcode stopped an instance
+        std::vector<byte> group;    // 0xFF for instances in the current lockstep group
+        std::vector<byte> values;   // per instance operand values
+        std::vector<byte> cost;     // per instance cycle cost of the current instruction
+        std::vector<word> address;  // per instance effective address
+
+        // instance range of the tile being executed
+        u32 first = 0, last = 0, last_instance = 0;
+
+        void execute_tile();
+        u32 select_group(word pc, const byte* code, u32 length);
+        u32 step_group(word pc, const byte* code, u32& leader);
+        void step_scalar(u32 instance, s32 slice);
+        void compute_addresses(byte mode, word operand);
+    };
+}
+
+#endif
@@ -0,0 +1,206 @@
+#include "disassembler.h"
+#include "opcodes.h"
+#include "trace.h"
+
+using namespace emulator6502;
+
+namespace
+{
+    constexpr char HEX[] = "0123456789ABCDEF";
+
+    M6502_ALWAYS_INLINE char* put_hex8(char* out, byte value)
+    {
+        out[0] = HEX[value >> 4];
+        out[1] = HEX[value & 0x0F];
+        return out + 2;
+    }
+
+    M6502_ALWAYS_INLINE char* put_hex16(char* out, word value)
+    {
+        out = put_hex8(out, value >> 8);
+        return put_hex8(out, value & 0xFF);
+    }
+
+    M6502_ALWAYS_INLINE char* put(char* out, const char* text)
+    {
+        while (*text) *out++ = *text++;
+        return out;
+    }
+
+    char* put_decimal(char* out, s32 value)
+    {
+        u32 magnitude = value < 0 ? 0u - (u32)value : (u32)value;
+        if (value < 0) *out++ = '-';
+        char digits[10];
+        u32 count = 0;
+        do
+        {
+            digits[count++] = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude);
+        while (count) *out++ = digits[--count];
+        return out;
+    }
+
+    // the mnemonic and operand, as an assembler would take them
+    char* put_instruction(char* out, const byte* code, word pc)
+    {
+        const OpInfo& info = opcode_info[code[0]];
+        if (!info.implemented())
+        {
+            out = put(out, ".byte $");
+            return put_hex8(out, code[0]);
+        }
+
+        out = put(out, info.mnemonic);
+        const word absolute = code[1] | (code[2] << 8);
+        switch (info.mode)
+        {
+        case AddressMode::IMPLIED:
+            break;
+        case AddressMode::ACCUMULATOR:
+            out = put(out, " A");
+            break;
+        case AddressMode::IMMEDIATE:
+            out = put(out, " #$");
+            out = put_hex8(out, code[1]);
+            break;
+        case AddressMode::ZERO_PAGE:
+            out = put(out, " $");
+            out = put_hex8(out, code[1]);
+            break;
+        case AddressMode::ZERO_PAGE_X:
+            out = put(out, " $");
+            out = put(put_hex8(out, code[1]), ",X");
+            break;
+        case AddressMode::ZERO_PAGE_Y:
+            out = put(out, " $");
+            out = put(put_hex8(out, code[1]), ",Y");
+            break;
+        case AddressMode::ABSOLUTE:
+            out = put(out, " $");
+            out = put_hex16(out, absolute);
+            break;
+        case AddressMode::ABSOLUTE_X:
+            out = put(out, " $");
+            out = put(put_hex16(out, absolute), ",X");
+            break;
+        case AddressMode::ABSOLUTE_Y:
+            out = put(out, " $");
+            out = put(put_hex16(out, absolute), ",Y");
+            break;
+        case AddressMode::INDIRECT:
+            out = put(out, " ($");
+            out = put(put_hex16(out, absolute), ")");
+            break;
+        case AddressMode::INDIRECT_X:
+            out = put(out, " ($");
+            out = put(put_hex8(out, code[1]), ",X)");
+            break;
+        case AddressMode::INDIRECT_Y:
+            out = put(out, " ($");
+            out = put(put_hex8(out, code[1]), "),Y");
+            break;
+        case AddressMode::RELATIVE:
+            out = put(out, " $");
+            out = put_hex16(out, pc + info.length + (signed char)code[1]);
+            break;
+        }
+        return out;
+    }
+
+    // address, the instruction bytes padded to three and the instruction
+    char* put_line(char* out, const byte* code, word pc)
+    {
+        const OpInfo& info = opcode_info[code[0]];
+        out = put_hex16(out, pc);
+        *out++ = ' ';
+        for (u32 i = 0; i < 3; i++)
+        {
+            *out++ = ' ';
+            if (i < info.length)
+            {
+                out = put_hex8(out, code[i]);
+            }
+            else
+            {
+                *out++ = ' ';
+                *out++ = ' ';
+            }
+        }
+        *out++ = ' ';
+        *out++ = ' ';
+        return put_instruction(out, code, pc);
+    }
+}
+
+u32 emulator6502::disassemble(const byte* code, word pc, char* out)
+{
+    return put_line(out, code, pc) - out;
+}
+
+u32 emulator6502::disassemble(const Memory& mem, word address, char* out)
+{
+    const byte code[3] = { mem.peek(address), mem.peek(address + 1), mem.peek(address + 2) };
+    return put_line(out, code, address) - out;
+}
+
+u32 emulator6502::disassemble(const TraceRecord& record, char* out)
+{
+    // the widest instruction is "LDA ($nn),Y", registers line up after it
+    constexpr u32 REGISTERS_COLUMN = 4 + 2 + 8 + 2 + 11 + 2;
+
+    const byte code[3] = { record.opcode, record.operands[0], record.operands[1] };
+    char* end = put_line(out, code, record.PC);
+    while (end < out + REGISTERS_COLUMN) *end++ = ' ';
+
+    end = put_hex8(put(end, "A:"), record.A);
+    end = put_hex8(put(end, " X:"), record.X);
+    end = put_hex8(put(end, " Y:"), record.Y);
+    end = put_hex8(put(end, " SP:"), record.SP);
+    end = put_hex8(put(end, " PS:"), record.PS);
+    end = put_decimal(put(end, " CY:"), record.cycles);
+    return end - out;
+}
+
+//~~~~~~~~~~~~~~~~~DisassemblyWriter~~~~~~~~~~~~~~~~~
+
+DisassemblyWriter::DisassemblyWriter(FILE* out, u32 buffer_size)
+    : out(out),
+      buffer(new char[std::max(buffer_size, TRACE_LINE_MAX + 1)]),
+      capacity(std::max(buffer_size, TRACE_LINE_MAX + 1))
+{}
+
+u64 DisassemblyWriter::write_range(const Memory& mem, word first, word last)
+{
+    u64 lines = 0;
+    // u32 so a range ending at 0xFFFF terminates
+    for (u32 address = first; address <= last; lines++)
+    {
+        const byte code[3] = { mem.peek(address), mem.peek(address + 1), mem.peek(address + 2) };
+        char* line = reserve(DISASSEMBLY_LINE_MAX);
+        commit(put_line(line, code, address) - line);
+        address += opcode_info[code[0]].length;
+    }
+    return lines;
+}
+
+u64 DisassemblyWriter::write_trace(const TraceRing& trace)
+{
+    for (u32 i = 0; i < trace.size(); i++)
+    {
+        char* line = reserve(TRACE_LINE_MAX);
+        commit(disassemble(trace[i], line));
+    }
+    return trace.size();
+}
+
+bool DisassemblyWriter::flush()
+{
+    if (used && fwrite(buffer.get(), 1, used, out) != used)
+    {
+        failed = true;
+    }
+    used = 0;
+    return !failed;
+}
@@ -0,0 +1,94 @@
+#ifndef _H_DISASSEMBLER
+#define _H_DISASSEMBLER
+
+#include "m6502.h"
+
+#include <memory>
+
+namespace emulator6502 {
+
+    struct TraceRecord;
+    class TraceRing;
+
+    /**
+     * Disassembly driven by opcode_info (see opcodes.h). Lines are written
+     * into caller provided buffers without allocating or going through
+     * printf, so whole memory ranges and traces can be turned into text at
+     * the rate they are decoded. A line looks like
+     *
+     *   0200  BD 01 30  LDA $3001,X
+     *
+     * with branch targets resolved to absolute addresses, and opcodes
+     * without a handler written as .byte. Trace lines add the registers
+     * before the instruction and the cycles left:
+     *
+     *   0200  A9 01     LDA #$01     A:00 X:00 Y:00 SP:FF PS:00 CY:1000
+     *
+     * None of the functions terminate the line or add a newline.
+    */
+
+    // longest instruction and trace line, without terminator
+    constexpr u32 DISASSEMBLY_LINE_MAX = 28;
+    constexpr u32 TRACE_LINE_MAX = 80;
+
+    /**
+     * @param code the opcode and the two bytes after it, used or not
+     * @return characters written to out, at most DISASSEMBLY_LINE_MAX
+    */
+    u32 disassemble(const byte* code, word pc, char* out);
+    /**
+     * Decodes the instruction at address, read with Memory::peek so I/O
+     * handlers are not triggered.
+     * @return characters written to out, at most DISASSEMBLY_LINE_MAX
+    */
+    u32 disassemble(const Memory&, word address, char* out);
+    /** @return characters written to out, at most TRACE_LINE_MAX */
+    u32 disassemble(const TraceRecord&, char* out);
+
+    /**
+     * Streams disassembly lines into a FILE through one fixed buffer that
+     * is written out with fwrite whenever it fills up, and by flush.
+    */
+    class DisassemblyWriter
+    {
+    public:
+        explicit DisassemblyWriter(FILE* out, u32 buffer_size = 1 << 16);
+        ~DisassemblyWriter() { flush(); }
+        DisassemblyWriter(const DisassemblyWriter&) = delete;
+        DisassemblyWriter& operator=(const DisassemblyWriter&) = delete;
+
+        /**
+         * One line per instruction from first up to and including last,
+         * instructions are decoded back to back from first.
+         * @return number of lines written
+        */
+        u64 write_range(const Memory&, word first, word last);
+        /** @return number of lines written, oldest record first */
+        u64 write_trace(const TraceRing&);
+
+        /** @return false once an fwrite has come up short */
+        bool flush();
+
+    private:
+        FILE* out;
+        std::unique_ptr<char[]> buffer;
+        u32 capacity;
+        u32 used = 0;
+        bool failed = false;
+
+        // room for one more line and its newline
+        char* reserve(u32 line_max)
+        {
+            if (used + line_max + 1 > capacity) flush();
+            return buffer.get() + used;
+        }
+
+        void commit(u32 length)
+        {
+            buffer[used + length] = '\n';
+            used += length + 1;
+        }
+    };
+}
+
+#endif
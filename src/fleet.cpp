@@ -0,0 +1,154 @@
+#include "fleet.h"
+
+#include <thread>
+
+using namespace emulator6502;
+
+namespace
+{
+    u64 make_range(u32 begin, u32 end)
+    {
+        return begin | ((u64)end << 32);
+    }
+
+    u32 range_begin(u64 range) { return (u32)range; }
+    u32 range_end(u64 range) { return (u32)(range >> 32); }
+
+    // takes the first job of a range, only the owner pops
+    bool pop(std::atomic<u64>& range, u32& job)
+    {
+        u64 current = range.load(std::memory_order_acquire);
+        while (range_begin(current) < range_end(current))
+        {
+            const u64 next = make_range(range_begin(current) + 1, range_end(current));
+            if (range.compare_exchange_weak(current, next, std::memory_order_acq_rel))
+            {
+                job = range_begin(current);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+Fleet::Fleet(u32 threads, s32 slice)
+    : thread_count(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      slice(slice)
+{
+    assert(slice > 0);
+}
+
+std::vector<FleetResult> Fleet::run(const std::vector<FleetJob>& jobs)
+{
+    std::vector<FleetResult> results(jobs.size());
+    cancelled.store(false, std::memory_order_relaxed);
+
+    const u32 workers = std::max(1u, std::min<u32>(thread_count, jobs.size()));
+    std::unique_ptr<Queue[]> queues(new Queue[workers]);
+    for (u32 i = 0; i < workers; i++)
+    {
+        const u32 begin = (u64)jobs.size() * i / workers;
+        const u32 end = (u64)jobs.size() * (i + 1) / workers;
+        queues[i].range.store(make_range(begin, end), std::memory_order_relaxed);
+    }
+
+    // the calling thread is worker 0
+    std::vector<std::thread> threads;
+    for (u32 i = 1; i < workers; i++)
+    {
+        threads.emplace_back(&Fleet::work, this, i, workers, queues.get(), std::cref(jobs), std::ref(results));
+    }
+    work(0, workers, queues.get(), jobs, results);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    return results;
+}
+
+void Fleet::work(u32 worker, u32 workers, Queue* queues, const std::vector<FleetJob>& jobs, std::vector<FleetResult>& results)
+{
+    // one memory per thread, cleared for every job
+    std::unique_ptr<Memory> mem(new Memory());
+    CPU cpu(*mem);
+
+    u32 job;
+    while (pop(queues[worker].range, job) || steal(worker, workers, queues, job))
+    {
+        run_job(cpu, *mem, jobs[job], results[job]);
+    }
+}
+
+// moves the back half of the first non-empty range into the worker's own,
+// which is empty, and takes its first job
+bool Fleet::steal(u32 worker, u32 workers, Queue* queues, u32& job)
+{
+    for (u32 offset = 1; offset < workers; offset++)
+    {
+        std::atomic<u64>& victim = queues[(worker + offset) % workers].range;
+
+        u64 current = victim.load(std::memory_order_acquire);
+        while (range_begin(current) < range_end(current))
+        {
+            const u32 begin = range_begin(current);
+            const u32 end = range_end(current);
+            const u32 middle = end - (end - begin + 1) / 2;
+            if (victim.compare_exchange_weak(current, make_range(begin, middle), std::memory_order_acq_rel))
+            {
+                job = middle;
+                queues[worker].range.store(make_range(middle + 1, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void Fleet::run_job(CPU& cpu, Memory& mem, const FleetJob& job, FleetResult& result)
+{
+    mem.init();
+    mem.map_ram(0x00, 0xFF);
+    const std::span<const byte> image = job.shared_image.empty() ? std::span<const byte>(job.image) : job.shared_image;
+    assert(job.load_address + image.size() <= Memory::MAX_MEMORY);
+    mem.load(job.load_address, image.data(), (u32)image.size());
+
+    cpu.reset(job.PC);
+    cpu.SP = job.SP;
+    cpu.A = job.A;
+    cpu.X = job.X;
+    cpu.Y = job.Y;
+    cpu.PS = job.PS;
+
+    // the cycle check between slices matches one execute over the whole budget
+    s32 remaining = job.cycles;
+    while (remaining > 0)
+    {
+        if (cancelled.load(std::memory_order_relaxed))
+        {
+            result.cancelled = true;
+            break;
+        }
+        const ExecuteResult slice_result = cpu.execute(std::min(remaining, slice));
+        remaining -= slice_result.cycles;
+        result.reason = slice_result.reason;
+        if (slice_result.reason != StopReason::BUDGET)
+        {
+            result.failed = true;
+            break;
+        }
+    }
+
+    result.PC = cpu.PC;
+    result.SP = cpu.SP;
+    result.A = cpu.A;
+    result.X = cpu.X;
+    result.Y = cpu.Y;
+    result.PS = cpu.PS;
+    result.cycles_used = job.cycles - remaining;
+    for (const FleetJob::Range& range : job.capture)
+    {
+        assert(range.start + range.length <= Memory::MAX_MEMORY);
+        result.memory.insert(result.memory.end(), mem.data + range.start, mem.data + range.start + range.length);
+    }
+}
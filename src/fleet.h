@@ -0,0 +1,92 @@
+#ifndef _H_FLEET
+#define _H_FLEET
+
+#include "m6502.h"
+
+#include <atomic>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace emulator6502 {
+
+    // a program and its starting state, run on a CPU/Memory pair of its own
+    struct FleetJob
+    {
+        // copied into zeroed RAM at load_address
+        std::vector<byte> image;
+        // used instead of image when set, for many jobs loading the same
+        // bytes, e.g. a MappedFile (see loader.h) that outlives the run
+        std::span<const byte> shared_image;
+        word load_address = 0;
+
+        word PC = 0;
+        byte SP = 0xFF;
+        byte A = 0, X = 0, Y = 0, PS = 0;
+        s32 cycles = 0;
+
+        // memory copied into the result once the job ends
+        struct Range
+        {
+            word start;
+            u32 length;
+        };
+        std::vector<Range> capture;
+    };
+
+    struct FleetResult
+    {
+        word PC = 0;
+        byte SP = 0;
+        byte A = 0, X = 0, Y = 0, PS = 0;
+        s32 cycles_used = 0;
+        // the capture ranges of the job, back to back
+        std::vector<byte> memory;
+        bool failed = false;    // stopped before the budget ran out, see reason
+        StopReason reason = StopReason::BUDGET; // of the last execute
+        bool cancelled = false; // stopped by Fleet::cancel
+    };
+
+    /**
+     * Runs a batch of independent jobs on a work-stealing set of threads.
+     * The jobs start out split evenly into one index range per thread; a
+     * thread whose range runs dry takes the back half of another thread's
+     * range. Ranges are single atomic words, and each result slot is only
+     * written by the thread that ran its job, so nothing takes a lock.
+     *
+     * Jobs run through CPU::execute in slices, a cancel is noticed between
+     * slices. Results do not depend on the slice or the thread count.
+    */
+    class Fleet
+    {
+    public:
+        // 0 threads uses every hardware thread
+        explicit Fleet(u32 threads = 0, s32 slice = 1 << 16);
+        Fleet(const Fleet&) = delete;
+        Fleet& operator=(const Fleet&) = delete;
+
+        u32 size() const { return thread_count; }
+
+        /** @return one result per job, in job order */
+        std::vector<FleetResult> run(const std::vector<FleetJob>&);
+        // stops a run from another thread, unfinished jobs come back cancelled
+        void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+    private:
+        // [begin, end) of job indices, begin in the low half
+        struct alignas(64) Queue
+        {
+            std::atomic<u64> range;
+        };
+
+        u32 thread_count;
+        s32 slice;
+        std::atomic<bool> cancelled = false;
+
+        void work(u32 worker, u32 workers, Queue* queues, const std::vector<FleetJob>&, std::vector<FleetResult>&);
+        bool steal(u32 worker, u32 workers, Queue* queues, u32& job);
+        void run_job(CPU&, Memory&, const FleetJob&, FleetResult&);
+    };
+}
+
+#endif
@@ -0,0 +1,255 @@
+#include "m6502.h"
+#include "block_cache.h"
+#include "opcodes.h"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <string.h>
+
+// Differential fuzzer of CPU::execute: every input runs through the switch
+// interpreter, stepped one instruction at a time, and through a BlockCache
+// that compiles blocks to native code, where the JIT is available, once
+// they have been entered twice. Registers, flags, cycles, stop reason and
+// every page either run wrote have to agree, a mismatch is reported and
+// aborts.
+//
+// Under clang the target is built with -fsanitize=fuzzer and
+// M6502_LIBFUZZER, and the opcode coverage below is handed to libFuzzer as
+// extra counters. Other compilers get a standalone driver that runs the
+// files given to it, or random inputs:
+//
+//  cpu_fuzz [-n runs] [-s seed] [file...]
+//
+// Input layout: A, X, Y, SP, PS, a budget byte (4 cycles each, plus one),
+// then the program. It is loaded at 0x0200 and into zero page, where
+// indirect operands and BRK (through the zeroed vector) end up.
+
+using namespace emulator6502;
+
+namespace
+{
+    constexpr word PROGRAM_START = 0x0200;
+    constexpr u32 HEADER_SIZE = 6;
+    constexpr u32 MAX_PROGRAM = 0x0100;
+
+    // one counter per opcode, and per opcode that took more than its base
+    // cycles (a crossed page or taken branch)
+#if defined(M6502_LIBFUZZER)
+    __attribute__((used, section("__libfuzzer_extra_counters")))
+#endif
+    byte coverage[256 * 2];
+
+    void count(byte opcode, bool extra_cycles)
+    {
+        byte& counter = coverage[opcode * 2 + extra_cycles];
+        if (counter != 0xFF) counter++;
+    }
+
+    /**
+     * Both CPUs and their memories live for the whole run. The memories
+     * keep a zeroed baseline and only the pages an input dirtied are
+     * copied back between inputs, the block cache drops the blocks of
+     * those pages as they are restored.
+    */
+    class Harness
+    {
+    public:
+        Harness()
+            : reference(reference_mem), candidate(candidate_mem), cache(candidate_mem)
+        {
+            reference_mem.save_baseline();
+            candidate_mem.save_baseline();
+            // compiling costs a few syscalls, far more than running a
+            // short input, so only blocks that loop are compiled
+            cache.enable_jit(2);
+        }
+
+        void run(const byte* data, size_t size)
+        {
+            if (size < HEADER_SIZE) return;
+            const s32 budget = 1 + data[5] * 4;
+            const u32 program_size = std::min<size_t>(size - HEADER_SIZE, MAX_PROGRAM);
+
+            for (Memory* mem : { &reference_mem, &candidate_mem })
+            {
+                mem->load(PROGRAM_START, data + HEADER_SIZE, program_size);
+                mem->load(0x0000, data + HEADER_SIZE, program_size);
+            }
+            for (CPU* cpu : { &reference, &candidate })
+            {
+                cpu->reset(PROGRAM_START);
+                cpu->A = data[0];
+                cpu->X = data[1];
+                cpu->Y = data[2];
+                cpu->SP = data[3];
+                cpu->PS = data[4];
+            }
+
+            const ExecuteResult expected = run_reference(budget);
+            const ExecuteResult actual = candidate.execute(budget, cache);
+            compare(expected, actual, data, size);
+
+            reference_mem.restore_baseline();
+            candidate_mem.restore_baseline();
+        }
+
+    private:
+        Memory reference_mem;
+        Memory candidate_mem;
+        CPU reference;
+        CPU candidate;
+        BlockCache cache;
+
+        // the same instructions execute(budget) would run, one at a time to
+        // see what each of them cost
+        ExecuteResult run_reference(s32 budget)
+        {
+            ExecuteResult total = { 0, StopReason::BUDGET, reference.PC, 0 };
+            while (total.cycles < budget)
+            {
+                const byte opcode = reference_mem.peek(reference.PC);
+                const ExecuteResult step = reference.execute_switch(1);
+                total.cycles += step.cycles;
+                total.reason = step.reason;
+                total.PC = step.PC;
+                total.opcode = step.opcode;
+                if (step.reason != StopReason::BUDGET) break;
+                count(opcode, step.cycles > opcode_info[opcode].cycles);
+            }
+            return total;
+        }
+
+        void compare(const ExecuteResult& expected, const ExecuteResult& actual, const byte* data, size_t size)
+        {
+            bool same = expected.cycles == actual.cycles && expected.reason == actual.reason
+                && reference.PC == candidate.PC && reference.A == candidate.A
+                && reference.X == candidate.X && reference.Y == candidate.Y
+                && reference.SP == candidate.SP && reference.PS == candidate.PS;
+
+            u32 page = 0;
+            for (; same && page < Memory::PAGE_COUNT; page++)
+            {
+                if (!reference_mem.is_dirty(page) && !candidate_mem.is_dirty(page)) continue;
+                const u32 offset = page * Memory::PAGE_SIZE;
+                same = memcmp(reference_mem.data + offset, candidate_mem.data + offset, Memory::PAGE_SIZE) == 0;
+            }
+            if (same) return;
+
+            fprintf(stderr, "engines disagree on input:");
+            for (size_t i = 0; i < size; i++)
+            {
+                fprintf(stderr, " %02X", data[i]);
+            }
+            fprintf(stderr, "\n");
+            report("switch", reference, expected);
+            report("blocks", candidate, actual);
+            if (page) fprintf(stderr, "memory differs in page %02X\n", page - 1);
+            abort();
+        }
+
+        static void report(const char* name, const CPU& cpu, const ExecuteResult& result)
+        {
+            fprintf(stderr, "%-6s cycles %d reason %d PC %04X A %02X X %02X Y %02X SP %02X PS %02X\n",
+                name, result.cycles, (int)result.reason, cpu.PC, cpu.A, cpu.X, cpu.Y, cpu.SP, cpu.PS);
+        }
+    };
+
+    Harness& harness()
+    {
+        static Harness instance;
+        return instance;
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    harness().run(data, size);
+    return 0;
+}
+
+#if !defined(M6502_LIBFUZZER)
+namespace
+{
+    bool run_file(const char* path)
+    {
+        FILE* file = fopen(path, "rb");
+        if (!file)
+        {
+            fprintf(stderr, "cannot open %s\n", path);
+            return false;
+        }
+        std::vector<byte> input(HEADER_SIZE + MAX_PROGRAM);
+        input.resize(fread(input.data(), 1, input.size(), file));
+        fclose(file);
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    u64 runs = 1'000'000;
+    u64 seed = 1;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            runs = strtoull(argv[++i], nullptr, 0);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], nullptr, 0);
+        }
+        else if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "usage: %s [-n runs] [-s seed] [file...]\n", argv[0]);
+            return 1;
+        }
+        else
+        {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (!files.empty())
+    {
+        for (const char* path : files)
+        {
+            if (!run_file(path)) return 1;
+        }
+        printf("%zu inputs agree\n", files.size());
+        return 0;
+    }
+
+    // short random programs, most of them run into an unknown opcode
+    // within a few instructions like the fuzzer's early inputs do
+    std::mt19937_64 random(seed);
+    byte input[HEADER_SIZE + 64];
+    const auto start = std::chrono::steady_clock::now();
+    for (u64 run = 0; run < runs; run++)
+    {
+        const u64 bits = random();
+        const size_t size = HEADER_SIZE + (bits & 63);
+        for (size_t i = 0; i < size; i += 8)
+        {
+            const u64 chunk = random();
+            memcpy(input + i, &chunk, std::min<size_t>(8, sizeof(input) - i));
+        }
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    u32 opcodes = 0, extra = 0;
+    for (u32 opcode = 0; opcode < 256; opcode++)
+    {
+        opcodes += coverage[opcode * 2] != 0;
+        extra += coverage[opcode * 2 + 1] != 0;
+    }
+    printf("%llu runs agree in %.2f s, %.0f runs/s\n", runs, seconds, runs / seconds);
+    printf("covered %u opcodes, %u of them with extra cycles\n", opcodes, extra);
+    return 0;
+}
+#endif
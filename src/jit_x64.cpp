@@ -0,0 +1,931 @@
+#include "jit_x64.h"
+#include "alu.h"
+#include "opcodes.h"
+
+#if M6502_HAS_JIT
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace emulator6502;
+
+namespace
+{
+    enum Reg { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+    // the block keeps its state pointer and the guest registers in callee
+    // saved registers, calls into Memory leave them alone
+    constexpr Reg STATE = RBX, REG_A = R12, REG_X = R13, REG_Y = R14, REG_PS = R15, REG_SP = RBP;
+
+    enum Condition : byte { CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5 };
+    enum Alu : byte { ADD = 0, OR = 1, AND = 4, SUB = 5, XOR = 6, CMP = 7 };
+
+    constexpr s32 OFF_PC = offsetof(JitState, PC);
+    constexpr s32 OFF_A = offsetof(JitState, A);
+    constexpr s32 OFF_X = offsetof(JitState, X);
+    constexpr s32 OFF_Y = offsetof(JitState, Y);
+    constexpr s32 OFF_SP = offsetof(JitState, SP);
+    constexpr s32 OFF_PS = offsetof(JitState, PS);
+    constexpr s32 OFF_CYCLES = offsetof(JitState, cycles);
+    constexpr s32 OFF_READ_PAGES = offsetof(JitState, read_pages);
+    constexpr s32 OFF_WRITE_PAGES = offsetof(JitState, write_pages);
+    constexpr s32 OFF_DIRTY = offsetof(JitState, dirty_pages);
+    constexpr s32 OFF_MEM = offsetof(JitState, mem);
+    constexpr s32 OFF_INVALIDATED = offsetof(JitState, invalidated);
+    constexpr s32 OFF_READ = offsetof(JitState, read);
+    constexpr s32 OFF_WRITE = offsetof(JitState, write);
+    constexpr s32 OFF_ADC_TABLE = offsetof(JitState, adc_table);
+    constexpr s32 OFF_ADC = offsetof(JitState, adc);
+    constexpr s32 OFF_SBC = offsetof(JitState, sbc);
+
+    //~~~~~~~~~~~~~~~~~Opcodes~~~~~~~~~~~~~~~~~
+
+    enum Kind : byte
+    {
+        NONE, LOAD, AND_A, EOR_A, ORA_A, STORE,
+        JSR, RTS, JMP_ABS, JMP_I, TSX, TXS, PHA, PHP, PLA, PLP,
+        ADC, SBC, COMPARE, INCREMENT, DECREMENT, TRANSFER,
+        SET_FLAG, CLEAR_FLAG, BRANCH,
+    };
+
+    enum Mode : byte { IMPLIED, IM, ZP, ZPX, ZPY, ABS, AX, AY, AXP, AYP, IX, IY, IYP, REL };
+
+    // native implementation of an opcode, its cost comes from opcode_info
+    struct JitOp
+    {
+        Kind kind = NONE;
+        Mode mode = IMPLIED;
+        Reg reg = RAX;
+        Reg source = RAX; // TRANSFER copies source into reg
+        byte flag = 0;    // of SET_FLAG, CLEAR_FLAG and the flag a BRANCH tests
+        bool set = false; // a BRANCH is taken when flag is set
+    };
+
+    constexpr std::array<JitOp, 256> make_jit_ops()
+    {
+        std::array<JitOp, 256> t{};
+
+        // LDA
+        t[CPU::INS_LDA_IM]  = { LOAD, IM,  REG_A };
+        t[CPU::INS_LDA_ZP]  = { LOAD, ZP,  REG_A };
+        t[CPU::INS_LDA_ZPX] = { LOAD, ZPX, REG_A };
+        t[CPU::INS_LDA_ABS] = { LOAD, ABS, REG_A };
+        t[CPU::INS_LDA_AX]  = { LOAD, AXP, REG_A };
+        t[CPU::INS_LDA_AY]  = { LOAD, AYP, REG_A };
+        t[CPU::INS_LDA_IX]  = { LOAD, IX,  REG_A };
+        t[CPU::INS_LDA_IY]  = { LOAD, IYP, REG_A };
+        // LDX
+        t[CPU::INS_LDX_IM]  = { LOAD, IM,  REG_X };
+        t[CPU::INS_LDX_ZP]  = { LOAD, ZP,  REG_X };
+        t[CPU::INS_LDX_ZPY] = { LOAD, ZPY, REG_X };
+        t[CPU::INS_LDX_ABS] = { LOAD, ABS, REG_X };
+        t[CPU::INS_LDX_AY]  = { LOAD, AYP, REG_X };
+        // LDY
+        t[CPU::INS_LDY_IM]  = { LOAD, IM,  REG_Y };
+        t[CPU::INS_LDY_ZP]  = { LOAD, ZP,  REG_Y };
+        t[CPU::INS_LDY_ZPX] = { LOAD, ZPX, REG_Y };
+        t[CPU::INS_LDY_ABS] = { LOAD, ABS, REG_Y };
+        t[CPU::INS_LDY_AX]  = { LOAD, AXP, REG_Y };
+        // STA
+        t[CPU::INS_STA_ZP]  = { STORE, ZP,  REG_A };
+        t[CPU::INS_STA_ZPX] = { STORE, ZPX, REG_A };
+        t[CPU::INS_STA_ABS] = { STORE, ABS, REG_A };
+        t[CPU::INS_STA_AX]  = { STORE, AX,  REG_A };
+        t[CPU::INS_STA_AY]  = { STORE, AY,  REG_A };
+        t[CPU::INS_STA_IX]  = { STORE, IX,  REG_A };
+        t[CPU::INS_STA_IY]  = { STORE, IY,  REG_A };
+        // STX
+        t[CPU::INS_STX_ZP]  = { STORE, ZP,  REG_X };
+        t[CPU::INS_STX_ZPY] = { STORE, ZPY, REG_X };
+        t[CPU::INS_STX_ABS] = { STORE, ABS, REG_X };
+        // STY
+        t[CPU::INS_STY_ZP]  = { STORE, ZP,  REG_Y };
+        t[CPU::INS_STY_ZPX] = { STORE, ZPX, REG_Y };
+        t[CPU::INS_STY_ABS] = { STORE, ABS, REG_Y };
+        // Jumps and Returns
+        t[CPU::INS_JSR]     = { JSR,     ABS,     RAX };
+        t[CPU::INS_RTS]     = { RTS,     IMPLIED, RAX };
+        t[CPU::INS_JMP_ABS] = { JMP_ABS, ABS,     RAX };
+        t[CPU::INS_JMP_I]   = { JMP_I,   ABS,     RAX };
+        // Stack Operations
+        t[CPU::INS_TSX]     = { TSX, IMPLIED, RAX };
+        t[CPU::INS_TXS]     = { TXS, IMPLIED, RAX };
+        t[CPU::INS_PHA]     = { PHA, IMPLIED, RAX };
+        t[CPU::INS_PHP]     = { PHP, IMPLIED, RAX };
+        t[CPU::INS_PLA]     = { PLA, IMPLIED, RAX };
+        t[CPU::INS_PLP]     = { PLP, IMPLIED, RAX };
+        // CPX, CPY
+        t[CPU::INS_CPX_IM]  = { COMPARE, IM,  REG_X };
+        t[CPU::INS_CPX_ZP]  = { COMPARE, ZP,  REG_X };
+        t[CPU::INS_CPX_ABS] = { COMPARE, ABS, REG_X };
+        t[CPU::INS_CPY_IM]  = { COMPARE, IM,  REG_Y };
+        t[CPU::INS_CPY_ZP]  = { COMPARE, ZP,  REG_Y };
+        t[CPU::INS_CPY_ABS] = { COMPARE, ABS, REG_Y };
+        // Increments and Decrements of registers
+        t[CPU::INS_INX]     = { INCREMENT, IMPLIED, REG_X };
+        t[CPU::INS_INY]     = { INCREMENT, IMPLIED, REG_Y };
+        t[CPU::INS_DEX]     = { DECREMENT, IMPLIED, REG_X };
+        t[CPU::INS_DEY]     = { DECREMENT, IMPLIED, REG_Y };
+        // Register Transfers
+        t[CPU::INS_TAX]     = { TRANSFER, IMPLIED, REG_X, REG_A };
+        t[CPU::INS_TAY]     = { TRANSFER, IMPLIED, REG_Y, REG_A };
+        t[CPU::INS_TXA]     = { TRANSFER, IMPLIED, REG_A, REG_X };
+        t[CPU::INS_TYA]     = { TRANSFER, IMPLIED, REG_A, REG_Y };
+        // Status Flag Changes
+        t[CPU::INS_CLC]     = { CLEAR_FLAG, IMPLIED, RAX, RAX, FLAG_C };
+        t[CPU::INS_CLD]     = { CLEAR_FLAG, IMPLIED, RAX, RAX, FLAG_D };
+        t[CPU::INS_CLI]     = { CLEAR_FLAG, IMPLIED, RAX, RAX, FLAG_I };
+        t[CPU::INS_CLV]     = { CLEAR_FLAG, IMPLIED, RAX, RAX, FLAG_V };
+        t[CPU::INS_SEC]     = { SET_FLAG,   IMPLIED, RAX, RAX, FLAG_C };
+        t[CPU::INS_SED]     = { SET_FLAG,   IMPLIED, RAX, RAX, FLAG_D };
+        t[CPU::INS_SEI]     = { SET_FLAG,   IMPLIED, RAX, RAX, FLAG_I };
+        // Branches
+        t[CPU::INS_BCC]     = { BRANCH, REL, RAX, RAX, FLAG_C, false };
+        t[CPU::INS_BCS]     = { BRANCH, REL, RAX, RAX, FLAG_C, true };
+        t[CPU::INS_BNE]     = { BRANCH, REL, RAX, RAX, FLAG_Z, false };
+        t[CPU::INS_BEQ]     = { BRANCH, REL, RAX, RAX, FLAG_Z, true };
+        t[CPU::INS_BPL]     = { BRANCH, REL, RAX, RAX, FLAG_N, false };
+        t[CPU::INS_BMI]     = { BRANCH, REL, RAX, RAX, FLAG_N, true };
+        t[CPU::INS_BVC]     = { BRANCH, REL, RAX, RAX, FLAG_V, false };
+        t[CPU::INS_BVS]     = { BRANCH, REL, RAX, RAX, FLAG_V, true };
+
+        // logical, arithmetic and CMP, same modes as LDA
+        const byte same_as_lda[][8] = {
+            { CPU::INS_AND_IM, CPU::INS_AND_ZP, CPU::INS_AND_ZPX, CPU::INS_AND_ABS,
+              CPU::INS_AND_AX, CPU::INS_AND_AY, CPU::INS_AND_IX, CPU::INS_AND_IY },
+            { CPU::INS_EOR_IM, CPU::INS_EOR_ZP, CPU::INS_EOR_ZPX, CPU::INS_EOR_ABS,
+              CPU::INS_EOR_AX, CPU::INS_EOR_AY, CPU::INS_EOR_IX, CPU::INS_EOR_IY },
+            { CPU::INS_ORA_IM, CPU::INS_ORA_ZP, CPU::INS_ORA_ZPX, CPU::INS_ORA_ABS,
+              CPU::INS_ORA_AX, CPU::INS_ORA_AY, CPU::INS_ORA_IX, CPU::INS_ORA_IY },
+            { CPU::INS_ADC_IM, CPU::INS_ADC_ZP, CPU::INS_ADC_ZPX, CPU::INS_ADC_ABS,
+              CPU::INS_ADC_AX, CPU::INS_ADC_AY, CPU::INS_ADC_IX, CPU::INS_ADC_IY },
+            { CPU::INS_SBC_IM, CPU::INS_SBC_ZP, CPU::INS_SBC_ZPX, CPU::INS_SBC_ABS,
+              CPU::INS_SBC_AX, CPU::INS_SBC_AY, CPU::INS_SBC_IX, CPU::INS_SBC_IY },
+            { CPU::INS_CMP_IM, CPU::INS_CMP_ZP, CPU::INS_CMP_ZPX, CPU::INS_CMP_ABS,
+              CPU::INS_CMP_AX, CPU::INS_CMP_AY, CPU::INS_CMP_IX, CPU::INS_CMP_IY },
+        };
+        const byte lda[8] = {
+            CPU::INS_LDA_IM, CPU::INS_LDA_ZP, CPU::INS_LDA_ZPX, CPU::INS_LDA_ABS,
+            CPU::INS_LDA_AX, CPU::INS_LDA_AY, CPU::INS_LDA_IX, CPU::INS_LDA_IY,
+        };
+        const Kind kinds[] = { AND_A, EOR_A, ORA_A, ADC, SBC, COMPARE };
+        for (u32 group = 0; group < 6; group++)
+        {
+            for (u32 i = 0; i < 8; i++)
+            {
+                t[same_as_lda[group][i]] = t[lda[i]];
+                t[same_as_lda[group][i]].kind = kinds[group];
+            }
+        }
+
+        return t;
+    }
+
+    constexpr std::array<JitOp, 256> jit_ops = make_jit_ops();
+
+    // a taken branch pays the page crossing cycle on top of the taken one
+    constexpr bool has_page_cycle(Mode mode)
+    {
+        return mode == AXP || mode == AYP || mode == IYP || mode == REL;
+    }
+
+    constexpr AddressMode address_mode(Mode mode)
+    {
+        constexpr AddressMode modes[] = {
+            AddressMode::IMPLIED, AddressMode::IMMEDIATE, AddressMode::ZERO_PAGE,
+            AddressMode::ZERO_PAGE_X, AddressMode::ZERO_PAGE_Y, AddressMode::ABSOLUTE,
+            AddressMode::ABSOLUTE_X, AddressMode::ABSOLUTE_Y, AddressMode::ABSOLUTE_X,
+            AddressMode::ABSOLUTE_Y, AddressMode::INDIRECT_X, AddressMode::INDIRECT_Y,
+            AddressMode::INDIRECT_Y, AddressMode::RELATIVE,
+        };
+        return modes[mode];
+    }
+
+    // the native blocks charge opcode_info cycles, their modes and page
+    // crossing cycles have to match it. JMP (ind) reads its pointer as ABS.
+    constexpr bool jit_ops_match_opcode_info()
+    {
+        for (u32 opcode = 0; opcode < 256; opcode++)
+        {
+            const JitOp& op = jit_ops[opcode];
+            const OpInfo& info = opcode_info[opcode];
+            if (op.kind == NONE) continue;
+            if (!info.implemented() || has_page_cycle(op.mode) != (info.page_penalty != 0)) return false;
+            if (op.kind != JMP_I && address_mode(op.mode) != info.mode) return false;
+        }
+        return true;
+    }
+    static_assert(jit_ops_match_opcode_info());
+
+    bool writes_memory(Kind kind)
+    {
+        return kind == STORE || kind == PHA || kind == PHP || kind == JSR;
+    }
+
+    bool sets_pc(Kind kind)
+    {
+        return kind == JSR || kind == RTS || kind == JMP_ABS || kind == JMP_I || kind == BRANCH;
+    }
+
+    //~~~~~~~~~~~~~~~~~Encoding~~~~~~~~~~~~~~~~~
+
+    // just the x86-64 encodings the block compiler needs, 32 bit operand
+    // size unless wide is set
+    class Emitter
+    {
+    public:
+        explicit Emitter(std::vector<byte>& out)
+            : out(out)
+        {}
+
+        u32 here() const { return (u32)out.size(); }
+        void emit(byte value) { out.push_back(value); }
+
+        void emit32(u32 value)
+        {
+            for (u32 i = 0; i < 4; i++)
+            {
+                emit(value >> (i * 8));
+            }
+        }
+
+        // byte_regs forces a REX prefix so 4-7 mean spl/bpl/sil/dil
+        void rex(bool wide, int reg, int index, int base, bool force = false)
+        {
+            const byte value = 0x40 | (wide << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+            if (value != 0x40 || force) emit(value);
+        }
+
+        // op reg, rm (register)
+        void rr(std::initializer_list<byte> opcode, int reg, int rm, bool wide = false, bool byte_regs = false)
+        {
+            rex(wide, reg, 0, rm, byte_regs && ((reg >= 4 && reg < 8) || (rm >= 4 && rm < 8)));
+            for (byte b : opcode) emit(b);
+            emit(0xC0 | ((reg & 7) << 3) | (rm & 7));
+        }
+
+        // op reg, [base + disp32]
+        void rm(std::initializer_list<byte> opcode, int reg, int base, s32 disp, bool wide = false, bool byte_regs = false)
+        {
+            rex(wide, reg, 0, base, byte_regs && reg >= 4 && reg < 8);
+            for (byte b : opcode) emit(b);
+            emit(0x80 | ((reg & 7) << 3) | (base & 7));
+            if ((base & 7) == RSP) emit(0x24);
+            emit32(disp);
+        }
+
+        // op reg, [base + index << scale], base can not be rbp or r13
+        void rsib(std::initializer_list<byte> opcode, int reg, int base, int index, int scale, bool wide = false, bool byte_regs = false)
+        {
+            rex(wide, reg, index, base, byte_regs && reg >= 4 && reg < 8);
+            for (byte b : opcode) emit(b);
+            emit(((reg & 7) << 3) | 4);
+            emit((scale << 6) | ((index & 7) << 3) | (base & 7));
+        }
+
+        void mov_imm(int reg, u32 value)
+        {
+            rex(false, 0, 0, reg);
+            emit(0xB8 + (reg & 7));
+            emit32(value);
+        }
+
+        void mov(int dst, int src) { rr({ 0x89 }, src, dst); }
+        void alu(Alu op, int reg, u32 value)
+        {
+            rex(false, 0, 0, reg);
+            emit(0x81);
+            emit(0xC0 | (op << 3) | (reg & 7));
+            emit32(value);
+        }
+        void add(int dst, int src) { rr({ 0x01 }, src, dst); }
+        void sub(int dst, int src) { rr({ 0x29 }, src, dst); }
+        void or_(int dst, int src) { rr({ 0x09 }, src, dst); }
+        void and_(int dst, int src) { rr({ 0x21 }, src, dst); }
+        void xor_(int dst, int src) { rr({ 0x31 }, src, dst); }
+        void test(int a, int b, bool wide = false) { rr({ 0x85 }, b, a, wide); }
+        void shift(int ext, int reg, byte count)
+        {
+            rex(false, 0, 0, reg);
+            emit(0xC1);
+            emit(0xC0 | (ext << 3) | (reg & 7));
+            emit(count);
+        }
+        void shl(int reg, byte count) { shift(4, reg, count); }
+        void shr(int reg, byte count) { shift(5, reg, count); }
+        void movzx8(int dst, int src) { rr({ 0x0F, 0xB6 }, dst, src, false, true); }
+        void movzx16(int dst, int src) { rr({ 0x0F, 0xB7 }, dst, src); }
+        void setcc(Condition cc, int reg) { rr({ 0x0F, (byte)(0x90 | cc) }, 0, reg, false, true); }
+
+        void push(int reg) { rex(false, 0, 0, reg); emit(0x50 + (reg & 7)); }
+        void pop(int reg) { rex(false, 0, 0, reg); emit(0x58 + (reg & 7)); }
+        void ret() { emit(0xC3); }
+
+        u32 jcc(Condition cc)
+        {
+            emit(0x0F);
+            emit(0x80 | cc);
+            emit32(0);
+            return here() - 4;
+        }
+
+        u32 jmp()
+        {
+            emit(0xE9);
+            emit32(0);
+            return here() - 4;
+        }
+
+        void bind(u32 fixup) { bind(fixup, here()); }
+        void bind(u32 fixup, u32 target)
+        {
+            const u32 rel = target - (fixup + 4);
+            std::memcpy(out.data() + fixup, &rel, sizeof(rel));
+        }
+
+    private:
+        std::vector<byte>& out;
+    };
+
+    //~~~~~~~~~~~~~~~~~Code Generation~~~~~~~~~~~~~~~~~
+
+    byte jit_read(Memory* mem, word address)
+    {
+        return mem->read(address);
+    }
+
+    void jit_write(Memory* mem, word address, byte value)
+    {
+        mem->write(address, value);
+    }
+
+    // decimal mode ADC and SBC, binary mode is looked up inline
+    word jit_adc(byte a, byte value, byte ps)
+    {
+        return alu_adc(a, value, ps);
+    }
+
+    word jit_sbc(byte a, byte value, byte ps)
+    {
+        return alu_sbc(a, value, ps);
+    }
+
+    class BlockCompiler
+    {
+    public:
+        explicit BlockCompiler(std::vector<byte>& out)
+            : e(out)
+        {}
+
+        // early exit taken after a write dropped blocks
+        struct Exit
+        {
+            u32 fixup;
+            word next_pc;
+            s32 refund;
+        };
+
+        void prologue(s32 cycles)
+        {
+            for (int reg : { RBX, RBP, R12, R13, R14, R15 }) e.push(reg);
+            // three scratch slots, keeps rsp 16 byte aligned for calls
+            e.emit(0x48); e.emit(0x83); e.emit(0xEC); e.emit(0x18);
+            e.rr({ 0x89 }, RDI, STATE, true);
+
+            load8(REG_A, OFF_A);
+            load8(REG_X, OFF_X);
+            load8(REG_Y, OFF_Y);
+            load8(REG_SP, OFF_SP);
+            load8(REG_PS, OFF_PS);
+
+            // charged up front, a dynamic page cycle is charged where it happens
+            e.rm({ 0x81 }, SUB, STATE, OFF_CYCLES);
+            e.emit32(cycles);
+        }
+
+        void epilogue()
+        {
+            store8(OFF_A, REG_A);
+            store8(OFF_X, REG_X);
+            store8(OFF_Y, REG_Y);
+            store8(OFF_SP, REG_SP);
+            store8(OFF_PS, REG_PS);
+
+            e.emit(0x48); e.emit(0x83); e.emit(0xC4); e.emit(0x18);
+            for (int reg : { R15, R14, R13, R12, RBP, RBX }) e.pop(reg);
+            e.ret();
+        }
+
+        void store_pc(word pc)
+        {
+            e.mov_imm(RAX, pc);
+            store_pc_from_eax();
+        }
+
+        void exit_stub(const Exit& exit, u32 epilogue_start)
+        {
+            e.bind(exit.fixup);
+            e.rm({ 0x81 }, ADD, STATE, OFF_CYCLES);
+            e.emit32(exit.refund);
+            store_pc(exit.next_pc);
+            e.bind(e.jmp(), epilogue_start);
+        }
+
+        u32 here() const { return e.here(); }
+
+        // native code of one instruction at pc
+        void instruction(const JitOp& op, word operand, word pc)
+        {
+            switch (op.kind)
+            {
+            case LOAD:
+                value(op.mode, operand);
+                e.mov(op.reg, RAX);
+                set_nz(op.reg);
+                break;
+            case AND_A:
+                value(op.mode, operand);
+                e.and_(REG_A, RAX);
+                set_nz(REG_A);
+                break;
+            case EOR_A:
+                value(op.mode, operand);
+                e.xor_(REG_A, RAX);
+                set_nz(REG_A);
+                break;
+            case ORA_A:
+                value(op.mode, operand);
+                e.or_(REG_A, RAX);
+                set_nz(REG_A);
+                break;
+            case STORE:
+                address(op.mode, operand);
+                e.mov(RSI, op.reg);
+                write();
+                break;
+            case JSR:
+            {
+                // return address - 1, high byte first
+                const word return_addr = pc + 2;
+                push_imm(return_addr >> 8);
+                push_imm(return_addr & 0xFF);
+                store_pc(operand);
+                break;
+            }
+            case RTS:
+                pull();
+                store_slot(0, RAX);
+                pull();
+                e.shl(RAX, 8);
+                e.rm({ 0x0B }, RAX, RSP, 0); // or eax, [rsp]
+                e.alu(ADD, RAX, 1);
+                e.movzx16(RAX, RAX);
+                store_pc_from_eax();
+                break;
+            case JMP_ABS:
+                store_pc(operand);
+                break;
+            case JMP_I:
+                e.mov_imm(RAX, operand);
+                read_word();
+                store_pc_from_eax();
+                break;
+            case TSX:
+                e.mov(REG_X, REG_SP);
+                set_nz(REG_X);
+                break;
+            case TXS:
+                e.mov(REG_SP, REG_X);
+                break;
+            case PHA:
+            case PHP:
+                stack_address();
+                e.mov(RSI, op.kind == PHA ? REG_A : REG_PS);
+                if (op.kind == PHP) e.alu(OR, RSI, FLAG_B | FLAG_U);
+                write();
+                adjust_sp(SUB, 1);
+                break;
+            case PLA:
+                pull();
+                e.mov(REG_A, RAX);
+                set_nz(REG_A);
+                break;
+            case PLP:
+                pull();
+                e.mov(REG_PS, RAX);
+                break;
+            case ADC:
+            case SBC:
+                value(op.mode, operand);
+                arithmetic(op.kind == SBC);
+                break;
+            case COMPARE:
+                value(op.mode, operand);
+                // C is set when reg >= value, N and Z come from reg - value
+                e.mov(RCX, op.reg);
+                e.sub(RCX, RAX);
+                e.setcc(CC_AE, RDX);
+                e.movzx8(RDX, RDX);
+                e.alu(AND, REG_PS, ~FLAG_C & 0xFF);
+                e.or_(REG_PS, RDX);
+                e.movzx8(RAX, RCX);
+                set_nz(RAX);
+                break;
+            case INCREMENT:
+            case DECREMENT:
+                e.alu(op.kind == INCREMENT ? ADD : SUB, op.reg, 1);
+                e.alu(AND, op.reg, 0xFF);
+                set_nz(op.reg);
+                break;
+            case TRANSFER:
+                e.mov(op.reg, op.source);
+                set_nz(op.reg);
+                break;
+            case SET_FLAG:
+                e.alu(OR, REG_PS, op.flag);
+                break;
+            case CLEAR_FLAG:
+                e.alu(AND, REG_PS, ~op.flag & 0xFF);
+                break;
+            case BRANCH:
+            {
+                // whether the target crosses a page is known here, only
+                // whether the branch is taken is not
+                const word next_pc = pc + 2;
+                const word target = next_pc + (signed char)operand;
+                store_pc(next_pc);
+                e.mov(RCX, REG_PS);
+                e.alu(AND, RCX, op.flag);
+                const u32 not_taken = e.jcc(op.set ? CC_E : CC_NE);
+                e.rm({ 0x81 }, SUB, STATE, OFF_CYCLES);
+                e.emit32(1 + ((next_pc ^ target) >> 8 != 0));
+                store_pc(target);
+                e.bind(not_taken);
+                break;
+            }
+            case NONE:
+                break;
+            }
+        }
+
+        // jumps to the returned fixup when a write of the instruction dropped blocks
+        u32 check_invalidated()
+        {
+            e.rm({ 0x8B }, RAX, STATE, OFF_INVALIDATED, true);
+            // cmp byte [rax], 0
+            e.rm({ 0x80 }, 7, RAX, 0);
+            e.emit(0);
+            return e.jcc(CC_NE);
+        }
+
+    private:
+        Emitter e;
+
+        void load8(int reg, s32 offset) { e.rm({ 0x0F, 0xB6 }, reg, STATE, offset); }
+        void store8(s32 offset, int reg) { e.rm({ 0x88 }, reg, STATE, offset, false, true); }
+        void load_slot(int reg, u32 slot) { e.rm({ 0x8B }, reg, RSP, slot * 8); }
+        void store_slot(u32 slot, int reg) { e.rm({ 0x89 }, reg, RSP, slot * 8); }
+
+        void store_pc_from_eax()
+        {
+            e.emit(0x66);
+            e.rm({ 0x89 }, RAX, STATE, OFF_PC);
+        }
+
+        // charges one cycle when the flag in ecx is set
+        void charge_ecx()
+        {
+            e.movzx8(RCX, RCX);
+            e.rm({ 0x29 }, RCX, STATE, OFF_CYCLES);
+        }
+
+        void set_nz(int reg)
+        {
+            e.alu(AND, REG_PS, ~(FLAG_Z | FLAG_N) & 0xFF);
+            e.mov(RCX, reg);
+            e.alu(AND, RCX, FLAG_N);
+            e.or_(REG_PS, RCX);
+            e.test(reg, reg);
+            e.setcc(CC_E, RCX);
+            e.movzx8(RCX, RCX);
+            e.add(RCX, RCX);
+            e.or_(REG_PS, RCX);
+        }
+
+        void stack_address()
+        {
+            e.mov(RAX, REG_SP);
+            e.alu(OR, RAX, 0x100);
+        }
+
+        void adjust_sp(Alu op, u32 amount)
+        {
+            e.alu(op, REG_SP, amount);
+            e.alu(AND, REG_SP, 0xFF);
+        }
+
+        void push_imm(byte value)
+        {
+            stack_address();
+            e.mov_imm(RSI, value);
+            write();
+            adjust_sp(SUB, 1);
+        }
+
+        // eax = byte pulled from the stack
+        void pull()
+        {
+            adjust_sp(ADD, 1);
+            stack_address();
+            read();
+        }
+
+        // A and the N, V, Z and C flags from ADC or SBC of eax, binary mode
+        // through the alu_tables entry, decimal mode through a call
+        void arithmetic(bool subtract)
+        {
+            e.mov(RSI, RAX);
+            e.mov(RCX, REG_PS);
+            e.alu(AND, RCX, FLAG_D);
+            const u32 decimal = e.jcc(CC_NE);
+
+            // SBC is an ADC of the complemented value
+            if (subtract) e.alu(XOR, RAX, 0xFF);
+            e.mov(RCX, REG_PS);
+            e.alu(AND, RCX, FLAG_C);
+            e.shl(RCX, 16);
+            e.mov(RDX, REG_A);
+            e.shl(RDX, 8);
+            e.or_(RCX, RDX);
+            e.or_(RCX, RAX);
+            e.rm({ 0x8B }, RDX, STATE, OFF_ADC_TABLE, true);
+            e.rsib({ 0x0F, 0xB7 }, RAX, RDX, RCX, 1);
+            const u32 done = e.jmp();
+
+            e.bind(decimal);
+            e.mov(RDI, REG_A);
+            e.mov(RDX, REG_PS);
+            e.rm({ 0xFF }, 2, STATE, subtract ? OFF_SBC : OFF_ADC);
+            e.movzx16(RAX, RAX);
+            e.bind(done);
+
+            e.mov(REG_A, RAX);
+            e.alu(AND, REG_A, 0xFF);
+            e.shr(RAX, 8);
+            e.alu(AND, REG_PS, ~ALU_FLAGS & 0xFF);
+            e.or_(REG_PS, RAX);
+        }
+
+        // eax = operand of a read instruction
+        void value(Mode mode, word operand)
+        {
+            if (mode == IM)
+            {
+                e.mov_imm(RAX, operand & 0xFF);
+                return;
+            }
+            address(mode, operand);
+            read();
+        }
+
+        // eax = effective address
+        void address(Mode mode, word operand)
+        {
+            switch (mode)
+            {
+            case ZP:
+            case ABS:
+                e.mov_imm(RAX, operand);
+                break;
+            case ZPX:
+            case ZPY:
+                e.mov(RAX, mode == ZPX ? REG_X : REG_Y);
+                e.alu(ADD, RAX, operand);
+                e.movzx8(RAX, RAX);
+                break;
+            case AX:
+            case AY:
+            case AXP:
+            case AYP:
+                e.mov(RAX, mode == AX || mode == AXP ? REG_X : REG_Y);
+                e.alu(ADD, RAX, operand);
+                e.movzx16(RAX, RAX);
+                if (mode == AXP || mode == AYP)
+                {
+                    e.mov(RCX, RAX);
+                    e.alu(XOR, RCX, operand);
+                    e.shr(RCX, 8);
+                    e.test(RCX, RCX);
+                    e.setcc(CC_NE, RCX);
+                    charge_ecx();
+                }
+                break;
+            case IX:
+                e.mov(RAX, REG_X);
+                e.alu(ADD, RAX, operand);
+                e.movzx8(RAX, RAX);
+                read_word();
+                break;
+            case IY:
+            case IYP:
+                e.mov_imm(RAX, operand & 0xFF);
+                read_word();
+                if (mode == IYP)
+                {
+                    store_slot(0, RAX);
+                }
+                e.add(RAX, REG_Y);
+                e.movzx16(RAX, RAX);
+                if (mode == IYP)
+                {
+                    e.mov(RCX, RAX);
+                    e.rm({ 0x33 }, RCX, RSP, 0); // xor ecx, [rsp]
+                    e.shr(RCX, 8);
+                    e.test(RCX, RCX);
+                    e.setcc(CC_NE, RCX);
+                    charge_ecx();
+                }
+                break;
+            case IMPLIED:
+            case IM:
+            case REL:
+                break;
+            }
+        }
+
+        // eax = byte at address eax
+        void read()
+        {
+            e.mov(RCX, RAX);
+            e.shr(RCX, 8);
+            e.rm({ 0x8B }, RDX, STATE, OFF_READ_PAGES, true);
+            e.rsib({ 0x8B }, RDX, RDX, RCX, 3, true);
+            e.test(RDX, RDX, true);
+            const u32 slow = e.jcc(CC_E);
+            e.movzx8(RCX, RAX);
+            e.rsib({ 0x0F, 0xB6 }, RAX, RDX, RCX, 0);
+            const u32 done = e.jmp();
+
+            e.bind(slow);
+            e.mov(RSI, RAX);
+            e.rm({ 0x8B }, RDI, STATE, OFF_MEM, true);
+            e.rm({ 0xFF }, 2, STATE, OFF_READ);
+            e.movzx8(RAX, RAX);
+            e.bind(done);
+        }
+
+        // eax = little endian word at address eax, address + 1 wraps within
+        // the page, as CPU::read_word
+        void read_word()
+        {
+            store_slot(1, RAX);
+            read();
+            store_slot(0, RAX);
+            load_slot(RAX, 1);
+            e.mov(RCX, RAX);
+            e.alu(ADD, RAX, 1);
+            e.movzx8(RAX, RAX);
+            e.alu(AND, RCX, 0xFF00);
+            e.or_(RAX, RCX);
+            read();
+            e.shl(RAX, 8);
+            e.rm({ 0x0B }, RAX, RSP, 0); // or eax, [rsp]
+        }
+
+        // writes esi to address eax, marking the page dirty
+        void write()
+        {
+            e.mov(RCX, RAX);
+            e.shr(RCX, 8);
+            e.rm({ 0x8B }, RDX, STATE, OFF_WRITE_PAGES, true);
+            e.rsib({ 0x8B }, RDX, RDX, RCX, 3, true);
+            e.test(RDX, RDX, true);
+            const u32 slow = e.jcc(CC_E);
+            if constexpr (Memory::TRACK_DIRTY_PAGES)
+            {
+                // bts [rdi], rcx, the dirty bitmap is one bit per page
+                e.rm({ 0x8B }, RDI, STATE, OFF_DIRTY, true);
+                e.rex(true, RCX, 0, RDI);
+                e.emit(0x0F); e.emit(0xAB); e.emit(((RCX & 7) << 3) | (RDI & 7));
+            }
+            e.movzx8(RCX, RAX);
+            e.rsib({ 0x88 }, RSI, RDX, RCX, 0, false, true);
+            const u32 done = e.jmp();
+
+            e.bind(slow);
+            e.mov(RDX, RSI);
+            e.mov(RSI, RAX);
+            e.rm({ 0x8B }, RDI, STATE, OFF_MEM, true);
+            e.rm({ 0xFF }, 2, STATE, OFF_WRITE);
+            e.bind(done);
+        }
+    };
+}
+
+X64Jit::X64Jit(BlockCache& block_cache)
+    : cache(block_cache)
+{
+    Memory& mem = cache.memory();
+    state = {};
+    state.read_pages = mem.read_pages;
+    state.write_pages = mem.write_pages;
+    state.dirty_pages = mem.dirty_pages;
+    state.mem = &mem;
+    state.invalidated = &cache.invalidated;
+    state.read = &jit_read;
+    state.write = &jit_write;
+    state.adc_table = alu_tables.adc;
+    state.adc = &jit_adc;
+    state.sbc = &jit_sbc;
+
+    void* region = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    code = region == MAP_FAILED ? nullptr : static_cast<byte*>(region);
+}
+
+X64Jit::~X64Jit()
+{
+    if (code) munmap(code, CODE_SIZE);
+}
+
+bool X64Jit::compile(BlockCache::Block& block)
+{
+    const BlockCache::Op* ops = cache.ops.data() + block.first_op;
+
+    // the prefix of the block with a native implementation
+    u32 count = 0;
+    s32 cycles = 0, max_cycles = 0;
+    for (; count < block.op_count && jit_ops[ops[count].opcode].kind != NONE; count++)
+    {
+        const OpInfo& info = opcode_info[ops[count].opcode];
+        cycles += info.cycles;
+        // a taken branch pays one more on top of its page crossing cycle
+        max_cycles += info.cycles + info.page_penalty + (info.mode == AddressMode::RELATIVE);
+    }
+    if (count == 0 || !code)
+    {
+        block.native_failed = true;
+        return true;
+    }
+
+    buffer.clear();
+    BlockCompiler compiler(buffer);
+    compiler.prologue(cycles);
+
+    std::vector<BlockCompiler::Exit> exits;
+    s32 remaining = cycles;
+    word pc = block.start;
+    bool pc_set = false;
+    for (u32 i = 0; i < count; i++)
+    {
+        const JitOp& op = jit_ops[ops[i].opcode];
+        const word next_pc = pc + ops[i].size;
+        remaining -= opcode_info[ops[i].opcode].cycles;
+
+        compiler.instruction(op, ops[i].operand, pc);
+        pc_set = sets_pc(op.kind);
+        if (writes_memory(op.kind) && !pc_set && i + 1 < count)
+        {
+            exits.push_back({ compiler.check_invalidated(), next_pc, remaining });
+        }
+        pc = next_pc;
+    }
+    if (!pc_set)
+    {
+        compiler.store_pc(pc);
+    }
+
+    const u32 epilogue_start = compiler.here();
+    compiler.epilogue();
+    for (const BlockCompiler::Exit& exit : exits)
+    {
+        compiler.exit_stub(exit, epilogue_start);
+    }
+
+    // keep entry points 16 byte aligned
+    const u32 size = (buffer.size() + 15) & ~15u;
+    if (used + size > CODE_SIZE) return false;
+
+    // the region is only writable while code is copied in
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t first = (uintptr_t)(code + used) & ~(page_size - 1);
+    const uintptr_t last = ((uintptr_t)(code + used + size) + page_size - 1) & ~(page_size - 1);
+    if (mprotect((void*)first, last - first, PROT_READ | PROT_WRITE) != 0)
+    {
+        block.native_failed = true;
+        return true;
+    }
+    std::memcpy(code + used, buffer.data(), buffer.size());
+    mprotect((void*)first, last - first, PROT_READ | PROT_EXEC);
+
+    block.native = reinterpret_cast<void (*)(JitState*)>(code + used);
+    block.native_max_cycles = max_cycles;
+    used += size;
+    cache.compiled++;
+    return true;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef _H_JIT_X64
+#define _H_JIT_X64
+
+#include "m6502.h"
+#include "block_cache.h"
+
+#include <vector>
+
+namespace emulator6502 {
+
+    /**
+     * State shared with native blocks. The CPU copies its registers in
+     * before a block runs and back afterwards; the generated code keeps
+     * them in host registers in between and addresses the rest by offset.
+    */
+    struct JitState
+    {
+        word PC;
+        byte A, X, Y, SP, PS;
+        s32 cycles;
+
+        const byte* const* read_pages;
+        byte* const* write_pages;
+        u64* dirty_pages;
+        Memory* mem;
+        const bool* invalidated; // BlockCache::invalidated
+        byte (*read)(Memory*, word);
+        void (*write)(Memory*, word, byte);
+        const word* adc_table; // AluTables::adc
+        word (*adc)(byte, byte, byte);
+        word (*sbc)(byte, byte, byte);
+    };
+
+#if M6502_HAS_JIT
+    /**
+     * Translates BlockCache blocks into x86-64 code. A block is compiled up
+     * to its first instruction without a native implementation and charges
+     * its cycles up front, the CPU only enters it when the budget covers
+     * the worst case so it stops on the same instruction as the
+     * interpreters.
+     *
+     * Memory accesses use the page table inline and call back into Memory
+     * for I/O and protected code pages; a write that drops blocks ends the
+     * native block after the current instruction. CPU registers are not
+     * updated while native code runs I/O handlers, and those handlers must
+     * not throw.
+    */
+    class X64Jit
+    {
+    public:
+        explicit X64Jit(BlockCache&);
+        ~X64Jit();
+        X64Jit(const X64Jit&) = delete;
+        X64Jit& operator=(const X64Jit&) = delete;
+
+        JitState state;
+
+        // compiles the block, setting native or native_failed
+        /** @return false when the code buffer is full and needs a reset */
+        bool compile(BlockCache::Block&);
+        // drop all generated code
+        void reset() { used = 0; }
+
+    private:
+        static constexpr u32 CODE_SIZE = 4 * 1024 * 1024;
+
+        BlockCache& cache;
+        byte* code;
+        u32 used = 0;
+        std::vector<byte> buffer;
+    };
+#endif
+}
+
+#endif
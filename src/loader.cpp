@@ -0,0 +1,206 @@
+#include "loader.h"
+
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace emulator6502;
+
+MappedFile::MappedFile(const char* path)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0 && info.st_size <= 0xFFFFFFFF)
+    {
+        void* region = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (region != MAP_FAILED)
+        {
+            bytes = static_cast<const byte*>(region);
+            length = (u32)info.st_size;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : bytes(std::exchange(other.bytes, nullptr)), length(std::exchange(other.length, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    std::swap(bytes, other.bytes);
+    std::swap(length, other.length);
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    if (bytes) munmap(const_cast<byte*>(bytes), length);
+}
+
+LoadedImage emulator6502::load_raw(Memory& mem, const byte* image, u32 size, word address)
+{
+    size = std::min(size, Memory::MAX_MEMORY - address);
+    mem.load(address, image, size);
+    return { size, address, address };
+}
+
+LoadedImage emulator6502::load_prg(Memory& mem, const byte* image, u32 size)
+{
+    if (size < 2) return {};
+    return load_raw(mem, image + 2, size - 2, (word)(image[0] | image[1] << 8));
+}
+
+namespace
+{
+    // reads hex digits from the text, clearing ok on anything else
+    struct HexReader
+    {
+        const char* text;
+        const char* end;
+        bool ok = true;
+
+        u32 digit()
+        {
+            const char c = text < end ? *text++ : '\0';
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            ok = false;
+            return 0;
+        }
+
+        byte next()
+        {
+            const u32 high = digit();
+            return (byte)(high << 4 | digit());
+        }
+    };
+}
+
+// records are ":LLAAAATT" then LL data bytes and a checksum making the
+// record sum to 0. Types 00 data, 01 end of file, 02/04 extended segment
+// and linear address, 03/05 start address, which also goes into the reset
+// vector
+LoadedImage emulator6502::load_hex(Memory& mem, const char* text, u32 size)
+{
+    HexReader reader{ text, text + size };
+    LoadedImage loaded;
+    u32 lowest = Memory::MAX_MEMORY;
+    u32 base = 0;
+    bool has_start = false;
+    byte record[255];
+
+    while (true)
+    {
+        while (reader.text < reader.end && *reader.text != ':')
+        {
+            if (!isspace((unsigned char)*reader.text)) return {};
+            reader.text++;
+        }
+        // the end of file record is optional
+        if (reader.text == reader.end) break;
+        reader.text++;
+
+        const byte length = reader.next();
+        const byte address_high = reader.next();
+        const byte address_low = reader.next();
+        const byte type = reader.next();
+        byte sum = length + address_high + address_low + type;
+        for (u32 i = 0; i < length; i++)
+        {
+            record[i] = reader.next();
+            sum += record[i];
+        }
+        sum += reader.next();
+        if (!reader.ok || sum != 0) return {};
+
+        const u32 address = base + (address_high << 8 | address_low);
+        if (type == 0x00)
+        {
+            if (address + length > Memory::MAX_MEMORY) return {};
+            mem.load((word)address, record, length);
+            if (length) lowest = std::min(lowest, address);
+            loaded.size += length;
+        }
+        else if (type == 0x01)
+        {
+            break;
+        }
+        else if ((type == 0x02 || type == 0x04) && length == 2)
+        {
+            base = (record[0] << 8 | record[1]) << (type == 0x02 ? 4 : 16);
+        }
+        else if (type == 0x03 && length == 4)
+        {
+            has_start = true;
+            loaded.start = (word)(((record[0] << 8 | record[1]) << 4) + (record[2] << 8 | record[3]));
+        }
+        else if (type == 0x05 && length == 4)
+        {
+            has_start = true;
+            loaded.start = (word)(record[2] << 8 | record[3]);
+        }
+        else
+        {
+            return {};
+        }
+    }
+
+    if (lowest != Memory::MAX_MEMORY) loaded.address = (word)lowest;
+    if (has_start) set_reset_vector(mem, loaded.start);
+    else loaded.start = loaded.address;
+    return loaded;
+}
+
+LoadedImage emulator6502::load_image(Memory& mem, const MappedFile& file, ImageFormat format, word address)
+{
+    switch (format)
+    {
+    case ImageFormat::PRG:
+        return load_prg(mem, file.data(), file.size());
+    case ImageFormat::INTEL_HEX:
+        return load_hex(mem, reinterpret_cast<const char*>(file.data()), file.size());
+    default:
+        return load_raw(mem, file.data(), file.size(), address);
+    }
+}
+
+LoadedImage emulator6502::load_file(Memory& mem, const char* path, word address)
+{
+    const MappedFile file(path);
+    if (file.empty()) return {};
+
+    ImageFormat format = ImageFormat::RAW;
+    if (const char* extension = strrchr(path, '.'))
+    {
+        if (strcasecmp(extension, ".prg") == 0) format = ImageFormat::PRG;
+        if (strcasecmp(extension, ".hex") == 0 || strcasecmp(extension, ".ihx") == 0) format = ImageFormat::INTEL_HEX;
+    }
+    return load_image(mem, file, format, address);
+}
+
+// through Memory::load like the images, so the page is marked dirty
+void emulator6502::set_reset_vector(Memory& mem, word start)
+{
+    const byte vector[] = { (byte)(start & 0xFF), (byte)(start >> 8) };
+    mem.load(0xFFFC, vector, sizeof(vector));
+}
+
+// the mapping covers whole host pages, so reading up to the end of the
+// last emulated page never leaves it
+bool emulator6502::map_rom_file(Memory& mem, const MappedFile& file, byte first_page)
+{
+    const u32 pages = (file.size() + Memory::PAGE_SIZE - 1) / Memory::PAGE_SIZE;
+    if (pages == 0 || first_page + pages > Memory::PAGE_COUNT) return false;
+    mem.map_rom(first_page, (byte)(first_page + pages - 1), file.data());
+    return true;
+}
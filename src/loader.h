@@ -0,0 +1,77 @@
+#ifndef _H_LOADER
+#define _H_LOADER
+
+#include "m6502.h"
+
+namespace emulator6502 {
+
+    /**
+     * Read-only view of a whole file, mapped rather than read so opening
+     * costs nothing per byte and many Memory instances can load from the
+     * same pages. Empty when the file could not be opened or is empty.
+    */
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const char* path);
+        MappedFile(MappedFile&&) noexcept;
+        MappedFile& operator=(MappedFile&&) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        const byte* data() const { return bytes; }
+        u32 size() const { return length; }
+        bool empty() const { return length == 0; }
+
+    private:
+        const byte* bytes = nullptr;
+        u32 length = 0;
+    };
+
+    // where an image went, size is 0 when it could not be loaded
+    struct LoadedImage
+    {
+        u32 size = 0;       // bytes loaded
+        word address = 0;   // lowest address loaded
+        word start = 0;     // entry point, address unless the image names one
+    };
+
+    // program image formats, load_file picks one from the extension
+    enum class ImageFormat : byte
+    {
+        RAW = 0,        // bytes as they are, at an address given by the caller
+        PRG = 1,        // C64 style, a little endian load address then the bytes
+        INTEL_HEX = 2,  // text records, data and an optional start address
+    };
+
+    /**
+     * Image loaders, copying into Memory through Memory::load so written
+     * pages are marked dirty and decoded code is invalidated. Bytes past
+     * the end of memory are dropped, a HEX record past it fails the load.
+    */
+    LoadedImage load_raw(Memory&, const byte* image, u32 size, word address);
+    LoadedImage load_prg(Memory&, const byte* image, u32 size);
+    // a single pass over the text without allocating, records before a
+    // malformed one stay loaded. A start address record also sets the
+    // reset vector, so the image runs from a reset
+    LoadedImage load_hex(Memory&, const char* text, u32 size);
+    LoadedImage load_image(Memory&, const MappedFile&, ImageFormat, word address = 0);
+    // .prg and .hex/.ihx by extension, anything else raw at address
+    LoadedImage load_file(Memory&, const char* path, word address = 0);
+
+    // writes start into the reset vector at 0xFFFC
+    void set_reset_vector(Memory&, word start);
+
+    /**
+     * Maps the file as ROM from first_page on, the mapped file itself is
+     * the backing store so nothing is copied. The file must stay open for
+     * as long as the pages are mapped; the last page reads zeros past the
+     * end of the file.
+     * @return false if the file is empty or does not fit
+    */
+    bool map_rom_file(Memory&, const MappedFile&, byte first_page);
+}
+
+#endif
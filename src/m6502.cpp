@@ -1,17 +1,117 @@
 #include "m6502.h"
+#include "trace.h"
+#include "profiler.h"
+#include "breakpoints.h"
+#include "block_cache.h"
+#include "jit_x64.h"
+#include "alu.h"
+#include "opcodes.h"
 
 using namespace emulator6502;
 
 //~~~~~~~~~~~~~~~~~Memory Functions~~~~~~~~~~~~~~~~~
 
-void Memory::init()
+// memory starts out zeroed
+Memory::Memory()
+{
+    init();
+    map_ram(0x00, 0xFF);
+}
+
+Memory::Memory(const Memory& other)
+{
+    *this = other;
+}
+
+Memory& Memory::operator=(const Memory& other)
+{
+    if (this != &other)
+    {
+        release_code(true);
+        std::fill(std::begin(read_watches), std::end(read_watches), 0);
+        std::fill(std::begin(write_watches), std::end(write_watches), 0);
+        std::fill(std::begin(read_watch_pages), std::end(read_watch_pages), 0);
+        std::fill(std::begin(write_watch_pages), std::end(write_watch_pages), 0);
+        std::copy(other.data, other.data + MAX_MEMORY, data);
+        std::copy(other.dirty_pages, other.dirty_pages + PAGE_COUNT / 64, dirty_pages);
+        std::copy(other.sent_pages, other.sent_pages + PAGE_COUNT / 64, sent_pages);
+        std::copy(other.unsent_pages, other.unsent_pages + PAGE_COUNT / 64, unsent_pages);
+        if (other.baseline)
+        {
+            baseline.reset(new byte[MAX_MEMORY]);
+            std::copy(other.baseline.get(), other.baseline.get() + MAX_MEMORY, baseline.get());
+        }
+        else
+        {
+            baseline.reset();
+        }
+        rebase_pages(other);
+    }
+    return *this;
+}
+
+// copies the page table, pages backed by other's data point into ours
+void Memory::rebase_pages(const Memory& other)
 {
-    for (u32 i = 0; i < MAX_MEMORY; i++)
+    auto owned_by_other = [&other](const byte* page)
     {
-        data[i] = 0;
+        return page >= other.data && page < other.data + MAX_MEMORY;
+    };
+
+    for (u32 page = 0; page < PAGE_COUNT; page++)
+    {
+        const byte* read_page = other.mapped_read_page(page);
+        const bool writable = other.mapped_write_page(page) || has_bit(other.code_ram_pages, page);
+        read_pages[page] = owned_by_other(read_page) ? data + (read_page - other.data) : read_page;
+        write_pages[page] = writable ? data + page * PAGE_SIZE : nullptr;
+        io_handlers[page] = other.io_handlers[page];
     }
+}
+
+void Memory::init()
+{
+    release_code(true);
+    std::fill(data, data + MAX_MEMORY, 0);
+    std::fill(dirty_pages, dirty_pages + PAGE_COUNT / 64, ~0ull);
+    std::fill(sent_pages, sent_pages + PAGE_COUNT / 64, 0);
+    std::fill(unsent_pages, unsent_pages + PAGE_COUNT / 64, 0);
 };
 
+void Memory::save_baseline()
+{
+    if (!baseline)
+    {
+        baseline.reset(new byte[MAX_MEMORY]);
+    }
+    std::copy(data, data + MAX_MEMORY, baseline.get());
+    for (u32 i = 0; i < PAGE_COUNT / 64; i++)
+    {
+        unsent_pages[i] |= dirty_pages[i];
+        dirty_pages[i] = TRACK_DIRTY_PAGES ? 0 : ~0ull;
+        sent_pages[i] = 0;
+    }
+}
+
+// copies back the pages written since save_baseline, those a state diff
+// sent since then changed again and go with the next one
+void Memory::restore_baseline()
+{
+    assert(baseline);
+    for (u32 i = 0; i < PAGE_COUNT / 64; i++)
+    {
+        for (u64 bits = dirty_pages[i] | sent_pages[i]; bits; bits &= bits - 1)
+        {
+            const u32 page = i * 64 + std::countr_zero(bits);
+            const u32 offset = page * PAGE_SIZE;
+            check_code(page);
+            std::copy(baseline.get() + offset, baseline.get() + offset + PAGE_SIZE, data + offset);
+        }
+        unsent_pages[i] |= sent_pages[i];
+        dirty_pages[i] = TRACK_DIRTY_PAGES ? 0 : ~0ull;
+        sent_pages[i] = 0;
+    }
+}
+
 // read byte at address
 byte Memory::operator[](word address) const
 {
@@ -23,14 +123,264 @@ byte Memory::operator[](word address) const
 byte& Memory::operator[](word address)
 {
     assert(address < MAX_MEMORY);
+    mark_dirty(address);
+    check_code(address >> 8);
     return data[address];
 }
 
 // write two bytes (i.e. word)
 void Memory::write_word(word w, word address)
 {
-    data[address]       = w & 0xFF;
-    data[address + 1]   = (w >> 8);
+    (*this)[address]                = w & 0xFF;
+    (*this)[(word)(address + 1)]    = (w >> 8);
+}
+
+void Memory::load(word address, const byte* image, u32 size)
+{
+    size = std::min(size, MAX_MEMORY - address);
+    if (size == 0) return;
+    for (u32 page = address >> 8; page <= (address + size - 1) >> 8; page++)
+    {
+        mark_dirty(page * PAGE_SIZE);
+        check_code(page);
+    }
+    std::copy(image, image + size, data + address);
+}
+
+byte Memory::peek(word address) const
+{
+    const byte* page = mapped_read_page(address >> 8);
+    return page ? page[address & 0xFF] : data[address];
+}
+
+void Memory::map_ram(byte first_page, byte last_page)
+{
+    for (u32 page = first_page; page <= last_page; page++)
+    {
+        check_code(page);
+        set_read_page(page, data + page * PAGE_SIZE);
+        set_write_page(page, data + page * PAGE_SIZE);
+        io_handlers[page] = IOHandler();
+    }
+}
+
+// image defaults to data, otherwise it is read from image + (page - first_page) * PAGE_SIZE
+void Memory::map_rom(byte first_page, byte last_page, const byte* image)
+{
+    for (u32 page = first_page; page <= last_page; page++)
+    {
+        check_code(page);
+        set_read_page(page, image ? image + (page - first_page) * PAGE_SIZE : data + page * PAGE_SIZE);
+        set_write_page(page, nullptr);
+        io_handlers[page] = IOHandler();
+    }
+}
+
+void Memory::map_io(byte first_page, byte last_page, const IOHandler& handler)
+{
+    for (u32 page = first_page; page <= last_page; page++)
+    {
+        check_code(page);
+        set_read_page(page, nullptr);
+        set_write_page(page, nullptr);
+        io_handlers[page] = handler;
+    }
+}
+
+void Memory::set_code_observer(CodeObserver observer, void* context)
+{
+    release_code(false);
+    code_observer = observer;
+    code_context = context;
+}
+
+// RAM pages lose their write pointer so CPU writes reach write_slow
+void Memory::protect_code(byte page)
+{
+    const u64 bit = 1ull << (page & 63);
+    code_pages[page >> 6] |= bit;
+    if (mapped_write_page(page))
+    {
+        code_ram_pages[page >> 6] |= bit;
+        set_write_page(page, nullptr);
+    }
+}
+
+void Memory::code_written(u32 page)
+{
+    const u64 bit = 1ull << (page & 63);
+    code_pages[page >> 6] &= ~bit;
+    if (code_ram_pages[page >> 6] & bit)
+    {
+        code_ram_pages[page >> 6] &= ~bit;
+        set_write_page(page, data + page * PAGE_SIZE);
+    }
+    if (code_observer) code_observer(code_context, page);
+}
+
+// lifts the protection of every code page
+void Memory::release_code(bool notify)
+{
+    for (u32 i = 0; i < PAGE_COUNT / 64; i++)
+    {
+        for (u64 bits = code_pages[i]; bits; bits &= bits - 1)
+        {
+            const u32 page = i * 64 + std::countr_zero(bits);
+            if (notify)
+            {
+                code_written(page);
+            }
+            else if ((code_ram_pages[i] >> (page & 63)) & 1)
+            {
+                set_write_page(page, data + page * PAGE_SIZE);
+            }
+        }
+        if (!notify)
+        {
+            code_pages[i] = code_ram_pages[i] = 0;
+        }
+    }
+}
+
+void Memory::set_watch_observer(WatchObserver observer, void* context)
+{
+    watch_observer = observer;
+    watch_context = context;
+}
+
+// adds to the watches of the address, a false kind is left as it was
+void Memory::watch(word address, bool read, bool write)
+{
+    if (read) read_watches[address >> 6] |= 1ull << (address & 63);
+    if (write) write_watches[address >> 6] |= 1ull << (address & 63);
+    update_watch_page(address >> 8);
+}
+
+void Memory::unwatch(word address)
+{
+    read_watches[address >> 6] &= ~(1ull << (address & 63));
+    write_watches[address >> 6] &= ~(1ull << (address & 63));
+    update_watch_page(address >> 8);
+}
+
+void Memory::clear_watches()
+{
+    std::fill(std::begin(read_watches), std::end(read_watches), 0);
+    std::fill(std::begin(write_watches), std::end(write_watches), 0);
+    for (u32 page = 0; page < PAGE_COUNT; page++)
+    {
+        update_watch_page(page);
+    }
+}
+
+// moves the page pointers in or out of the watched tables to match the
+// watches within the page
+void Memory::update_watch_page(u32 page)
+{
+    auto any = [page](const u64* bits)
+    {
+        const u64* words = bits + page * PAGE_SIZE / 64;
+        return (words[0] | words[1] | words[2] | words[3]) != 0;
+    };
+    const u64 bit = 1ull << (page & 63);
+
+    const byte* read_page = mapped_read_page(page);
+    byte* write_page = mapped_write_page(page);
+    read_watch_pages[page >> 6] &= ~bit;
+    write_watch_pages[page >> 6] &= ~bit;
+    if (any(read_watches)) read_watch_pages[page >> 6] |= bit;
+    if (any(write_watches)) write_watch_pages[page >> 6] |= bit;
+    set_read_page(page, read_page);
+    set_write_page(page, write_page);
+}
+
+// a watched page stays on the slow path, the pointer is kept aside for it
+void Memory::set_read_page(u32 page, const byte* pointer)
+{
+    if (has_bit(read_watch_pages, page))
+    {
+        watched_read_pages[page] = pointer;
+        read_pages[page] = nullptr;
+    }
+    else
+    {
+        read_pages[page] = pointer;
+    }
+}
+
+void Memory::set_write_page(u32 page, byte* pointer)
+{
+    if (has_bit(write_watch_pages, page))
+    {
+        watched_write_pages[page] = pointer;
+        write_pages[page] = nullptr;
+    }
+    else
+    {
+        write_pages[page] = pointer;
+    }
+}
+
+byte Memory::read_io(word address)
+{
+    const IOHandler& handler = io_handlers[address >> 8];
+    return handler.read ? handler.read(handler.context, address) : 0;
+}
+
+void Memory::write_io(word address, byte value)
+{
+    const IOHandler& handler = io_handlers[address >> 8];
+    if (handler.write) handler.write(handler.context, address, value);
+}
+
+// I/O read, or a read from a page holding a watch
+byte Memory::read_slow(word address)
+{
+    const u32 page = address >> 8;
+    if (!has_bit(read_watch_pages, page))
+    {
+        return read_io(address);
+    }
+
+    const byte* mapped = watched_read_pages[page];
+    const byte value = mapped ? mapped[address & 0xFF] : read_io(address);
+    if (has_bit(read_watches, address) && watch_observer)
+    {
+        watch_observer(watch_context, address, value, false);
+    }
+    return value;
+}
+
+// I/O write, a write to protected code, a write to a page holding a watch,
+// or a write to ROM which is dropped
+void Memory::write_slow(word address, byte value)
+{
+    const u32 page = address >> 8;
+    if (has_bit(code_pages, page))
+    {
+        code_written(page);
+        write(address, value);
+        return;
+    }
+    if (!has_bit(write_watch_pages, page))
+    {
+        write_io(address, value);
+        return;
+    }
+
+    if (byte* mapped = watched_write_pages[page])
+    {
+        mark_dirty(address);
+        mapped[address & 0xFF] = value;
+    }
+    else
+    {
+        write_io(address, value);
+    }
+    if (has_bit(write_watches, address) && watch_observer)
+    {
+        watch_observer(watch_context, address, value, true);
+    }
 }
 
 //~~~~~~~~~~~~~~~~~CPU Functions~~~~~~~~~~~~~~~~~
@@ -47,7 +397,7 @@ void CPU::set_memory(Memory& mem)
 }
 
 // http:://www.c64-wiki.com/wiki/Reset_(Process)
-void CPU::reset(word reset_vector)
+void CPU::reset(word reset_vector, bool clear_memory)
 {
     // reset addresses
     PC = reset_vector;
@@ -61,56 +411,56 @@ void CPU::reset(word reset_vector)
     A = X = Y = 0;
 
     // set up memory
-    mem_ref.init();
+    if (clear_memory) mem_ref.init();
 };
 
-byte CPU::fetch_byte()
+template<typename Accuracy>
+M6502_ALWAYS_INLINE byte CPU::fetch_byte()
 {
-    byte value = mem_ref[PC];
+    byte value = mem_ref.read(PC);
     PC++;
-    cycles--;
+    tick<Accuracy>(1);
     return value;
 }
 
-byte CPU::read_byte(word address)
+template<typename Accuracy>
+M6502_ALWAYS_INLINE byte CPU::read_byte(word address)
 {
-    byte value = mem_ref[address];
-    cycles--;
+    byte value = mem_ref.read(address);
+    tick<Accuracy>(1);
     return value;
 }
 
-word CPU::fetch_word()
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::fetch_word()
 {
     // get lower 
-    word value = mem_ref[PC];
+    word value = mem_ref.read(PC);
     PC++;
 
     // get upper
-    value |= (mem_ref[PC] << 8);
+    value |= (mem_ref.read(PC) << 8);
     PC++;
 
-    cycles -= 2;
+    tick<Accuracy>(2);
 
     return value;
 }
 
-word CPU::read_word(word address)
+// the high byte comes from the same page, as the NMOS pointer reads do
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::read_word(word address)
 {
-    byte low = read_byte(address);
-    byte high = read_byte(address + 0x1);
+    byte low = read_byte<Accuracy>(address);
+    byte high = read_byte<Accuracy>((address & 0xFF00) | ((address + 1) & 0xFF));
     return low | (high << 8);
 }
 
-void CPU::write_byte(byte data, word address)
-{
-    mem_ref[address] = data;
-    cycles--;
-}
-
-void CPU::write_word(word data, word address)
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::write_byte(byte data, word address)
 {
-    cycles -= 2;
-    mem_ref.write_word(data, address);
+    mem_ref.write(address, data);
+    tick<Accuracy>(1);
 }
 
 /** @return stack pointer as 16 bit address */
@@ -119,537 +469,1167 @@ word CPU::sp_to_address() const
     return 0x100 | SP;
 }
 
-void CPU::push_pc_sp()
+// the stack stays within page 1, SP wraps around
+
+// high byte first, so the word reads back little endian
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::push_word_to_stack(word value)
 {
-    write_word(PC-1, sp_to_address() - 1);
-    SP -= 2;
-    cycles--;
+    push_byte_to_stack<Accuracy>(value >> 8);
+    push_byte_to_stack<Accuracy>(value & 0xFF);
 }
 
-word CPU::pop_word_from_stack()
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::pop_word_from_stack()
 {
-    word value = read_word(sp_to_address() + 1);
-    SP += 2;
-    cycles--;
-    return value;
+    byte low = pop_byte_from_stack<Accuracy>();
+    byte high = pop_byte_from_stack<Accuracy>();
+    return low | (high << 8);
 }
 
-byte CPU::pop_byte_from_stack()
+template<typename Accuracy>
+M6502_ALWAYS_INLINE byte CPU::pop_byte_from_stack()
 {
-    byte value = read_byte(sp_to_address());
     SP++;
-    cycles--;
-    return value;
+    return read_byte<Accuracy>(sp_to_address());
 }
 
-void CPU::push_byte_to_stack(byte value)
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::push_byte_to_stack(byte value)
 {
-    mem_ref[sp_to_address()] = value;
-    cycles--;
+    write_byte<Accuracy>(value, sp_to_address());
     SP--;
 }
 
-/** @return number of cycles used */
-s32 CPU::execute(s32 cycle_count)
-{
-    this->cycles = cycle_count;
-
-    auto load_register =
-        [this]
-        (word address, byte& reg)
-    {
-        reg = read_byte(address);
-        zero_and_negative_flag_set(reg);
-    };
-
-    // weird name because and is a keyword
-    auto _and_ =
-        [this]
-        (word address)
-    {
-        A &= read_byte(address);
-        zero_and_negative_flag_set(A);
-    };
-
-    auto eor =
-        [this]
-        (word address)
-    {
-        A ^= read_byte(address);
-        zero_and_negative_flag_set(A);
-    };
-
-    // weird name because or is a keyword
-    auto _or_ =
-        [this]
-        (word address)
-    {
-        A |= read_byte(address);
-        zero_and_negative_flag_set(A);
-    };
-
-    const s32 start_cycles = cycles;
-    while (cycles > 0)
-    {
-        byte instruction = fetch_byte();
-        switch (instruction)
-        {
-        // LDA ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_LDA_IM:
-        {
-            A = address_mode_zero_page_and_immediate();
-            zero_and_negative_flag_set(A);
-        } break;
-        case INS_LDA_ZP:
-        {
-            word address = address_mode_zero_page_and_immediate();
-            load_register(address, A);
-        } break;
-        case INS_LDA_ZPX:
-        {
-            word address = address_mode_zero_page_x_offset();
-            load_register(address, A);
-        } break;
-        case INS_LDA_ABS:
-        {
-            word address = address_mode_absolute();
-            load_register(address, A);
-        } break;
-        case INS_LDA_AX:
-        {
-            word address = address_mode_abosolute_x_offset_with_page_cycle();
-            load_register(address, A);
-        } break;
-        case INS_LDA_AY:
-        {
-            word address = address_mode_abosolute_y_offset_with_page_cycle();
-            load_register(address, A);
-        } break;
-        case INS_LDA_IX:
-        {
-            word address = address_mode_indirect_x_offset();
-            load_register(address, A);
-            cycles--;
-        } break;
-        case INS_LDA_IY:
-        {
-            word address = address_mode_indirect_y_offset_with_page_cycle();
-            load_register(address, A);
-        } break;
-        // LDX ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_LDX_IM:
-        {
-            X = address_mode_zero_page_and_immediate();
-            zero_and_negative_flag_set(X);
-        } break;
-        case INS_LDX_ZP:
-        {
-            word address = address_mode_zero_page_and_immediate();
-            load_register(address, X);
-        } break;
-        case INS_LDX_ZPY:
-        {
-            word address = address_mode_zero_page_y_offset();
-            load_register(address, X);
-        } break;
-        case INS_LDX_ABS:
-        {
-            word address = address_mode_absolute();
-            load_register(address, X);
-        } break;
-        case INS_LDX_AY:
-        {
-            word address = address_mode_abosolute_y_offset_with_page_cycle();
-            load_register(address, X);
-        } break;
-        // LDY ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_LDY_IM:
-        {
-            Y = address_mode_zero_page_and_immediate();
-            zero_and_negative_flag_set(Y);
-        } break;
-        case INS_LDY_ZP:
-        {
-            word address = address_mode_zero_page_and_immediate();
-            load_register(address, Y);
-        } break;
-        case INS_LDY_ZPX:
-        {
-            word address = address_mode_zero_page_x_offset();
-            load_register(address, Y);
-        } break;
-        case INS_LDY_ABS:
-        {
-            word address = address_mode_absolute();
-            load_register(address, Y);
-        } break;
-        case INS_LDY_AX:
-        {
-            word address = address_mode_abosolute_x_offset_with_page_cycle();
-            load_register(address, Y);
-        } break;
-        // STA ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_STA_ZP:
-        {
-            word address = address_mode_zero_page_and_immediate();
-            write_byte(A, address);
-        } break;
-        case INS_STA_ZPX:
-        {
-            word address = address_mode_zero_page_x_offset();
-            write_byte(A, address);
-        } break;
-        case INS_STA_ABS:
-        {
-            word address = address_mode_absolute();
-            write_byte(A, address);
-        } break;
-        case INS_STA_AX:
-        {
-            word address = address_mode_absolute_x_offset();
-            write_byte(A, address);
-            cycles--;
-        } break;
-        case INS_STA_AY:
-        {
-            word address = address_mode_absolute_y_offset();
-            write_byte(A, address);
-            cycles--;
-        } break;
-        case INS_STA_IX:
-        {
-            word address = address_mode_indirect_x_offset();
-            write_byte(A, address);
-            cycles--;
-        } break;
-        case INS_STA_IY:
-        {
-            word address = address_mode_indirect_y_offset();
-            write_byte(A, address);
-            cycles--;
-        } break;
-        // STX ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_STX_ZP:
-        {
-            word address = address_mode_zero_page_and_immediate();
-            write_byte(X, address);
-        } break;
-        case INS_STX_ZPY:
-        {
-            word address = address_mode_zero_page_y_offset();
-            write_byte(X, address);
-        } break;
-        case INS_STX_ABS:
-        {
-            word address = address_mode_absolute();
-            write_byte(X, address);
-        } break;
-        // JSY ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_STY_ZP:
-        {
-            word address = address_mode_zero_page_and_immediate();
-            write_byte(Y, address);
-        } break;
-        case INS_STY_ZPX:
-        {
-            word address = address_mode_zero_page_x_offset();
-            write_byte(Y, address);
-        } break;
-        case INS_STY_ABS:
-        {
-            word address = address_mode_absolute();
-            write_byte(Y, address);
-        } break;
-        // Jumps and Returns ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_JSR:
-        {
-            word sub_routine_addr = fetch_word();
-            push_pc_sp();
-            PC = sub_routine_addr;
-        } break;
-        case INS_RTS:
-        {
-            word return_addr = pop_word_from_stack();
-            PC = return_addr + 1;
-            cycles -= 2;
-        } break;
-        case INS_JMP_ABS:
-        {
-            PC = address_mode_absolute();
-        } break;
-        case INS_JMP_I:
-        {
-            word address = fetch_word();
-            PC = read_word(address);
-        } break;
-        // Stack Operations ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_TSX:
-        {
-            X = SP;
-            cycles--;
-            zero_and_negative_flag_set(X);
-        } break;
-        case INS_TXS:
-        {
-            SP = X;
-            cycles--;
-        } break;
-        case INS_PHA:
-        {
-            push_byte_to_stack(A);
-            cycles--;
-        } break;
-        case INS_PHP:
-        {
-            push_byte_to_stack(PS);
-            cycles--;
-        } break;
-        case INS_PLA:
-        {
-            A = pop_byte_from_stack();
-            zero_and_negative_flag_set(A);
-            cycles--;
-        } break;
-        case INS_PLP:
-        {  
-            PS = pop_byte_from_stack();
-            cycles--;
-        } break;
-        // Logical Operations ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_AND_IM:
-        {
-            A &= address_mode_zero_page_and_immediate();
-            zero_and_negative_flag_set(A);
-        } break;
-        case INS_AND_ZP:
-        {
-            word address = address_mode_zero_page_and_immediate();
-            _and_(address);
-        } break;
-        case INS_AND_ZPX:
-        {   
-            word address = address_mode_zero_page_x_offset();
-            _and_(address);
-        } break;
-        case INS_AND_ABS:
-        {
-            word address = address_mode_absolute();
-            _and_(address);
-        } break;
-        case INS_AND_AX:
-        {
-            word address = address_mode_abosolute_x_offset_with_page_cycle();
-            _and_(address);
-        } break;
-        case INS_AND_AY:
-        {
-            word address = address_mode_abosolute_y_offset_with_page_cycle();
-            _and_(address);
-        } break;
-        case INS_AND_IX:
-        {
-            word address = address_mode_indirect_x_offset();
-            _and_(address);
-            cycles--;
-        } break;
-        case INS_AND_IY:
-        {
-            word address = address_mode_indirect_y_offset_with_page_cycle();
-            _and_(address);
-        } break;
-    // EOR ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_EOR_IM:
-        {
-            A ^= address_mode_zero_page_and_immediate();
-            zero_and_negative_flag_set(A);
-        } break;
-        case INS_EOR_ZP:
-        {
-            word address = address_mode_zero_page_and_immediate();
-            eor(address);
-        } break;
-        case INS_EOR_ZPX:
-        {   
-            word address = address_mode_zero_page_x_offset();
-            eor(address);
-        } break;
-        case INS_EOR_ABS:
-        {
-            word address = address_mode_absolute();
-            eor(address);
-        } break;
-        case INS_EOR_AX:
-        {
-            word address = address_mode_abosolute_x_offset_with_page_cycle();
-            eor(address);
-        } break;
-        case INS_EOR_AY:
-        {
-            word address = address_mode_abosolute_y_offset_with_page_cycle();
-            eor(address);
-        } break;
-        case INS_EOR_IX:
-        {
-            word address = address_mode_indirect_x_offset();
-            eor(address);
-            cycles--;
-        } break;
-        case INS_EOR_IY:
-        {
-            word address = address_mode_indirect_y_offset_with_page_cycle();
-            eor(address);
-        } break;
-    // OR ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-        case INS_ORA_IM:
-        {
-            A |= address_mode_zero_page_and_immediate();
-            zero_and_negative_flag_set(A);
-        } break;
-        case INS_ORA_ZP:
-        {
-            word address = address_mode_zero_page_and_immediate();
-            _or_(address);
-        } break;
-        case INS_ORA_ZPX:
-        {   
-            word address = address_mode_zero_page_x_offset();
-            _or_(address);
-        } break;
-        case INS_ORA_ABS:
-        {
-            word address = address_mode_absolute();
-            _or_(address);
-        } break;
-        case INS_ORA_AX:
-        {
-            word address = address_mode_abosolute_x_offset_with_page_cycle();
-            _or_(address);
-        } break;
-        case INS_ORA_AY:
-        {
-            word address = address_mode_abosolute_y_offset_with_page_cycle();
-            _or_(address);
-        } break;
-        case INS_ORA_IX:
-        {
-            word address = address_mode_indirect_x_offset();
-            _or_(address);
-            cycles--;
-        } break;
-        case INS_ORA_IY:
-        {
-            word address = address_mode_indirect_y_offset_with_page_cycle();
-            _or_(address);
-        } break;
-        default: 
-            throw UnknownInstructionException(
-                std::format("Unknown instruction: {}", instruction).c_str()
-            );
-            break;
-        }
-    }
+//~~~~~~~~~~~~~~~~~Instruction Handlers~~~~~~~~~~~~~~~~~
 
-    return start_cycles - cycles;
+M6502_ALWAYS_INLINE void CPU::zero_and_negative_flag_set(byte reg)
+{
+    PS = (PS & ~(FLAG_Z | FLAG_N)) | alu_nz(reg);
 }
 
-word CPU::address_mode_zero_page_and_immediate()
+template<typename Accuracy, byte CPU::*reg>
+M6502_ALWAYS_INLINE void CPU::load_register(byte value)
 {
-    return fetch_byte();
+    this->*reg = value;
+    zero_and_negative_flag_set(this->*reg);
 }
 
-word CPU::address_mode_zero_page_x_offset()
+M6502_ALWAYS_INLINE void CPU::_and_(byte value)
 {
-    byte zero_page_addr = fetch_byte();
-    zero_page_addr += X;
-    cycles--;
-    return zero_page_addr;
+    A &= value;
+    zero_and_negative_flag_set(A);
 }
 
-word CPU::address_mode_zero_page_y_offset()
+M6502_ALWAYS_INLINE void CPU::eor(byte value)
 {
-    byte zero_page_addr = fetch_byte();
-    zero_page_addr += Y;
-    cycles--;
-    return zero_page_addr;
+    A ^= value;
+    zero_and_negative_flag_set(A);
 }
 
-word CPU::address_mode_absolute()
+M6502_ALWAYS_INLINE void CPU::_or_(byte value)
 {
-    return fetch_word();
+    A |= value;
+    zero_and_negative_flag_set(A);
 }
 
-word CPU::address_mode_absolute_x_offset()
+// Z from A & value, N and V copied from bits 7 and 6 of value
+M6502_ALWAYS_INLINE void CPU::bit(byte value)
 {
-    word mem_addr = fetch_word();
-    mem_addr += X;
-
-    return mem_addr;
+    PS = (PS & ~(FLAG_Z | FLAG_V | FLAG_N)) | (alu_nz(A & value) & FLAG_Z) | (value & (FLAG_V | FLAG_N));
 }
 
-word CPU::address_mode_absolute_y_offset()
+M6502_ALWAYS_INLINE void CPU::adc(byte value)
 {
-    word mem_addr = fetch_word();
-    mem_addr += Y;
-    
-    return mem_addr;
+    const word result = alu_adc(A, value, PS);
+    A = result;
+    PS = (PS & ~ALU_FLAGS) | (result >> 8);
 }
 
-word CPU::address_mode_indirect_x_offset()
+M6502_ALWAYS_INLINE void CPU::sbc(byte value)
 {
-    byte zp_addr = fetch_byte();
-    zp_addr += X;
-    word mem_addr = read_word(zp_addr);
+    const word result = alu_sbc(A, value, PS);
+    A = result;
+    PS = (PS & ~ALU_FLAGS) | (result >> 8);
+}
 
-    return mem_addr;
+template<typename Accuracy, byte CPU::*reg>
+M6502_ALWAYS_INLINE void CPU::compare(byte value)
+{
+    PS = (PS & ~(FLAG_N | FLAG_Z | FLAG_C)) | alu_compare(this->*reg, value);
 }
 
-word CPU::address_mode_indirect_y_offset()
+M6502_ALWAYS_INLINE byte CPU::asl(byte value)
 {
-    byte zp_addr = fetch_byte();
-    zp_addr += Y;
-    word mem_addr = read_word(zp_addr);
+    const byte result = value << 1;
+    PS = (PS & ~(FLAG_N | FLAG_Z | FLAG_C)) | alu_nz(result) | (value >> 7);
+    return result;
+}
 
-    return mem_addr;
+M6502_ALWAYS_INLINE byte CPU::lsr(byte value)
+{
+    const byte result = value >> 1;
+    PS = (PS & ~(FLAG_N | FLAG_Z | FLAG_C)) | alu_nz(result) | (value & FLAG_C);
+    return result;
 }
 
-word CPU::address_mode_abosolute_x_offset_with_page_cycle()
+M6502_ALWAYS_INLINE byte CPU::rol(byte value)
 {
-    word mem_addr = fetch_word();
-    word mem_addr_x = mem_addr + X;
-    const bool cross_page_boundary = (mem_addr ^ mem_addr_x) >> 8;
-    if (cross_page_boundary) cycles--;
-    return mem_addr_x;
+    const byte result = (value << 1) | (PS & FLAG_C);
+    PS = (PS & ~(FLAG_N | FLAG_Z | FLAG_C)) | alu_nz(result) | (value >> 7);
+    return result;
 }
 
-word CPU::address_mode_abosolute_y_offset_with_page_cycle()
+M6502_ALWAYS_INLINE byte CPU::ror(byte value)
 {
-    word mem_addr = fetch_word();
+    const byte result = (value >> 1) | (PS << 7);
+    PS = (PS & ~(FLAG_N | FLAG_Z | FLAG_C)) | alu_nz(result) | (value & FLAG_C);
+    return result;
+}
+
+M6502_ALWAYS_INLINE byte CPU::inc(byte value)
+{
+    const byte result = value + 1;
+    zero_and_negative_flag_set(result);
+    return result;
+}
+
+M6502_ALWAYS_INLINE byte CPU::dec(byte value)
+{
+    const byte result = value - 1;
+    zero_and_negative_flag_set(result);
+    return result;
+}
+
+template<typename Accuracy, void (CPU::*operation)(byte)>
+M6502_ALWAYS_INLINE void CPU::ins_immediate(word operand)
+{
+    (this->*operation)(operand);
+}
+
+template<typename Accuracy, word (CPU::*address_mode)(word), void (CPU::*operation)(byte), s32 extra_cycles>
+M6502_ALWAYS_INLINE void CPU::ins_read(word operand)
+{
+    word address = (this->*address_mode)(operand);
+    (this->*operation)(read_byte<Accuracy>(address));
+    tick<Accuracy>(extra_cycles);
+}
+
+template<typename Accuracy, word (CPU::*address_mode)(word), byte CPU::*reg, s32 extra_cycles>
+M6502_ALWAYS_INLINE void CPU::ins_store(word operand)
+{
+    word address = (this->*address_mode)(operand);
+    write_byte<Accuracy>(this->*reg, address);
+    tick<Accuracy>(extra_cycles);
+}
+
+// reads the value, writes it back unchanged and then writes the result
+template<typename Accuracy, word (CPU::*address_mode)(word), byte (CPU::*operation)(byte), s32 extra_cycles>
+M6502_ALWAYS_INLINE void CPU::ins_modify(word operand)
+{
+    word address = (this->*address_mode)(operand);
+    byte value = read_byte<Accuracy>(address);
+    tick<Accuracy>(1 + extra_cycles);
+    write_byte<Accuracy>((this->*operation)(value), address);
+}
+
+template<typename Accuracy, byte (CPU::*operation)(byte)>
+M6502_ALWAYS_INLINE void CPU::ins_accumulator(word)
+{
+    A = (this->*operation)(A);
+    tick<Accuracy>(1);
+}
+
+// INX, INY, DEX and DEY
+template<typename Accuracy, byte CPU::*reg, byte delta>
+M6502_ALWAYS_INLINE void CPU::ins_step(word)
+{
+    this->*reg += delta;
+    zero_and_negative_flag_set(this->*reg);
+    tick<Accuracy>(1);
+}
+
+template<typename Accuracy, byte CPU::*from, byte CPU::*to>
+M6502_ALWAYS_INLINE void CPU::ins_transfer(word)
+{
+    this->*to = this->*from;
+    zero_and_negative_flag_set(this->*to);
+    tick<Accuracy>(1);
+}
+
+// taken when the flag in mask is set, or clear; one more cycle when taken
+// and another when the target is on a different page
+template<typename Accuracy, byte mask, bool set>
+M6502_ALWAYS_INLINE void CPU::ins_branch(word offset)
+{
+    if (((PS & mask) != 0) == set)
+    {
+        const word target = PC + (signed char)offset;
+        tick<Accuracy>(1 + ((PC ^ target) >> 8 != 0));
+        PC = target;
+    }
+}
+
+template<typename Accuracy, byte mask, bool set>
+M6502_ALWAYS_INLINE void CPU::ins_flag(word)
+{
+    PS = set ? (PS | mask) : (PS & ~mask);
+    tick<Accuracy>(1);
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_jsr(word sub_routine_addr)
+{
+    tick<Accuracy>(1);
+    push_word_to_stack<Accuracy>(PC - 1);
+    PC = sub_routine_addr;
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_rts(word)
+{
+    tick<Accuracy>(2);
+    word return_addr = pop_word_from_stack<Accuracy>();
+    PC = return_addr + 1;
+    tick<Accuracy>(1);
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_jmp_abs(word address)
+{
+    PC = address;
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_jmp_i(word address)
+{
+    PC = read_word<Accuracy>(address);
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_tsx(word)
+{
+    X = SP;
+    tick<Accuracy>(1);
+    zero_and_negative_flag_set(X);
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_txs(word)
+{
+    SP = X;
+    tick<Accuracy>(1);
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_pha(word)
+{
+    push_byte_to_stack<Accuracy>(A);
+    tick<Accuracy>(1);
+}
+
+// the pushed copy always has B and the unused bit set
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_php(word)
+{
+    push_byte_to_stack<Accuracy>(PS | FLAG_B | FLAG_U);
+    tick<Accuracy>(1);
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_pla(word)
+{
+    tick<Accuracy>(2);
+    A = pop_byte_from_stack<Accuracy>();
+    zero_and_negative_flag_set(A);
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_plp(word)
+{
+    tick<Accuracy>(2);
+    PS = pop_byte_from_stack<Accuracy>();
+}
+
+// the padding byte after BRK has been fetched as its operand, so PC
+// already points past it
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_brk(word)
+{
+    push_word_to_stack<Accuracy>(PC);
+    push_byte_to_stack<Accuracy>(PS | FLAG_B | FLAG_U);
+    flag.I = 1;
+    PC = read_word<Accuracy>(0xFFFE);
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_rti(word)
+{
+    tick<Accuracy>(2);
+    PS = pop_byte_from_stack<Accuracy>();
+    PC = pop_word_from_stack<Accuracy>();
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE void CPU::ins_nop(word)
+{
+    tick<Accuracy>(1);
+}
+
+// stops the dispatch loop with PC back on the opcode, the JAM opcodes
+// (x2 apart from the immediate NOPs and LDX) halt, the rest are illegal
+M6502_COLD void CPU::ins_unknown(word)
+{
+    PC--;
+    const byte instruction = mem_ref.peek(PC);
+    const bool jam = (instruction & 0x0F) == 0x02 && instruction != 0x82
+        && instruction != 0xA2 && instruction != 0xC2 && instruction != 0xE2;
+    request_stop(jam ? StopReason::HALT : StopReason::ILLEGAL_OPCODE);
+}
+
+void CPU::request_stop(StopReason reason)
+{
+    if (stop_reason != StopReason::BUDGET) return;
+    stop_reason = reason;
+    stop_cycles = cycles;
+    cycles = 0;
+}
+
+void CPU::stop_on_watch(void* cpu, word, byte, bool)
+{
+    static_cast<CPU*>(cpu)->request_stop(StopReason::WATCHPOINT);
+}
+
+//~~~~~~~~~~~~~~~~~Addressing Modes~~~~~~~~~~~~~~~~~
+
+// the operand bytes have already been fetched, these add the indexing and
+// pointer reads on top
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_zero_page_and_immediate(word operand)
+{
+    return operand;
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_zero_page_x_offset(word operand)
+{
+    byte zero_page_addr = operand;
+    zero_page_addr += X;
+    tick<Accuracy>(1);
+    return zero_page_addr;
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_zero_page_y_offset(word operand)
+{
+    byte zero_page_addr = operand;
+    zero_page_addr += Y;
+    tick<Accuracy>(1);
+    return zero_page_addr;
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_absolute(word operand)
+{
+    return operand;
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_absolute_x_offset(word operand)
+{
+    word mem_addr = operand;
+    mem_addr += X;
+
+    return mem_addr;
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_absolute_y_offset(word operand)
+{
+    word mem_addr = operand;
+    mem_addr += Y;
+    
+    return mem_addr;
+}
+
+// pointer at zero page operand + X, wrapping within the zero page
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_indirect_x_offset(word operand)
+{
+    byte zp_addr = operand;
+    zp_addr += X;
+    word mem_addr = read_word<Accuracy>(zp_addr);
+
+    return mem_addr;
+}
+
+// pointer at the zero page operand, Y is added to the pointer
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_indirect_y_offset(word operand)
+{
+    byte zp_addr = operand;
+    word mem_addr = read_word<Accuracy>(zp_addr);
+    mem_addr += Y;
+
+    return mem_addr;
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_abosolute_x_offset_with_page_cycle(word operand)
+{
+    word mem_addr = operand;
+    word mem_addr_x = mem_addr + X;
+    const bool cross_page_boundary = (mem_addr ^ mem_addr_x) >> 8;
+    if (cross_page_boundary) tick<Accuracy>(1);
+    return mem_addr_x;
+}
+
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_abosolute_y_offset_with_page_cycle(word operand)
+{
+    word mem_addr = operand;
     word mem_addr_y = mem_addr + Y;
     const bool cross_page_boundary = (mem_addr ^ mem_addr_y) >> 8;
-    if (cross_page_boundary) cycles--;
+    if (cross_page_boundary) tick<Accuracy>(1);
     return mem_addr_y;
 }
 
-word CPU::address_mode_indirect_x_offset_with_page_cycle()
+template<typename Accuracy>
+M6502_ALWAYS_INLINE word CPU::address_mode_indirect_y_offset_with_page_cycle(word operand)
 {
-    byte zp_addr = fetch_byte();
+    byte zp_addr = operand;
+    word mem_addr = read_word<Accuracy>(zp_addr);
+    word mem_addr_y = mem_addr + Y;
     // extra cycle for page boundary cross
-    if ((word)X + (word)zp_addr >= 0xFF) cycles--;
+    const bool cross_page_boundary = (mem_addr ^ mem_addr_y) >> 8;
+    if (cross_page_boundary) tick<Accuracy>(1);
+    return mem_addr_y;
+}
 
-    zp_addr += X;
-    word mem_addr = read_word(zp_addr);
+//~~~~~~~~~~~~~~~~~Dispatch~~~~~~~~~~~~~~~~~
 
-    return mem_addr;
+// expands X(opcode) for every opcode 0x00 - 0xFF, used to generate the
+// switch cases and the computed goto labels from the handler table
+#define M6502_OPCODE_ROW(X, hi) \
+    X(0x##hi##0) X(0x##hi##1) X(0x##hi##2) X(0x##hi##3) \
+    X(0x##hi##4) X(0x##hi##5) X(0x##hi##6) X(0x##hi##7) \
+    X(0x##hi##8) X(0x##hi##9) X(0x##hi##A) X(0x##hi##B) \
+    X(0x##hi##C) X(0x##hi##D) X(0x##hi##E) X(0x##hi##F)
+#define M6502_FOR_EACH_OPCODE(X) \
+    M6502_OPCODE_ROW(X, 0) M6502_OPCODE_ROW(X, 1) M6502_OPCODE_ROW(X, 2) M6502_OPCODE_ROW(X, 3) \
+    M6502_OPCODE_ROW(X, 4) M6502_OPCODE_ROW(X, 5) M6502_OPCODE_ROW(X, 6) M6502_OPCODE_ROW(X, 7) \
+    M6502_OPCODE_ROW(X, 8) M6502_OPCODE_ROW(X, 9) M6502_OPCODE_ROW(X, A) M6502_OPCODE_ROW(X, B) \
+    M6502_OPCODE_ROW(X, C) M6502_OPCODE_ROW(X, D) M6502_OPCODE_ROW(X, E) M6502_OPCODE_ROW(X, F)
+
+// the page crossing variants of the indexed modes for the opcodes that
+// opcode_info charges the cycle
+template<typename Accuracy, byte opcode>
+constexpr CPU::AddressHandler CPU::address_mode_of()
+{
+    using enum AddressMode;
+    constexpr OpInfo info = opcode_info[opcode];
+    static_assert(info.page_penalty == 0 || info.mode == ABSOLUTE_X || info.mode == ABSOLUTE_Y || info.mode == INDIRECT_Y,
+        "only indexed modes pay a page crossing cycle");
+
+    if constexpr (info.mode == ZERO_PAGE) return &CPU::address_mode_zero_page_and_immediate<Accuracy>;
+    else if constexpr (info.mode == ZERO_PAGE_X) return &CPU::address_mode_zero_page_x_offset<Accuracy>;
+    else if constexpr (info.mode == ZERO_PAGE_Y) return &CPU::address_mode_zero_page_y_offset<Accuracy>;
+    else if constexpr (info.mode == ABSOLUTE) return &CPU::address_mode_absolute<Accuracy>;
+    else if constexpr (info.mode == ABSOLUTE_X && info.page_penalty) return &CPU::address_mode_abosolute_x_offset_with_page_cycle<Accuracy>;
+    else if constexpr (info.mode == ABSOLUTE_X) return &CPU::address_mode_absolute_x_offset<Accuracy>;
+    else if constexpr (info.mode == ABSOLUTE_Y && info.page_penalty) return &CPU::address_mode_abosolute_y_offset_with_page_cycle<Accuracy>;
+    else if constexpr (info.mode == ABSOLUTE_Y) return &CPU::address_mode_absolute_y_offset<Accuracy>;
+    else if constexpr (info.mode == INDIRECT_X) return &CPU::address_mode_indirect_x_offset<Accuracy>;
+    else if constexpr (info.mode == INDIRECT_Y && info.page_penalty) return &CPU::address_mode_indirect_y_offset_with_page_cycle<Accuracy>;
+    else
+    {
+        static_assert(info.mode == INDIRECT_Y, "the mode has no address to read or write");
+        return &CPU::address_mode_indirect_y_offset<Accuracy>;
+    }
 }
 
-word CPU::address_mode_indirect_y_offset_with_page_cycle()
+template<typename Accuracy>
+constexpr std::array<CPU::OperandHandler, 256> CPU::make_opcode_table()
 {
-    byte zp_addr = fetch_byte();
-    // extra cycle for page boundary cross
-    if ((word)Y + (word)zp_addr >= 0xFF) cycles--;
+    // read, store and modify instructions take their addressing mode
+    // function from the opcode's entry in opcode_info
+    #define M6502_READ(opcode, ...) \
+        table[opcode] = &CPU::ins_read<Accuracy, address_mode_of<Accuracy, opcode>(), __VA_ARGS__>
+    #define M6502_STORE(opcode, ...) \
+        table[opcode] = &CPU::ins_store<Accuracy, address_mode_of<Accuracy, opcode>(), __VA_ARGS__>
+    #define M6502_MODIFY(opcode, ...) \
+        table[opcode] = &CPU::ins_modify<Accuracy, address_mode_of<Accuracy, opcode>(), __VA_ARGS__>
 
-    zp_addr += Y;
-    word mem_addr = read_word(zp_addr);
+    // operations
+    constexpr auto LDA  = &CPU::load_register<Accuracy, &CPU::A>;
+    constexpr auto LDX  = &CPU::load_register<Accuracy, &CPU::X>;
+    constexpr auto LDY  = &CPU::load_register<Accuracy, &CPU::Y>;
+    constexpr auto AND  = &CPU::_and_;
+    constexpr auto EOR  = &CPU::eor;
+    constexpr auto ORA  = &CPU::_or_;
+    constexpr auto BIT  = &CPU::bit;
+    constexpr auto ADC  = &CPU::adc;
+    constexpr auto SBC  = &CPU::sbc;
+    constexpr auto CMP  = &CPU::compare<Accuracy, &CPU::A>;
+    constexpr auto CPX  = &CPU::compare<Accuracy, &CPU::X>;
+    constexpr auto CPY  = &CPU::compare<Accuracy, &CPU::Y>;
+    constexpr auto ASL  = &CPU::asl;
+    constexpr auto LSR  = &CPU::lsr;
+    constexpr auto ROL  = &CPU::rol;
+    constexpr auto ROR  = &CPU::ror;
+    constexpr auto INC  = &CPU::inc;
+    constexpr auto DEC  = &CPU::dec;
 
-    return mem_addr;
+    std::array<OperandHandler, 256> table{};
+    table.fill(&CPU::ins_unknown);
+
+    // LDA
+    table[INS_LDA_IM]   = &CPU::ins_immediate<Accuracy, LDA>;
+    M6502_READ(INS_LDA_ZP,  LDA);
+    M6502_READ(INS_LDA_ZPX, LDA);
+    M6502_READ(INS_LDA_ABS, LDA);
+    M6502_READ(INS_LDA_AX,  LDA);
+    M6502_READ(INS_LDA_AY,  LDA);
+    M6502_READ(INS_LDA_IX,  LDA, 1);
+    M6502_READ(INS_LDA_IY,  LDA);
+    // LDX
+    table[INS_LDX_IM]   = &CPU::ins_immediate<Accuracy, LDX>;
+    M6502_READ(INS_LDX_ZP,  LDX);
+    M6502_READ(INS_LDX_ZPY, LDX);
+    M6502_READ(INS_LDX_ABS, LDX);
+    M6502_READ(INS_LDX_AY,  LDX);
+    // LDY
+    table[INS_LDY_IM]   = &CPU::ins_immediate<Accuracy, LDY>;
+    M6502_READ(INS_LDY_ZP,  LDY);
+    M6502_READ(INS_LDY_ZPX, LDY);
+    M6502_READ(INS_LDY_ABS, LDY);
+    M6502_READ(INS_LDY_AX,  LDY);
+    // STA
+    M6502_STORE(INS_STA_ZP,  &CPU::A);
+    M6502_STORE(INS_STA_ZPX, &CPU::A);
+    M6502_STORE(INS_STA_ABS, &CPU::A);
+    M6502_STORE(INS_STA_AX,  &CPU::A, 1);
+    M6502_STORE(INS_STA_AY,  &CPU::A, 1);
+    M6502_STORE(INS_STA_IX,  &CPU::A, 1);
+    M6502_STORE(INS_STA_IY,  &CPU::A, 1);
+    // STX
+    M6502_STORE(INS_STX_ZP,  &CPU::X);
+    M6502_STORE(INS_STX_ZPY, &CPU::X);
+    M6502_STORE(INS_STX_ABS, &CPU::X);
+    // STY
+    M6502_STORE(INS_STY_ZP,  &CPU::Y);
+    M6502_STORE(INS_STY_ZPX, &CPU::Y);
+    M6502_STORE(INS_STY_ABS, &CPU::Y);
+    // Jumps and Returns
+    table[INS_JSR]      = &CPU::ins_jsr<Accuracy>;
+    table[INS_RTS]      = &CPU::ins_rts<Accuracy>;
+    table[INS_JMP_ABS]  = &CPU::ins_jmp_abs<Accuracy>;
+    table[INS_JMP_I]    = &CPU::ins_jmp_i<Accuracy>;
+    // Stack Operations
+    table[INS_TSX]      = &CPU::ins_tsx<Accuracy>;
+    table[INS_TXS]      = &CPU::ins_txs<Accuracy>;
+    table[INS_PHA]      = &CPU::ins_pha<Accuracy>;
+    table[INS_PHP]      = &CPU::ins_php<Accuracy>;
+    table[INS_PLA]      = &CPU::ins_pla<Accuracy>;
+    table[INS_PLP]      = &CPU::ins_plp<Accuracy>;
+    // AND
+    table[INS_AND_IM]   = &CPU::ins_immediate<Accuracy, AND>;
+    M6502_READ(INS_AND_ZP,  AND);
+    M6502_READ(INS_AND_ZPX, AND);
+    M6502_READ(INS_AND_ABS, AND);
+    M6502_READ(INS_AND_AX,  AND);
+    M6502_READ(INS_AND_AY,  AND);
+    M6502_READ(INS_AND_IX,  AND, 1);
+    M6502_READ(INS_AND_IY,  AND);
+    // EOR
+    table[INS_EOR_IM]   = &CPU::ins_immediate<Accuracy, EOR>;
+    M6502_READ(INS_EOR_ZP,  EOR);
+    M6502_READ(INS_EOR_ZPX, EOR);
+    M6502_READ(INS_EOR_ABS, EOR);
+    M6502_READ(INS_EOR_AX,  EOR);
+    M6502_READ(INS_EOR_AY,  EOR);
+    M6502_READ(INS_EOR_IX,  EOR, 1);
+    M6502_READ(INS_EOR_IY,  EOR);
+    // ORA
+    table[INS_ORA_IM]   = &CPU::ins_immediate<Accuracy, ORA>;
+    M6502_READ(INS_ORA_ZP,  ORA);
+    M6502_READ(INS_ORA_ZPX, ORA);
+    M6502_READ(INS_ORA_ABS, ORA);
+    M6502_READ(INS_ORA_AX,  ORA);
+    M6502_READ(INS_ORA_AY,  ORA);
+    M6502_READ(INS_ORA_IX,  ORA, 1);
+    M6502_READ(INS_ORA_IY,  ORA);
+    // ADC
+    table[INS_ADC_IM]   = &CPU::ins_immediate<Accuracy, ADC>;
+    M6502_READ(INS_ADC_ZP,  ADC);
+    M6502_READ(INS_ADC_ZPX, ADC);
+    M6502_READ(INS_ADC_ABS, ADC);
+    M6502_READ(INS_ADC_AX,  ADC);
+    M6502_READ(INS_ADC_AY,  ADC);
+    M6502_READ(INS_ADC_IX,  ADC, 1);
+    M6502_READ(INS_ADC_IY,  ADC);
+    // SBC
+    table[INS_SBC_IM]   = &CPU::ins_immediate<Accuracy, SBC>;
+    M6502_READ(INS_SBC_ZP,  SBC);
+    M6502_READ(INS_SBC_ZPX, SBC);
+    M6502_READ(INS_SBC_ABS, SBC);
+    M6502_READ(INS_SBC_AX,  SBC);
+    M6502_READ(INS_SBC_AY,  SBC);
+    M6502_READ(INS_SBC_IX,  SBC, 1);
+    M6502_READ(INS_SBC_IY,  SBC);
+    // CMP
+    table[INS_CMP_IM]   = &CPU::ins_immediate<Accuracy, CMP>;
+    M6502_READ(INS_CMP_ZP,  CMP);
+    M6502_READ(INS_CMP_ZPX, CMP);
+    M6502_READ(INS_CMP_ABS, CMP);
+    M6502_READ(INS_CMP_AX,  CMP);
+    M6502_READ(INS_CMP_AY,  CMP);
+    M6502_READ(INS_CMP_IX,  CMP, 1);
+    M6502_READ(INS_CMP_IY,  CMP);
+    // CPX
+    table[INS_CPX_IM]   = &CPU::ins_immediate<Accuracy, CPX>;
+    M6502_READ(INS_CPX_ZP,  CPX);
+    M6502_READ(INS_CPX_ABS, CPX);
+    // CPY
+    table[INS_CPY_IM]   = &CPU::ins_immediate<Accuracy, CPY>;
+    M6502_READ(INS_CPY_ZP,  CPY);
+    M6502_READ(INS_CPY_ABS, CPY);
+    // BIT
+    M6502_READ(INS_BIT_ZP,  BIT);
+    M6502_READ(INS_BIT_ABS, BIT);
+    // INC
+    M6502_MODIFY(INS_INC_ZP,  INC);
+    M6502_MODIFY(INS_INC_ZPX, INC);
+    M6502_MODIFY(INS_INC_ABS, INC);
+    M6502_MODIFY(INS_INC_AX,  INC, 1);
+    // DEC
+    M6502_MODIFY(INS_DEC_ZP,  DEC);
+    M6502_MODIFY(INS_DEC_ZPX, DEC);
+    M6502_MODIFY(INS_DEC_ABS, DEC);
+    M6502_MODIFY(INS_DEC_AX,  DEC, 1);
+    table[INS_INX]      = &CPU::ins_step<Accuracy, &CPU::X, 0x01>;
+    table[INS_INY]      = &CPU::ins_step<Accuracy, &CPU::Y, 0x01>;
+    table[INS_DEX]      = &CPU::ins_step<Accuracy, &CPU::X, 0xFF>;
+    table[INS_DEY]      = &CPU::ins_step<Accuracy, &CPU::Y, 0xFF>;
+    // ASL
+    table[INS_ASL_A]    = &CPU::ins_accumulator<Accuracy, ASL>;
+    M6502_MODIFY(INS_ASL_ZP,  ASL);
+    M6502_MODIFY(INS_ASL_ZPX, ASL);
+    M6502_MODIFY(INS_ASL_ABS, ASL);
+    M6502_MODIFY(INS_ASL_AX,  ASL, 1);
+    // LSR
+    table[INS_LSR_A]    = &CPU::ins_accumulator<Accuracy, LSR>;
+    M6502_MODIFY(INS_LSR_ZP,  LSR);
+    M6502_MODIFY(INS_LSR_ZPX, LSR);
+    M6502_MODIFY(INS_LSR_ABS, LSR);
+    M6502_MODIFY(INS_LSR_AX,  LSR, 1);
+    // ROL
+    table[INS_ROL_A]    = &CPU::ins_accumulator<Accuracy, ROL>;
+    M6502_MODIFY(INS_ROL_ZP,  ROL);
+    M6502_MODIFY(INS_ROL_ZPX, ROL);
+    M6502_MODIFY(INS_ROL_ABS, ROL);
+    M6502_MODIFY(INS_ROL_AX,  ROL, 1);
+    // ROR
+    table[INS_ROR_A]    = &CPU::ins_accumulator<Accuracy, ROR>;
+    M6502_MODIFY(INS_ROR_ZP,  ROR);
+    M6502_MODIFY(INS_ROR_ZPX, ROR);
+    M6502_MODIFY(INS_ROR_ABS, ROR);
+    M6502_MODIFY(INS_ROR_AX,  ROR, 1);
+    // Branches
+    table[INS_BCC]      = &CPU::ins_branch<Accuracy, FLAG_C, false>;
+    table[INS_BCS]      = &CPU::ins_branch<Accuracy, FLAG_C, true>;
+    table[INS_BNE]      = &CPU::ins_branch<Accuracy, FLAG_Z, false>;
+    table[INS_BEQ]      = &CPU::ins_branch<Accuracy, FLAG_Z, true>;
+    table[INS_BPL]      = &CPU::ins_branch<Accuracy, FLAG_N, false>;
+    table[INS_BMI]      = &CPU::ins_branch<Accuracy, FLAG_N, true>;
+    table[INS_BVC]      = &CPU::ins_branch<Accuracy, FLAG_V, false>;
+    table[INS_BVS]      = &CPU::ins_branch<Accuracy, FLAG_V, true>;
+    // Status Flag Changes
+    table[INS_CLC]      = &CPU::ins_flag<Accuracy, FLAG_C, false>;
+    table[INS_CLD]      = &CPU::ins_flag<Accuracy, FLAG_D, false>;
+    table[INS_CLI]      = &CPU::ins_flag<Accuracy, FLAG_I, false>;
+    table[INS_CLV]      = &CPU::ins_flag<Accuracy, FLAG_V, false>;
+    table[INS_SEC]      = &CPU::ins_flag<Accuracy, FLAG_C, true>;
+    table[INS_SED]      = &CPU::ins_flag<Accuracy, FLAG_D, true>;
+    table[INS_SEI]      = &CPU::ins_flag<Accuracy, FLAG_I, true>;
+    // Register Transfers
+    table[INS_TAX]      = &CPU::ins_transfer<Accuracy, &CPU::A, &CPU::X>;
+    table[INS_TAY]      = &CPU::ins_transfer<Accuracy, &CPU::A, &CPU::Y>;
+    table[INS_TXA]      = &CPU::ins_transfer<Accuracy, &CPU::X, &CPU::A>;
+    table[INS_TYA]      = &CPU::ins_transfer<Accuracy, &CPU::Y, &CPU::A>;
+    // System Functions, BRK skips the byte after it
+    table[INS_BRK]      = &CPU::ins_brk<Accuracy>;
+    table[INS_RTI]      = &CPU::ins_rti<Accuracy>;
+    table[INS_NOP]      = &CPU::ins_nop<Accuracy>;
+    #undef M6502_READ
+    #undef M6502_STORE
+    #undef M6502_MODIFY
+
+    return table;
+}
+
+template<typename Accuracy>
+constexpr std::array<CPU::OperandHandler, 256> CPU::opcode_table = CPU::make_opcode_table<Accuracy>();
+
+// fetches the operand bytes of the opcode and runs its handler, a policy
+// without per access counting charges the base cost here instead
+template<typename Accuracy, byte opcode>
+M6502_ALWAYS_INLINE void CPU::ins_fetch()
+{
+    constexpr OpInfo info = opcode_info[opcode];
+    constexpr OperandHandler handler = opcode_table<Accuracy>[opcode];
+    static_assert((handler != &CPU::ins_unknown) == info.implemented(),
+        "opcode_info and the handler table disagree on which opcodes exist");
+    static_assert(info.length >= 1 && info.length <= 3);
+
+    if constexpr (!Accuracy::per_access) cycles -= info.cycles;
+    word operand = 0;
+    if constexpr (info.length == 2) operand = fetch_byte<Accuracy>();
+    if constexpr (info.length == 3) operand = fetch_word<Accuracy>();
+    (this->*handler)(operand);
+}
+
+template<typename Accuracy>
+constexpr std::array<CPU::Handler, 256> CPU::make_handler_table()
+{
+    std::array<Handler, 256> table{};
+    #define M6502_HANDLER_ENTRY(opcode) table[opcode] = &CPU::ins_fetch<Accuracy, opcode>;
+    M6502_FOR_EACH_OPCODE(M6502_HANDLER_ENTRY)
+    #undef M6502_HANDLER_ENTRY
+    return table;
+}
+
+template<typename Accuracy>
+constexpr std::array<CPU::Handler, 256> CPU::handler_table = CPU::make_handler_table<Accuracy>();
+
+// calls the handler of a known opcode, lets the compiler inline it
+template<typename Accuracy, byte opcode>
+M6502_ALWAYS_INLINE void CPU::invoke()
+{
+    constexpr Handler handler = handler_table<Accuracy>[opcode];
+    (this->*handler)();
+}
+
+// records the state before the next instruction when the policy traces,
+// or counts it
+template<typename Trace>
+M6502_ALWAYS_INLINE void CPU::trace_instruction(Trace& trace)
+{
+    if constexpr (std::is_same_v<Trace, Profiler>)
+    {
+        trace.instruction(PC, mem_ref.peek(PC), cycles);
+    }
+    else if constexpr (std::is_same_v<Trace, InstructionCount>)
+    {
+        trace.count++;
+    }
+    else if constexpr (Trace::enabled)
+    {
+        TraceRecord& record = trace.next();
+        record.PC = PC;
+        record.opcode = mem_ref.peek(PC);
+        record.operands[0] = mem_ref.peek(PC + 1);
+        record.operands[1] = mem_ref.peek(PC + 2);
+        record.A = A;
+        record.X = X;
+        record.Y = Y;
+        record.SP = SP;
+        record.PS = PS;
+        record.cycles = cycles;
+    }
+}
+
+ExecuteResult CPU::execute(s32 cycle_count)
+{
+#if defined(M6502_DISPATCH_BLOCKS) || defined(M6502_DISPATCH_JIT)
+    if (!engine_cache)
+    {
+        engine_cache.reset(new BlockCache(mem_ref));
+    #if defined(M6502_DISPATCH_JIT)
+        engine_cache->enable_jit(0);
+    #endif
+    }
+    return execute(cycle_count, *engine_cache);
+#elif defined(M6502_DISPATCH_SWITCH)
+    return execute_switch(cycle_count);
+#elif defined(M6502_DISPATCH_TABLE) || !M6502_HAS_COMPUTED_GOTO
+    return execute_table(cycle_count);
+#else
+    return execute_threaded(cycle_count);
+#endif
+}
+
+#if defined(M6502_DISPATCH_BLOCKS) || defined(M6502_DISPATCH_JIT)
+void CPU::CacheDeleter::operator()(BlockCache* cache) const
+{
+    delete cache;
+}
+#endif
+
+// the block engine counts exactly and has no per instruction hooks, the
+// policies run through the plain loops
+template<typename Accuracy, typename Trace, typename Stop>
+ExecuteResult CPU::run(s32 cycle_count, Trace& trace, Stop& stop)
+{
+#if defined(M6502_DISPATCH_SWITCH)
+    return run_switch<Accuracy>(cycle_count, trace, stop);
+#elif defined(M6502_DISPATCH_TABLE) || !M6502_HAS_COMPUTED_GOTO
+    return run_table<Accuracy>(cycle_count, trace, stop);
+#else
+    return run_threaded<Accuracy>(cycle_count, trace, stop);
+#endif
+}
+
+// cycles in the result are as counted by the accuracy policy
+template<typename Accuracy>
+ExecuteResult CPU::execute(s32 cycle_count)
+{
+    NoTrace trace;
+    NoStop stop;
+    return run<Accuracy>(cycle_count, trace, stop);
+}
+
+ExecuteResult CPU::execute(s32 cycle_count, TraceRing& trace)
+{
+    NoStop stop;
+    return run<CycleExact>(cycle_count, trace, stop);
+}
+
+ExecuteResult CPU::execute(s32 cycle_count, InstructionCount& count)
+{
+    NoStop stop;
+    return run<CycleExact>(cycle_count, count, stop);
+}
+
+// the last instruction is charged once its cycles are known
+ExecuteResult CPU::execute(s32 cycle_count, Profiler& profiler)
+{
+    NoStop stop;
+    profiler.start(PC, cycle_count);
+    const ExecuteResult result = run<CycleExact>(cycle_count, profiler, stop);
+    profiler.finish(PC, cycles);
+    return result;
+}
+
+template<u32 conditions>
+ExecuteResult CPU::run_until_conditions(s32 cycle_count, const RunUntil& until)
+{
+    NoTrace trace;
+    StopWhen<conditions> stop(until);
+    return run<CycleExact>(cycle_count, trace, stop);
+}
+
+// one loop per combination of conditions in use, with none it is the loop
+// execute<CycleExact> runs
+ExecuteResult CPU::run_until(s32 cycle_count, const RunUntil& until)
+{
+    const u32 conditions = (until.breakpoints && !until.breakpoints->empty() ? UNTIL_BREAKPOINT : 0)
+        | (until.instructions ? UNTIL_INSTRUCTIONS : 0)
+        | (until.predicate ? UNTIL_PREDICATE : 0);
+    switch (conditions)
+    {
+    case UNTIL_BREAKPOINT:
+        return run_until_conditions<UNTIL_BREAKPOINT>(cycle_count, until);
+    case UNTIL_INSTRUCTIONS:
+        return run_until_conditions<UNTIL_INSTRUCTIONS>(cycle_count, until);
+    case UNTIL_BREAKPOINT | UNTIL_INSTRUCTIONS:
+        return run_until_conditions<UNTIL_BREAKPOINT | UNTIL_INSTRUCTIONS>(cycle_count, until);
+    case UNTIL_PREDICATE:
+        return run_until_conditions<UNTIL_PREDICATE>(cycle_count, until);
+    case UNTIL_BREAKPOINT | UNTIL_PREDICATE:
+        return run_until_conditions<UNTIL_BREAKPOINT | UNTIL_PREDICATE>(cycle_count, until);
+    case UNTIL_INSTRUCTIONS | UNTIL_PREDICATE:
+        return run_until_conditions<UNTIL_INSTRUCTIONS | UNTIL_PREDICATE>(cycle_count, until);
+    case UNTIL_BREAKPOINT | UNTIL_INSTRUCTIONS | UNTIL_PREDICATE:
+        return run_until_conditions<UNTIL_BREAKPOINT | UNTIL_INSTRUCTIONS | UNTIL_PREDICATE>(cycle_count, until);
+    default:
+        return execute<CycleExact>(cycle_count);
+    }
+}
+
+ExecuteResult CPU::run_until(s32 cycle_count, const Breakpoints& breakpoints)
+{
+    RunUntil until;
+    until.breakpoints = &breakpoints;
+    return run_until(cycle_count, until);
+}
+
+s32 CPU::execute_checked(s32 cycle_count)
+{
+    const ExecuteResult result = execute(cycle_count);
+    if (result.reason == StopReason::ILLEGAL_OPCODE || result.reason == StopReason::HALT)
+    {
+        throw UnknownInstructionException(result.opcode, result.PC);
+    }
+    return result.cycles;
+}
+
+// puts back the cycles request_stop moved aside, the instruction that
+// stopped may have charged more since
+M6502_ALWAYS_INLINE ExecuteResult CPU::stop_result(s32 start_cycles)
+{
+    if (stop_reason != StopReason::BUDGET) [[unlikely]]
+    {
+        cycles += stop_cycles;
+    }
+    return { start_cycles - cycles, stop_reason, PC, mem_ref.peek(PC) };
+}
+
+// records the stop policy's reason, unless a handler already stopped the loop
+template<typename Stop>
+M6502_ALWAYS_INLINE bool CPU::stop_after_instruction(Stop& stop)
+{
+    if constexpr (Stop::enabled)
+    {
+        const StopReason reason = stop.check(*this);
+        if (reason != StopReason::BUDGET && stop_reason == StopReason::BUDGET) [[unlikely]]
+        {
+            stop_reason = reason;
+            return true;
+        }
+    }
+    return false;
+}
+
+ExecuteResult CPU::execute_switch(s32 cycle_count)
+{
+    NoTrace trace;
+    NoStop stop;
+    return run_switch<CycleExact>(cycle_count, trace, stop);
+}
+
+ExecuteResult CPU::execute_table(s32 cycle_count)
+{
+    NoTrace trace;
+    NoStop stop;
+    return run_table<CycleExact>(cycle_count, trace, stop);
+}
+
+#if M6502_HAS_COMPUTED_GOTO
+ExecuteResult CPU::execute_threaded(s32 cycle_count)
+{
+    NoTrace trace;
+    NoStop stop;
+    return run_threaded<CycleExact>(cycle_count, trace, stop);
+}
+#endif
+
+// reference engine, one switch over every opcode
+template<typename Accuracy, typename Trace, typename Stop>
+M6502_ALWAYS_INLINE ExecuteResult CPU::run_switch(s32 cycle_count, Trace& trace, Stop& stop)
+{
+    this->cycles = cycle_count;
+    stop_reason = StopReason::BUDGET;
+    stop_cycles = 0;
+
+    const s32 start_cycles = cycles;
+    while (cycles > 0)
+    {
+        trace_instruction(trace);
+        byte instruction = fetch_byte<Accuracy>();
+        switch (instruction)
+        {
+        #define M6502_SWITCH_CASE(opcode) case opcode: invoke<Accuracy, opcode>(); break;
+        M6502_FOR_EACH_OPCODE(M6502_SWITCH_CASE)
+        #undef M6502_SWITCH_CASE
+        }
+        if (stop_after_instruction(stop)) break;
+    }
+
+    return stop_result(start_cycles);
+}
+
+// indirect call through the handler table
+template<typename Accuracy, typename Trace, typename Stop>
+M6502_ALWAYS_INLINE ExecuteResult CPU::run_table(s32 cycle_count, Trace& trace, Stop& stop)
+{
+    this->cycles = cycle_count;
+    stop_reason = StopReason::BUDGET;
+    stop_cycles = 0;
+
+    const s32 start_cycles = cycles;
+    while (cycles > 0)
+    {
+        trace_instruction(trace);
+        byte instruction = fetch_byte<Accuracy>();
+        (this->*handler_table<Accuracy>[instruction])();
+        if (stop_after_instruction(stop)) break;
+    }
+
+    return stop_result(start_cycles);
+}
+
+#if M6502_HAS_COMPUTED_GOTO
+// direct threaded code, every handler ends with its own indirect jump to the
+// next one so the branch predictor sees one jump per opcode instead of one
+// shared by all of them
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+template<typename Accuracy, typename Trace, typename Stop>
+ExecuteResult CPU::run_threaded(s32 cycle_count, Trace& trace, Stop& stop)
+{
+    this->cycles = cycle_count;
+    stop_reason = StopReason::BUDGET;
+    stop_cycles = 0;
+
+    #define M6502_LABEL_ADDRESS(opcode) &&op_##opcode,
+    static void* const dispatch_table[256] = {
+        M6502_FOR_EACH_OPCODE(M6502_LABEL_ADDRESS)
+    };
+    #undef M6502_LABEL_ADDRESS
+
+    #define M6502_DISPATCH()                        \
+        if (cycles <= 0) goto done;                 \
+        trace_instruction(trace);                   \
+        goto *dispatch_table[fetch_byte<Accuracy>()]
+
+    const s32 start_cycles = cycles;
+    M6502_DISPATCH();
+
+    #define M6502_THREADED_LABEL(opcode)                            \
+        op_##opcode: invoke<Accuracy, opcode>();                    \
+        if (stop_after_instruction(stop)) goto done;                \
+        M6502_DISPATCH();
+    M6502_FOR_EACH_OPCODE(M6502_THREADED_LABEL)
+    #undef M6502_THREADED_LABEL
+    #undef M6502_DISPATCH
+
+done:
+    return stop_result(start_cycles);
+}
+#pragma GCC diagnostic pop
+#endif
+
+template ExecuteResult CPU::execute<CycleExact>(s32);
+template ExecuteResult CPU::execute<Functional>(s32);
+
+// decodes the straight-line run starting at PC into a new cache block, adds
+// nothing when the first instruction can not be decoded
+void CPU::decode_block(BlockCache& cache)
+{
+    if (cache.ops.size() + BlockCache::MAX_BLOCK_OPS > BlockCache::MAX_OPS)
+    {
+        cache.flush();
+    }
+
+    const u32 first_op = (u32)cache.ops.size();
+    u64 pages[Memory::PAGE_COUNT / 64] = {};
+    word address = PC;
+    for (u32 i = 0; i < BlockCache::MAX_BLOCK_OPS; i++)
+    {
+        const byte instruction = mem_ref.peek(address);
+        const OpInfo& info = opcode_info[instruction];
+        const byte size = info.length;
+
+        // fetching from I/O pages has side effects, leave those to the interpreter
+        bool decodable = info.implemented();
+        for (word offset = 0; offset < size; offset++)
+        {
+            decodable = decodable && !mem_ref.is_io_page((word)(address + offset) >> 8);
+        }
+        if (!decodable) break;
+
+        word operand = 0;
+        for (word offset = size - 1; offset > 0; offset--)
+        {
+            operand = (operand << 8) | mem_ref.peek(address + offset);
+        }
+        cache.ops.push_back({ opcode_table<CycleExact>[instruction], operand, size, instruction });
+
+        for (word offset = 0; offset < size; offset++)
+        {
+            const byte page = (word)(address + offset) >> 8;
+            pages[page >> 6] |= 1ull << (page & 63);
+        }
+        address += size;
+
+        if (info.sets_pc) break;
+    }
+
+    if (cache.ops.size() > first_op)
+    {
+        cache.add_block(PC, first_op, pages);
+    }
+}
+
+ExecuteResult CPU::execute(s32 cycle_count, BlockCache& cache)
+{
+    assert(&cache.memory() == &mem_ref);
+    cache.attach();
+    this->cycles = cycle_count;
+    stop_reason = StopReason::BUDGET;
+    stop_cycles = 0;
+
+    const s32 start_cycles = cycles;
+    while (cycles > 0)
+    {
+        BlockCache::Block* block = cache.find(PC);
+        if (!block)
+        {
+            decode_block(cache);
+            block = cache.find(PC);
+        }
+        if (!block)
+        {
+            // I/O page or unknown opcode
+            (this->*handler_table<CycleExact>[fetch_byte<CycleExact>()])();
+            continue;
+        }
+
+    #if M6502_HAS_JIT
+        if (cache.jit && !block->native && !block->native_failed && block->hits++ >= cache.jit_threshold)
+        {
+            if (!cache.jit->compile(*block))
+            {
+                // out of code space, start over with the next block
+                cache.flush();
+                continue;
+            }
+        }
+        // native blocks charge their cycles up front, only enter them when
+        // the budget covers every instruction
+        if (block->native && cycles > block->native_max_cycles)
+        {
+            JitState& state = cache.jit->state;
+            state.PC = PC;
+            state.A = A;
+            state.X = X;
+            state.Y = Y;
+            state.SP = SP;
+            state.PS = PS;
+            state.cycles = cycles;
+            cache.invalidated = false;
+            block->native(&state);
+            PC = state.PC;
+            A = state.A;
+            X = state.X;
+            Y = state.Y;
+            SP = state.SP;
+            PS = state.PS;
+            cycles = state.cycles;
+            if (stop_reason != StopReason::BUDGET) [[unlikely]]
+            {
+                // stopped inside the block, cycles has been overwritten
+                stop_cycles = 0;
+                break;
+            }
+            continue;
+        }
+    #endif
+
+        // same per instruction cycle check as the interpreters, and stop
+        // once a write dropped blocks as the rest may be stale
+        cache.invalidated = false;
+        const BlockCache::Op* op = cache.ops.data() + block->first_op;
+        const BlockCache::Op* const end = op + block->op_count;
+        do
+        {
+            PC += op->size;
+            cycles -= op->size;
+            (this->*op->handler)(op->operand);
+        } while (++op != end && cycles > 0 && !cache.invalidated);
+    }
+
+    return stop_result(start_cycles);
 }
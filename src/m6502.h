@@ -6,39 +6,283 @@
 namespace emulator6502 {
     #define CHECK_BIT(var, pos) ((var >> (pos)) & 1)
 
+    // dispatch engine behind CPU::execute, chosen at build time with one of
+    // M6502_DISPATCH_SWITCH, M6502_DISPATCH_TABLE or M6502_DISPATCH_THREADED,
+    // or M6502_DISPATCH_BLOCKS / M6502_DISPATCH_JIT to run every block
+    // through a BlockCache owned by the CPU
+    #if defined(__GNUC__)
+        #define M6502_HAS_COMPUTED_GOTO 1
+    #else
+        #define M6502_HAS_COMPUTED_GOTO 0
+    #endif
+
+    // native code generation for BlockCache, x86-64 Linux only
+    #if defined(__x86_64__) && defined(__linux__) && !defined(M6502_NO_JIT)
+        #define M6502_HAS_JIT 1
+    #else
+        #define M6502_HAS_JIT 0
+    #endif
+
+    // keeps the hot path of the dispatch loops in one function
+    #if defined(__GNUC__)
+        #define M6502_ALWAYS_INLINE __attribute__((always_inline)) inline
+        #define M6502_COLD __attribute__((cold, noinline))
+    #else
+        #define M6502_ALWAYS_INLINE inline
+        #define M6502_COLD
+    #endif
+
     // specific sized types
     using byte = unsigned char; // 8 bits
     using word = unsigned short; // 16 bits
 
     using u32 = unsigned int;
     using s32 = signed int;
+    using u64 = unsigned long long;
+    using s64 = signed long long;
 
-    // special exception
+    // thrown by CPU::execute_checked, execute itself reports the opcode in
+    // its result instead
     class UnknownInstructionException : public std::exception
     {
     public:
-        explicit UnknownInstructionException(const char* msg) : _msg(msg)
-        {}
+        UnknownInstructionException(byte opcode, word pc) : opcode(opcode), PC(pc)
+        {
+            snprintf(msg, sizeof(msg), "Unknown instruction: 0x%02X at 0x%04X", opcode, pc);
+        }
 
-        char* what()
+        const char* what() const noexcept override
         {
-            return const_cast<char*>(_msg);
+            return msg;
         }
+
+        byte opcode;
+        word PC;
     private:
-        const char* _msg;
+        char msg[40];
+    };
+
+    // why CPU::execute returned
+    enum class StopReason : byte
+    {
+        BUDGET = 0,            // the cycle budget ran out
+        ILLEGAL_OPCODE = 1,    // opcode without a handler
+        BREAKPOINT = 2,        // reached a breakpoint
+        HALT = 3,              // one of the NMOS JAM opcodes, the CPU locks up
+        INSTRUCTION_LIMIT = 4, // ran the instruction count given to run_until
+        PREDICATE = 5,         // the run_until predicate returned true
+        WATCHPOINT = 6,        // a watched address was accessed, see CPU::stop_on_watch
     };
 
+    struct ExecuteResult
+    {
+        s32 cycles; // cycles used
+        StopReason reason;
+        // next instruction to run, the one that stopped execution unless
+        // the budget ran out
+        word PC;
+        byte opcode;
+    };
+
+    /**
+     * 64K address space behind a 256 entry page table. Each page is either
+     * plain memory, read and written through a pointer, or a memory mapped
+     * I/O page whose accesses go to a registered handler. ROM pages are read
+     * through a pointer and ignore writes.
+     *
+     * operator[] and write_word always access data directly, bypassing the
+     * page table, and are meant for loading programs from the host side.
+     *
+     * Every page written to, by the CPU or the host, is marked dirty so a
+     * recorded baseline image can be restored by copying back only those,
+     * and so a state diff (see save_state.h) can carry only those. Marking
+     * costs one OR per write; built with M6502_NO_DIRTY_PAGES it is left
+     * out and every page counts as dirty.
+     *
+     * Pages holding decoded code (see BlockCache) can be write protected:
+     * the first change to such a page, from the CPU or the host, calls the
+     * code observer with the page and lifts the protection.
+     *
+     * Watched addresses call the watch observer after every bus read or
+     * write of them, opcode and operand fetches included (apart from those
+     * of blocks a BlockCache decoded before the watch). Pages holding a
+     * watch lose their page pointers so their accesses reach the slow path,
+     * which checks the address; other pages keep the fast path. Watches
+     * are not copied with the Memory.
+    */
     struct Memory
     {
         static constexpr u32 MAX_MEMORY = 1024 * 64;
+        static constexpr u32 PAGE_SIZE = 256;
+        static constexpr u32 PAGE_COUNT = MAX_MEMORY / PAGE_SIZE;
+    #if defined(M6502_NO_DIRTY_PAGES)
+        static constexpr bool TRACK_DIRTY_PAGES = false;
+    #else
+        static constexpr bool TRACK_DIRTY_PAGES = true;
+    #endif
+
+        // callbacks of a memory mapped I/O page, context is passed back as is
+        struct IOHandler
+        {
+            byte (*read)(void* context, word address) = nullptr;
+            void (*write)(void* context, word address, byte value) = nullptr;
+            void* context = nullptr;
+        };
+
         byte data[MAX_MEMORY];
 
+        Memory();
+        Memory(const Memory&);
+        Memory& operator=(const Memory&);
+
+        // zero all of data
         void init();
+        // record data as the baseline image, and restore it
+        void save_baseline();
+        void restore_baseline();
+        /** @return true for pages written since the baseline was saved */
+        bool is_dirty(byte page) const { return has_bit(dirty_pages, page) || has_bit(sent_pages, page); }
         byte operator[](word) const;
         byte& operator[](word);
         void write_word(word, word);
+        // copies size bytes into data from address on, as operator[] would,
+        // stopping at the end of memory
+        void load(word address, const byte* image, u32 size);
+
+        // bus accesses, as seen by the CPU
+        byte read(word);
+        void write(word, byte);
+        // read without triggering I/O handlers, I/O pages read as data
+        byte peek(word) const;
+
+        // page mapping, pages are inclusive ranges
+        void map_ram(byte first_page, byte last_page);
+        void map_rom(byte first_page, byte last_page, const byte* image = nullptr);
+        void map_io(byte first_page, byte last_page, const IOHandler&);
+        /** @return true for pages whose reads go to an I/O handler or a watch */
+        bool is_io_page(byte page) const { return !read_pages[page]; }
+
+        // code write protection, setting a new observer lifts every protection
+        using CodeObserver = void (*)(void* context, byte page);
+        void set_code_observer(CodeObserver, void* context);
+        bool has_code_observer(void* context) const { return code_observer && code_context == context; }
+        void protect_code(byte page);
+
+        // watchpoints, value is the byte read or written
+        using WatchObserver = void (*)(void* context, word address, byte value, bool write);
+        void set_watch_observer(WatchObserver, void* context);
+        void watch(word address, bool read, bool write);
+        void unwatch(word address);
+        void clear_watches();
+        bool is_watched(word address, bool write) const
+        {
+            return has_bit(write ? write_watches : read_watches, address);
+        }
+
+    private:
+        // nullptr sends the access to the slow path (I/O or ignored write)
+        const byte* read_pages[PAGE_COUNT];
+        byte* write_pages[PAGE_COUNT];
+        IOHandler io_handlers[PAGE_COUNT];
+
+        // one bit per page written since the baseline was saved or the last
+        // state diff, whichever came later, all set when not tracked. Pages
+        // written since the baseline are these and those sent by a diff
+        // since; a diff sends these and those it has not sent yet that were
+        // written before the baseline, or copied back by restoring it
+        u64 dirty_pages[PAGE_COUNT / 64];
+        u64 sent_pages[PAGE_COUNT / 64] = {};
+        u64 unsent_pages[PAGE_COUNT / 64] = {};
+        std::unique_ptr<byte[]> baseline;
+
+        void mark_dirty(word address)
+        {
+            if constexpr (TRACK_DIRTY_PAGES)
+            {
+                dirty_pages[address >> 14] |= 1ull << ((address >> 8) & 63);
+            }
+        }
+
+        // protected code pages, and those of them that are writable RAM
+        u64 code_pages[PAGE_COUNT / 64] = {};
+        u64 code_ram_pages[PAGE_COUNT / 64] = {};
+        CodeObserver code_observer = nullptr;
+        void* code_context = nullptr;
+
+        void check_code(u32 page)
+        {
+            if ((code_pages[page >> 6] >> (page & 63)) & 1) [[unlikely]] code_written(page);
+        }
+
+        M6502_COLD void code_written(u32 page);
+        void release_code(bool notify);
+
+        // one bit per watched address, and per page holding any of them
+        u64 read_watches[MAX_MEMORY / 64] = {};
+        u64 write_watches[MAX_MEMORY / 64] = {};
+        u64 read_watch_pages[PAGE_COUNT / 64] = {};
+        u64 write_watch_pages[PAGE_COUNT / 64] = {};
+        // what read_pages and write_pages hold for a watched page without
+        // the watch
+        const byte* watched_read_pages[PAGE_COUNT];
+        byte* watched_write_pages[PAGE_COUNT];
+        WatchObserver watch_observer = nullptr;
+        void* watch_context = nullptr;
+
+        static bool has_bit(const u64* bits, u32 index)
+        {
+            return (bits[index >> 6] >> (index & 63)) & 1;
+        }
+        // page pointers as mapped, whether watched or not
+        const byte* mapped_read_page(u32 page) const
+        {
+            return has_bit(read_watch_pages, page) ? watched_read_pages[page] : read_pages[page];
+        }
+        byte* mapped_write_page(u32 page) const
+        {
+            return has_bit(write_watch_pages, page) ? watched_write_pages[page] : write_pages[page];
+        }
+        void set_read_page(u32 page, const byte*);
+        void set_write_page(u32 page, byte*);
+        void update_watch_page(u32 page);
+        byte read_io(word);
+        void write_io(word, byte);
+
+        M6502_COLD byte read_slow(word);
+        M6502_COLD void write_slow(word, byte);
+        void rebase_pages(const Memory&);
+
+        friend struct StateAccess;
+        friend class X64Jit;
     };
 
+    M6502_ALWAYS_INLINE byte Memory::read(word address)
+    {
+        if (const byte* page = read_pages[address >> 8]) [[likely]]
+        {
+            return page[address & 0xFF];
+        }
+        return read_slow(address);
+    }
+
+    M6502_ALWAYS_INLINE void Memory::write(word address, byte value)
+    {
+        if (byte* page = write_pages[address >> 8]) [[likely]]
+        {
+            mark_dirty(address);
+            page[address & 0xFF] = value;
+            return;
+        }
+        write_slow(address, value);
+    }
+
+    class TraceRing;
+    struct InstructionCount;
+    class Profiler;
+    struct RunUntil;
+    class Breakpoints;
+    class BlockCache;
+
     struct StatusFlags
     {
         byte C : 1;
@@ -51,6 +295,17 @@ namespace emulator6502 {
         byte N : 1;
     };
 
+    // StatusFlags bits within PS, bitfields are allocated from bit 0
+    constexpr byte FLAG_C = 0x01, FLAG_Z = 0x02, FLAG_I = 0x04, FLAG_D = 0x08,
+                   FLAG_B = 0x10, FLAG_U = 0x20, FLAG_V = 0x40, FLAG_N = 0x80;
+
+    // cycle accounting policies for CPU::execute<Accuracy>, both run the
+    // same handlers
+    // counts every bus access and internal cycle, page crossings included
+    struct CycleExact { static constexpr bool per_access = true; };
+    // charges each instruction its base cost from the opcode table
+    struct Functional { static constexpr bool per_access = false; };
+
     struct CPU 
     {
         word PC; // program counter
@@ -66,9 +321,49 @@ namespace emulator6502 {
 
         explicit CPU(Memory&);
         void set_memory(Memory&);
-        void reset(word = 0xFFFC);
+        // resets registers only, memory is cleared on request
+        void reset(word = 0xFFFC, bool clear_memory = false);
         word sp_to_address() const;
-        s32 execute(s32);
+        // runs until the cycle budget is used up or an opcode stops it, PC
+        // is left on a stopping opcode so it is not skipped
+        ExecuteResult execute(s32);
+        // as execute, with the cycle accounting of a policy above
+        template<typename Accuracy>
+        ExecuteResult execute(s32);
+        // as execute, recording every instruction into the ring
+        ExecuteResult execute(s32, TraceRing&);
+        // as execute, adding the instructions run to the count (see trace.h)
+        ExecuteResult execute(s32, InstructionCount&);
+        // as execute, counting into the profiler (see profiler.h)
+        ExecuteResult execute(s32, Profiler&);
+        // as execute, running predecoded blocks from the cache
+        ExecuteResult execute(s32, BlockCache&);
+        // as execute, also stopping on the conditions (see breakpoints.h),
+        // always interpreted
+        ExecuteResult run_until(s32, const RunUntil&);
+        ExecuteResult run_until(s32, const Breakpoints&);
+        /**
+         * As execute, for callers that prefer exceptions.
+         * @return number of cycles used
+         * @throws UnknownInstructionException on ILLEGAL_OPCODE and HALT
+        */
+        s32 execute_checked(s32);
+        // ends execute after the current instruction, meant for I/O handlers
+        // and watch observers called from within it; the first reason
+        // requested is kept. Native JIT blocks stop at their end.
+        void request_stop(StopReason);
+        // cycles left of the running execute's budget, meant for I/O handlers
+        // as well; native JIT blocks only bring it up to date at their end
+        s32 cycles_left() const { return cycles + stop_cycles; }
+        // watch observer stopping the CPU given as context with WATCHPOINT
+        static void stop_on_watch(void* cpu, word address, byte value, bool write);
+
+        // individual dispatch engines, execute() forwards to one of these
+        ExecuteResult execute_switch(s32);
+        ExecuteResult execute_table(s32);
+    #if M6502_HAS_COMPUTED_GOTO
+        ExecuteResult execute_threaded(s32);
+    #endif
 
         /**
          * IM  : Imediate
@@ -135,7 +430,6 @@ namespace emulator6502 {
             INS_PLA          = 0x68,
             INS_PLP          = 0x28,
         // ~~~~~~~~~~~~~~~~ Logical ~~~~~~~~~~~~~~~~
-        // TODO Implement logical insturctions
             INS_AND_IM       = 0x29,
             INS_AND_ZP       = 0x25,
             INS_AND_ZPX      = 0x35,
@@ -164,49 +458,297 @@ namespace emulator6502 {
             INS_ORA_IY       = 0x11,
         // BIT
             INS_BIT_ZP       = 0x24,
-            INS_BIT_ABS      = 0x2C;
+            INS_BIT_ABS      = 0x2C,
+        // ~~~~~~~~~~~~~~~~ Arithmetic ~~~~~~~~~~~~~~~~
+        // ADC
+            INS_ADC_IM       = 0x69,
+            INS_ADC_ZP       = 0x65,
+            INS_ADC_ZPX      = 0x75,
+            INS_ADC_ABS      = 0x6D,
+            INS_ADC_AX       = 0x7D,
+            INS_ADC_AY       = 0x79,
+            INS_ADC_IX       = 0x61,
+            INS_ADC_IY       = 0x71,
+        // SBC
+            INS_SBC_IM       = 0xE9,
+            INS_SBC_ZP       = 0xE5,
+            INS_SBC_ZPX      = 0xF5,
+            INS_SBC_ABS      = 0xED,
+            INS_SBC_AX       = 0xFD,
+            INS_SBC_AY       = 0xF9,
+            INS_SBC_IX       = 0xE1,
+            INS_SBC_IY       = 0xF1,
+        // CMP
+            INS_CMP_IM       = 0xC9,
+            INS_CMP_ZP       = 0xC5,
+            INS_CMP_ZPX      = 0xD5,
+            INS_CMP_ABS      = 0xCD,
+            INS_CMP_AX       = 0xDD,
+            INS_CMP_AY       = 0xD9,
+            INS_CMP_IX       = 0xC1,
+            INS_CMP_IY       = 0xD1,
+        // CPX
+            INS_CPX_IM       = 0xE0,
+            INS_CPX_ZP       = 0xE4,
+            INS_CPX_ABS      = 0xEC,
+        // CPY
+            INS_CPY_IM       = 0xC0,
+            INS_CPY_ZP       = 0xC4,
+            INS_CPY_ABS      = 0xCC,
+        // ~~~~~~~~~~~~~~~~ Increments & Decrements ~~~~~~~~~~~~~~~~
+            INS_INC_ZP       = 0xE6,
+            INS_INC_ZPX      = 0xF6,
+            INS_INC_ABS      = 0xEE,
+            INS_INC_AX       = 0xFE,
+            INS_INX          = 0xE8,
+            INS_INY          = 0xC8,
+            INS_DEC_ZP       = 0xC6,
+            INS_DEC_ZPX      = 0xD6,
+            INS_DEC_ABS      = 0xCE,
+            INS_DEC_AX       = 0xDE,
+            INS_DEX          = 0xCA,
+            INS_DEY          = 0x88,
+        // ~~~~~~~~~~~~~~~~ Shifts ~~~~~~~~~~~~~~~~
+        // ASL
+            INS_ASL_A        = 0x0A,
+            INS_ASL_ZP       = 0x06,
+            INS_ASL_ZPX      = 0x16,
+            INS_ASL_ABS      = 0x0E,
+            INS_ASL_AX       = 0x1E,
+        // LSR
+            INS_LSR_A        = 0x4A,
+            INS_LSR_ZP       = 0x46,
+            INS_LSR_ZPX      = 0x56,
+            INS_LSR_ABS      = 0x4E,
+            INS_LSR_AX       = 0x5E,
+        // ROL
+            INS_ROL_A        = 0x2A,
+            INS_ROL_ZP       = 0x26,
+            INS_ROL_ZPX      = 0x36,
+            INS_ROL_ABS      = 0x2E,
+            INS_ROL_AX       = 0x3E,
+        // ROR
+            INS_ROR_A        = 0x6A,
+            INS_ROR_ZP       = 0x66,
+            INS_ROR_ZPX      = 0x76,
+            INS_ROR_ABS      = 0x6E,
+            INS_ROR_AX       = 0x7E,
+        // ~~~~~~~~~~~~~~~~ Branches ~~~~~~~~~~~~~~~~
+            INS_BCC          = 0x90,
+            INS_BCS          = 0xB0,
+            INS_BEQ          = 0xF0,
+            INS_BMI          = 0x30,
+            INS_BNE          = 0xD0,
+            INS_BPL          = 0x10,
+            INS_BVC          = 0x50,
+            INS_BVS          = 0x70,
+        // ~~~~~~~~~~~~~~~~ Status Flag Changes ~~~~~~~~~~~~~~~~
+            INS_CLC          = 0x18,
+            INS_CLD          = 0xD8,
+            INS_CLI          = 0x58,
+            INS_CLV          = 0xB8,
+            INS_SEC          = 0x38,
+            INS_SED          = 0xF8,
+            INS_SEI          = 0x78,
+        // ~~~~~~~~~~~~~~~~ Register Transfers ~~~~~~~~~~~~~~~~
+            INS_TAX          = 0xAA,
+            INS_TAY          = 0xA8,
+            INS_TXA          = 0x8A,
+            INS_TYA          = 0x98,
+        // ~~~~~~~~~~~~~~~~ System Functions ~~~~~~~~~~~~~~~~
+            INS_BRK          = 0x00,
+            INS_RTI          = 0x40,
+            INS_NOP          = 0xEA;
 
     private:
         Memory& mem_ref;
         s32 cycles;
+        // set by request_stop, which ends the dispatch loop by moving the
+        // cycles left into stop_cycles so the loops need no check of their own
+        StopReason stop_reason = StopReason::BUDGET;
+        s32 stop_cycles = 0;
+
+        friend struct StateAccess;
+
+        // per-opcode handlers, they run once the opcode and its operand
+        // bytes (little endian) have been fetched. How many bytes that is
+        // and what the instruction costs comes from opcode_info (opcodes.h)
+        using OperandHandler = void (CPU::*)(word);
+        template<typename Accuracy>
+        static const std::array<OperandHandler, 256> opcode_table;
+        template<typename Accuracy>
+        static constexpr std::array<OperandHandler, 256> make_opcode_table();
+        // addressing mode function of an opcode, as opcode_info describes it
+        using AddressHandler = word (CPU::*)(word);
+        template<typename Accuracy, byte opcode>
+        static constexpr AddressHandler address_mode_of();
+
+        // per-opcode instruction handlers including the operand fetch,
+        // indexed by opcode
+        using Handler = void (CPU::*)();
+        template<typename Accuracy>
+        static const std::array<Handler, 256> handler_table;
+        template<typename Accuracy>
+        static constexpr std::array<Handler, 256> make_handler_table();
+
+        template<typename Accuracy, byte opcode>
+        void ins_fetch();
+
+        template<typename Accuracy, byte opcode>
+        void invoke();
+
+        // dispatch loops, parameterised on an accuracy policy, a trace
+        // policy (see trace.h) and a stop policy (see breakpoints.h)
+        template<typename Accuracy, typename Trace, typename Stop>
+        ExecuteResult run_switch(s32, Trace&, Stop&);
+        template<typename Accuracy, typename Trace, typename Stop>
+        ExecuteResult run_table(s32, Trace&, Stop&);
+    #if M6502_HAS_COMPUTED_GOTO
+        template<typename Accuracy, typename Trace, typename Stop>
+        ExecuteResult run_threaded(s32, Trace&, Stop&);
+    #endif
+        // the loop of the engine chosen at build time, blocks excepted
+        template<typename Accuracy, typename Trace, typename Stop>
+        ExecuteResult run(s32, Trace&, Stop&);
+        template<u32 conditions>
+        ExecuteResult run_until_conditions(s32, const RunUntil&);
+        ExecuteResult stop_result(s32 start_cycles);
+        template<typename Trace>
+        void trace_instruction(Trace&);
+        template<typename Stop>
+        bool stop_after_instruction(Stop&);
+        void decode_block(BlockCache&);
+
+    #if defined(M6502_DISPATCH_BLOCKS) || defined(M6502_DISPATCH_JIT)
+        // cache behind execute(s32), created on first use
+        struct CacheDeleter { void operator()(BlockCache*) const; };
+        std::unique_ptr<BlockCache, CacheDeleter> engine_cache;
+    #endif
 
         // addressing modes
         // http://www.emulator101.com/6502-addressing-modes.html
 
-        // addressing mode functions
-        word address_mode_zero_page_and_immediate();
-        word address_mode_zero_page_x_offset();
-        word address_mode_zero_page_y_offset();
-        word address_mode_absolute();
-        word address_mode_absolute_x_offset();
-        word address_mode_absolute_y_offset();
-        word address_mode_indirect_x_offset();
-        word address_mode_indirect_y_offset();
+        // addressing mode functions, they take the fetched operand bytes
+        template<typename Accuracy>
+        word address_mode_zero_page_and_immediate(word);
+        template<typename Accuracy>
+        word address_mode_zero_page_x_offset(word);
+        template<typename Accuracy>
+        word address_mode_zero_page_y_offset(word);
+        template<typename Accuracy>
+        word address_mode_absolute(word);
+        template<typename Accuracy>
+        word address_mode_absolute_x_offset(word);
+        template<typename Accuracy>
+        word address_mode_absolute_y_offset(word);
+        template<typename Accuracy>
+        word address_mode_indirect_x_offset(word);
+        template<typename Accuracy>
+        word address_mode_indirect_y_offset(word);
 
         // extra cycle for corssing page boundary
-        word address_mode_abosolute_x_offset_with_page_cycle();
-        word address_mode_abosolute_y_offset_with_page_cycle();
-        word address_mode_indirect_x_offset_with_page_cycle();
-        word address_mode_indirect_y_offset_with_page_cycle();
+        template<typename Accuracy>
+        word address_mode_abosolute_x_offset_with_page_cycle(word);
+        template<typename Accuracy>
+        word address_mode_abosolute_y_offset_with_page_cycle(word);
+        template<typename Accuracy>
+        word address_mode_indirect_y_offset_with_page_cycle(word);
 
-        // sets zero flags if reg is zero, and negative flag if bit 7 of reg is set
-        void zero_and_negative_flag_set(byte reg)
+        // charges a bus access or internal cycle when the policy counts them
+        template<typename Accuracy>
+        void tick(s32 count)
         {
-            // set zero flag if reg is zero
-            flag.Z = (reg == 0);
-            // set negative flag if bit 7 of reg is set
-            flag.N = CHECK_BIT(reg, 7);
+            if constexpr (Accuracy::per_access) cycles -= count;
         }
 
+        // sets zero flags if reg is zero, and negative flag if bit 7 of reg is set
+        void zero_and_negative_flag_set(byte reg);
+
+        // instruction handlers
+        template<typename Accuracy, void (CPU::*operation)(byte)>
+        void ins_immediate(word);
+        template<typename Accuracy, word (CPU::*address_mode)(word), void (CPU::*operation)(byte), s32 extra_cycles = 0>
+        void ins_read(word);
+        template<typename Accuracy, word (CPU::*address_mode)(word), byte CPU::*reg, s32 extra_cycles = 0>
+        void ins_store(word);
+        template<typename Accuracy, word (CPU::*address_mode)(word), byte (CPU::*operation)(byte), s32 extra_cycles = 0>
+        void ins_modify(word);
+        template<typename Accuracy, byte (CPU::*operation)(byte)>
+        void ins_accumulator(word);
+        template<typename Accuracy, byte CPU::*reg, byte delta>
+        void ins_step(word);
+        template<typename Accuracy, byte CPU::*from, byte CPU::*to>
+        void ins_transfer(word);
+        template<typename Accuracy, byte mask, bool set>
+        void ins_branch(word);
+        template<typename Accuracy, byte mask, bool set>
+        void ins_flag(word);
+        template<typename Accuracy>
+        void ins_jsr(word);
+        template<typename Accuracy>
+        void ins_rts(word);
+        template<typename Accuracy>
+        void ins_jmp_abs(word);
+        template<typename Accuracy>
+        void ins_jmp_i(word);
+        template<typename Accuracy>
+        void ins_tsx(word);
+        template<typename Accuracy>
+        void ins_txs(word);
+        template<typename Accuracy>
+        void ins_pha(word);
+        template<typename Accuracy>
+        void ins_php(word);
+        template<typename Accuracy>
+        void ins_pla(word);
+        template<typename Accuracy>
+        void ins_plp(word);
+        template<typename Accuracy>
+        void ins_brk(word);
+        template<typename Accuracy>
+        void ins_rti(word);
+        template<typename Accuracy>
+        void ins_nop(word);
+        void ins_unknown(word);
+
+        // operations applied to the value read by an instruction
+        template<typename Accuracy, byte CPU::*reg>
+        void load_register(byte);
+        // weird names because and/or are keywords
+        void _and_(byte);
+        void eor(byte);
+        void _or_(byte);
+        void bit(byte);
+        void adc(byte);
+        void sbc(byte);
+        template<typename Accuracy, byte CPU::*reg>
+        void compare(byte);
+
+        // read-modify-write operations, they return the value to write back
+        byte asl(byte);
+        byte lsr(byte);
+        byte rol(byte);
+        byte ror(byte);
+        byte inc(byte);
+        byte dec(byte);
+
+        template<typename Accuracy>
         byte fetch_byte();
+        template<typename Accuracy>
         byte read_byte(word);
+        template<typename Accuracy>
         word fetch_word();
+        template<typename Accuracy>
         word read_word(word);
+        template<typename Accuracy>
         void write_byte(byte, word);
-        void write_word(word, word);
-        void push_pc_sp();
+        template<typename Accuracy>
+        void push_word_to_stack(word);
+        template<typename Accuracy>
         word pop_word_from_stack();
+        template<typename Accuracy>
         byte pop_byte_from_stack();
+        template<typename Accuracy>
         void push_byte_to_stack(byte);
     };
 }
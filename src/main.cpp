@@ -1,22 +1,238 @@
 #include "m6502.h"
+#include "loader.h"
+#include "replay.h"
+#include "trace.h"
+
+#include <chrono>
+#include <cstring>
+#include <optional>
 
 // CPU Emulator (6502)
 // http://www.6502.org/users/obelisk/6502/index.html
 // based off of: https://www.youtube.com/watch?v=qJgsuQoy9bc
+//
+// Headless runner: loads an image, runs it until it stops or the cycle
+// budget runs out, with a character output and input register wired to
+// stdout and stdin. What the guest reads from the console can be
+// recorded into an input log and replayed from it later. The exit status
+// is the StopReason (0 for a budget that ran out), or USAGE_ERROR; a
+// summary goes to stderr.
 
 using namespace emulator6502;
 
-int main()
+namespace
 {
+    constexpr int USAGE_ERROR = 64;
+    constexpr s32 SLICE = 1 << 24;
+
+    // registers of the console, the rest of their pages read and write as RAM
+    struct Console
+    {
+        Memory* mem;
+        word output;
+        word input;
+
+        static byte read(void* context, word address)
+        {
+            Console& console = *static_cast<Console*>(context);
+            if (address != console.input) return console.mem->data[address];
+            // the guest waits on input, so what it wrote so far is shown
+            fflush(stdout);
+            const int c = getchar();
+            return c == EOF ? 0 : (byte)c;
+        }
+
+        static void write(void* context, word address, byte value)
+        {
+            Console& console = *static_cast<Console*>(context);
+            if (address == console.output)
+            {
+                putchar(value);
+                return;
+            }
+            console.mem->data[address] = value;
+        }
+    };
+
+    const char* stop_reason_name(StopReason reason)
+    {
+        switch (reason)
+        {
+        case StopReason::BUDGET: return "cycle budget used up";
+        case StopReason::ILLEGAL_OPCODE: return "illegal opcode";
+        case StopReason::BREAKPOINT: return "breakpoint";
+        case StopReason::HALT: return "halted";
+        case StopReason::INSTRUCTION_LIMIT: return "instruction limit";
+        case StopReason::PREDICATE: return "predicate";
+        case StopReason::WATCHPOINT: return "watchpoint";
+        }
+        return "unknown";
+    }
+
+    int usage(const char* program)
+    {
+        fprintf(stderr,
+            "usage: %s [options] image\n"
+            "  image is raw, .prg or Intel .hex/.ihx\n"
+            "  -a address   load address of a raw image, default 0x0200\n"
+            "  -s address   start address, default the image's own\n"
+            "  -r           start at the reset vector in memory instead\n"
+            "  -c cycles    cycle budget, default until the program stops\n"
+            "  -o address   character output register, default 0xF001\n"
+            "  -i address   character input register, default 0xF004\n"
+            "  -R file      record the console input into an input log\n"
+            "  -P file      replay the console input from an input log\n"
+            "  -q           no summary\n"
+            "exit status, the StopReason of the run:\n",
+            program);
+        // up to the last StopReason, WATCHPOINT
+        for (byte reason = 0; reason <= (byte)StopReason::WATCHPOINT; reason++)
+        {
+            fprintf(stderr, "  %-2d %s\n", reason, stop_reason_name((StopReason)reason));
+        }
+        fprintf(stderr, "  %-2d usage or load error\n", USAGE_ERROR);
+        return USAGE_ERROR;
+    }
+
+    bool parse_number(const char* text, u64 max, u64& value)
+    {
+        char* end;
+        value = strtoull(text, &end, 0);
+        return *text && !*end && value <= max;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    u64 load_address = 0x0200, start = 0, budget = 0, output = 0xF001, input = 0xF004;
+    bool has_start = false, from_vector = false, quiet = false;
+    const char* image = nullptr;
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-a") == 0 && has_value)
+        {
+            if (!parse_number(argv[++i], 0xFFFF, load_address)) return usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && has_value)
+        {
+            if (!parse_number(argv[++i], 0xFFFF, start)) return usage(argv[0]);
+            has_start = true;
+        }
+        else if (strcmp(argv[i], "-r") == 0)
+        {
+            from_vector = true;
+        }
+        else if (strcmp(argv[i], "-c") == 0 && has_value)
+        {
+            if (!parse_number(argv[++i], ~0ull, budget) || budget == 0) return usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && has_value)
+        {
+            if (!parse_number(argv[++i], 0xFFFF, output)) return usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-i") == 0 && has_value)
+        {
+            if (!parse_number(argv[++i], 0xFFFF, input)) return usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-R") == 0 && has_value)
+        {
+            record_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-P") == 0 && has_value)
+        {
+            replay_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-q") == 0)
+        {
+            quiet = true;
+        }
+        else if (argv[i][0] != '-' && !image)
+        {
+            image = argv[i];
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+    if (!image || (record_path && replay_path)) return usage(argv[0]);
+
     Memory mem;
     CPU cpu(mem);
-    cpu.reset();
 
-    mem[0xFFFC] = CPU::INS_JSR;
-    mem[0xFFFD] = 0x42;
-    mem[0xFFFE] = 0x42;
+    const LoadedImage loaded = load_file(mem, image, (word)load_address);
+    if (loaded.size == 0)
+    {
+        fprintf(stderr, "%s: cannot load %s\n", argv[0], image);
+        return USAGE_ERROR;
+    }
+
+    // guest output is flushed when the buffer fills, on input and at exit
+    static char output_buffer[1 << 16];
+    setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer));
+
+    FILE* record_file = nullptr;
+    if (record_path && !(record_file = fopen(record_path, "wb")))
+    {
+        fprintf(stderr, "%s: cannot create %s\n", argv[0], record_path);
+        return USAGE_ERROR;
+    }
+    const MappedFile replay_log = replay_path ? MappedFile(replay_path) : MappedFile();
+    std::optional<InputRecorder> recorder;
+    std::optional<InputReplayer> replayer;
+    if (record_file) recorder.emplace(cpu, mem, record_file);
+    if (replay_path) replayer.emplace(cpu, mem, replay_log.data(), replay_log.size());
+    if (replayer && !replayer->valid())
+    {
+        fprintf(stderr, "%s: %s is not an input log\n", argv[0], replay_path);
+        return USAGE_ERROR;
+    }
+
+    Console console{ &mem, (word)output, (word)input };
+    Memory::IOHandler handler{ &Console::read, &Console::write, &console };
+    if (recorder) handler = recorder->wrap(handler);
+    if (replayer) handler = replayer->wrap(handler);
+    mem.map_io(console.output >> 8, console.output >> 8, handler);
+    mem.map_io(console.input >> 8, console.input >> 8, handler);
+
+    if (from_vector) start = mem.data[0xFFFC] | mem.data[0xFFFD] << 8;
+    cpu.reset(has_start || from_vector ? (word)start : loaded.start);
 
-    cpu.execute(6);
+    InstructionCount instructions;
+    ExecuteResult result{};
+    u64 cycles = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    do
+    {
+        const s32 slice = budget ? (s32)std::min<u64>(SLICE, budget - cycles) : SLICE;
+        result = recorder ? recorder->execute(slice, instructions)
+            : replayer ? replayer->execute(slice, instructions)
+            : cpu.execute(slice, instructions);
+        cycles += result.cycles;
+    } while (result.reason == StopReason::BUDGET && (!budget || cycles < budget));
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
 
-    return 0;
-}
\ No newline at end of file
+    fflush(stdout);
+    if (recorder && !recorder->flush())
+    {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], record_path);
+    }
+    if (replayer && !replayer->in_sync())
+    {
+        fprintf(stderr, "%s: run went out of sync with %s\n", argv[0], replay_path);
+    }
+    if (!quiet)
+    {
+        fprintf(stderr, "stopped: %s, opcode 0x%02X at 0x%04X\n",
+            stop_reason_name(result.reason), result.opcode, result.PC);
+        fprintf(stderr, "%llu instructions, %llu cycles in %.3f s, %.2f emulated MHz, %.2f MIPS\n",
+            instructions.count, cycles, seconds,
+            seconds > 0 ? cycles / seconds / 1e6 : 0.0,
+            seconds > 0 ? instructions.count / seconds / 1e6 : 0.0);
+    }
+    return (int)result.reason;
+}
@@ -0,0 +1,222 @@
+#ifndef _H_OPCODES
+#define _H_OPCODES
+
+#include "m6502.h"
+
+namespace emulator6502 {
+
+    // how an instruction finds its operand, as written in assembly
+    enum class AddressMode : byte
+    {
+        IMPLIED,     // TAX
+        ACCUMULATOR, // ASL A
+        IMMEDIATE,   // LDA #$nn
+        ZERO_PAGE,   // LDA $nn
+        ZERO_PAGE_X, // LDA $nn,X
+        ZERO_PAGE_Y, // LDX $nn,Y
+        ABSOLUTE,    // LDA $nnnn
+        ABSOLUTE_X,  // LDA $nnnn,X
+        ABSOLUTE_Y,  // LDA $nnnn,Y
+        INDIRECT,    // JMP ($nnnn)
+        INDIRECT_X,  // LDA ($nn,X)
+        INDIRECT_Y,  // LDA ($nn),Y
+        RELATIVE,    // BNE $nnnn, the operand is a signed offset from the next PC
+    };
+
+    /** @return opcode and operand bytes of an instruction in mode */
+    constexpr byte instruction_length(AddressMode mode)
+    {
+        switch (mode)
+        {
+        case AddressMode::IMPLIED:
+        case AddressMode::ACCUMULATOR:
+            return 1;
+        case AddressMode::ABSOLUTE:
+        case AddressMode::ABSOLUTE_X:
+        case AddressMode::ABSOLUTE_Y:
+        case AddressMode::INDIRECT:
+            return 3;
+        default:
+            return 2;
+        }
+    }
+
+    /**
+     * Documented behaviour of one opcode. Everything that depends on the
+     * length or timing of an instruction, the dispatch loops, Functional
+     * cycle accounting, block decoding, the JIT and CPUBatch, reads it from
+     * here. CycleExact counts its cycles per bus access instead and the
+     * tests check that both agree.
+    */
+    struct OpInfo
+    {
+        const char* mnemonic = nullptr; // nullptr for opcodes without a handler
+        AddressMode mode = AddressMode::IMPLIED;
+        byte length = 1;       // opcode and operand bytes
+        byte cycles = 0;       // base cost, no page crossing or taken branch
+        byte page_penalty = 0; // extra cycle when indexing crosses a page, a
+                               // branch pays it on top of the taken cycle
+        bool sets_pc = false;  // jumps, branches, calls and returns
+
+        constexpr bool implemented() const { return mnemonic != nullptr; }
+    };
+
+    constexpr OpInfo op_info(const char* mnemonic, AddressMode mode, byte cycles, byte page_penalty = 0, bool sets_pc = false)
+    {
+        return { mnemonic, mode, instruction_length(mode), cycles, page_penalty, sets_pc };
+    }
+
+    constexpr std::array<OpInfo, 256> make_opcode_info()
+    {
+        using enum AddressMode;
+        std::array<OpInfo, 256> t{};
+
+        // LDA
+        t[CPU::INS_LDA_IM]  = op_info("LDA", IMMEDIATE, 2);
+        t[CPU::INS_LDA_ZP]  = op_info("LDA", ZERO_PAGE, 3);
+        t[CPU::INS_LDA_ZPX] = op_info("LDA", ZERO_PAGE_X, 4);
+        t[CPU::INS_LDA_ABS] = op_info("LDA", ABSOLUTE, 4);
+        t[CPU::INS_LDA_AX]  = op_info("LDA", ABSOLUTE_X, 4, 1);
+        t[CPU::INS_LDA_AY]  = op_info("LDA", ABSOLUTE_Y, 4, 1);
+        t[CPU::INS_LDA_IX]  = op_info("LDA", INDIRECT_X, 6);
+        t[CPU::INS_LDA_IY]  = op_info("LDA", INDIRECT_Y, 5, 1);
+        // LDX
+        t[CPU::INS_LDX_IM]  = op_info("LDX", IMMEDIATE, 2);
+        t[CPU::INS_LDX_ZP]  = op_info("LDX", ZERO_PAGE, 3);
+        t[CPU::INS_LDX_ZPY] = op_info("LDX", ZERO_PAGE_Y, 4);
+        t[CPU::INS_LDX_ABS] = op_info("LDX", ABSOLUTE, 4);
+        t[CPU::INS_LDX_AY]  = op_info("LDX", ABSOLUTE_Y, 4, 1);
+        // LDY
+        t[CPU::INS_LDY_IM]  = op_info("LDY", IMMEDIATE, 2);
+        t[CPU::INS_LDY_ZP]  = op_info("LDY", ZERO_PAGE, 3);
+        t[CPU::INS_LDY_ZPX] = op_info("LDY", ZERO_PAGE_X, 4);
+        t[CPU::INS_LDY_ABS] = op_info("LDY", ABSOLUTE, 4);
+        t[CPU::INS_LDY_AX]  = op_info("LDY", ABSOLUTE_X, 4, 1);
+        // STA
+        t[CPU::INS_STA_ZP]  = op_info("STA", ZERO_PAGE, 3);
+        t[CPU::INS_STA_ZPX] = op_info("STA", ZERO_PAGE_X, 4);
+        t[CPU::INS_STA_ABS] = op_info("STA", ABSOLUTE, 4);
+        t[CPU::INS_STA_AX]  = op_info("STA", ABSOLUTE_X, 5);
+        t[CPU::INS_STA_AY]  = op_info("STA", ABSOLUTE_Y, 5);
+        t[CPU::INS_STA_IX]  = op_info("STA", INDIRECT_X, 6);
+        t[CPU::INS_STA_IY]  = op_info("STA", INDIRECT_Y, 6);
+        // STX
+        t[CPU::INS_STX_ZP]  = op_info("STX", ZERO_PAGE, 3);
+        t[CPU::INS_STX_ZPY] = op_info("STX", ZERO_PAGE_Y, 4);
+        t[CPU::INS_STX_ABS] = op_info("STX", ABSOLUTE, 4);
+        // STY
+        t[CPU::INS_STY_ZP]  = op_info("STY", ZERO_PAGE, 3);
+        t[CPU::INS_STY_ZPX] = op_info("STY", ZERO_PAGE_X, 4);
+        t[CPU::INS_STY_ABS] = op_info("STY", ABSOLUTE, 4);
+        // Jumps and Returns
+        t[CPU::INS_JSR]     = op_info("JSR", ABSOLUTE, 6, 0, true);
+        t[CPU::INS_RTS]     = op_info("RTS", IMPLIED, 6, 0, true);
+        t[CPU::INS_JMP_ABS] = op_info("JMP", ABSOLUTE, 3, 0, true);
+        t[CPU::INS_JMP_I]   = op_info("JMP", INDIRECT, 5, 0, true);
+        // Stack Operations
+        t[CPU::INS_TSX]     = op_info("TSX", IMPLIED, 2);
+        t[CPU::INS_TXS]     = op_info("TXS", IMPLIED, 2);
+        t[CPU::INS_PHA]     = op_info("PHA", IMPLIED, 3);
+        t[CPU::INS_PHP]     = op_info("PHP", IMPLIED, 3);
+        t[CPU::INS_PLA]     = op_info("PLA", IMPLIED, 4);
+        t[CPU::INS_PLP]     = op_info("PLP", IMPLIED, 4);
+
+        // the accumulator operations share the modes and timing of LDA
+        const byte lda[8] = {
+            CPU::INS_LDA_IM, CPU::INS_LDA_ZP, CPU::INS_LDA_ZPX, CPU::INS_LDA_ABS,
+            CPU::INS_LDA_AX, CPU::INS_LDA_AY, CPU::INS_LDA_IX, CPU::INS_LDA_IY,
+        };
+        struct Group { const char* mnemonic; byte opcodes[8]; };
+        const Group accumulator[] = {
+            { "AND", { CPU::INS_AND_IM, CPU::INS_AND_ZP, CPU::INS_AND_ZPX, CPU::INS_AND_ABS,
+                       CPU::INS_AND_AX, CPU::INS_AND_AY, CPU::INS_AND_IX, CPU::INS_AND_IY } },
+            { "EOR", { CPU::INS_EOR_IM, CPU::INS_EOR_ZP, CPU::INS_EOR_ZPX, CPU::INS_EOR_ABS,
+                       CPU::INS_EOR_AX, CPU::INS_EOR_AY, CPU::INS_EOR_IX, CPU::INS_EOR_IY } },
+            { "ORA", { CPU::INS_ORA_IM, CPU::INS_ORA_ZP, CPU::INS_ORA_ZPX, CPU::INS_ORA_ABS,
+                       CPU::INS_ORA_AX, CPU::INS_ORA_AY, CPU::INS_ORA_IX, CPU::INS_ORA_IY } },
+            { "ADC", { CPU::INS_ADC_IM, CPU::INS_ADC_ZP, CPU::INS_ADC_ZPX, CPU::INS_ADC_ABS,
+                       CPU::INS_ADC_AX, CPU::INS_ADC_AY, CPU::INS_ADC_IX, CPU::INS_ADC_IY } },
+            { "SBC", { CPU::INS_SBC_IM, CPU::INS_SBC_ZP, CPU::INS_SBC_ZPX, CPU::INS_SBC_ABS,
+                       CPU::INS_SBC_AX, CPU::INS_SBC_AY, CPU::INS_SBC_IX, CPU::INS_SBC_IY } },
+            { "CMP", { CPU::INS_CMP_IM, CPU::INS_CMP_ZP, CPU::INS_CMP_ZPX, CPU::INS_CMP_ABS,
+                       CPU::INS_CMP_AX, CPU::INS_CMP_AY, CPU::INS_CMP_IX, CPU::INS_CMP_IY } },
+        };
+        for (const Group& group : accumulator)
+        {
+            for (u32 i = 0; i < 8; i++)
+            {
+                t[group.opcodes[i]] = t[lda[i]];
+                t[group.opcodes[i]].mnemonic = group.mnemonic;
+            }
+        }
+
+        // CPX
+        t[CPU::INS_CPX_IM]  = op_info("CPX", IMMEDIATE, 2);
+        t[CPU::INS_CPX_ZP]  = op_info("CPX", ZERO_PAGE, 3);
+        t[CPU::INS_CPX_ABS] = op_info("CPX", ABSOLUTE, 4);
+        // CPY
+        t[CPU::INS_CPY_IM]  = op_info("CPY", IMMEDIATE, 2);
+        t[CPU::INS_CPY_ZP]  = op_info("CPY", ZERO_PAGE, 3);
+        t[CPU::INS_CPY_ABS] = op_info("CPY", ABSOLUTE, 4);
+        // BIT
+        t[CPU::INS_BIT_ZP]  = op_info("BIT", ZERO_PAGE, 3);
+        t[CPU::INS_BIT_ABS] = op_info("BIT", ABSOLUTE, 4);
+
+        // read-modify-write, the shifts also work on the accumulator
+        struct Modify { const char* mnemonic; byte accumulator, zp, zpx, abs, ax; };
+        const Modify modify[] = {
+            { "ASL", CPU::INS_ASL_A, CPU::INS_ASL_ZP, CPU::INS_ASL_ZPX, CPU::INS_ASL_ABS, CPU::INS_ASL_AX },
+            { "LSR", CPU::INS_LSR_A, CPU::INS_LSR_ZP, CPU::INS_LSR_ZPX, CPU::INS_LSR_ABS, CPU::INS_LSR_AX },
+            { "ROL", CPU::INS_ROL_A, CPU::INS_ROL_ZP, CPU::INS_ROL_ZPX, CPU::INS_ROL_ABS, CPU::INS_ROL_AX },
+            { "ROR", CPU::INS_ROR_A, CPU::INS_ROR_ZP, CPU::INS_ROR_ZPX, CPU::INS_ROR_ABS, CPU::INS_ROR_AX },
+            { "INC", 0, CPU::INS_INC_ZP, CPU::INS_INC_ZPX, CPU::INS_INC_ABS, CPU::INS_INC_AX },
+            { "DEC", 0, CPU::INS_DEC_ZP, CPU::INS_DEC_ZPX, CPU::INS_DEC_ABS, CPU::INS_DEC_AX },
+        };
+        for (const Modify& m : modify)
+        {
+            if (m.accumulator) t[m.accumulator] = op_info(m.mnemonic, ACCUMULATOR, 2);
+            t[m.zp]  = op_info(m.mnemonic, ZERO_PAGE, 5);
+            t[m.zpx] = op_info(m.mnemonic, ZERO_PAGE_X, 6);
+            t[m.abs] = op_info(m.mnemonic, ABSOLUTE, 6);
+            t[m.ax]  = op_info(m.mnemonic, ABSOLUTE_X, 7);
+        }
+        t[CPU::INS_INX]     = op_info("INX", IMPLIED, 2);
+        t[CPU::INS_INY]     = op_info("INY", IMPLIED, 2);
+        t[CPU::INS_DEX]     = op_info("DEX", IMPLIED, 2);
+        t[CPU::INS_DEY]     = op_info("DEY", IMPLIED, 2);
+
+        // Branches, one more cycle when taken
+        t[CPU::INS_BCC]     = op_info("BCC", RELATIVE, 2, 1, true);
+        t[CPU::INS_BCS]     = op_info("BCS", RELATIVE, 2, 1, true);
+        t[CPU::INS_BNE]     = op_info("BNE", RELATIVE, 2, 1, true);
+        t[CPU::INS_BEQ]     = op_info("BEQ", RELATIVE, 2, 1, true);
+        t[CPU::INS_BPL]     = op_info("BPL", RELATIVE, 2, 1, true);
+        t[CPU::INS_BMI]     = op_info("BMI", RELATIVE, 2, 1, true);
+        t[CPU::INS_BVC]     = op_info("BVC", RELATIVE, 2, 1, true);
+        t[CPU::INS_BVS]     = op_info("BVS", RELATIVE, 2, 1, true);
+        // Status Flag Changes
+        t[CPU::INS_CLC]     = op_info("CLC", IMPLIED, 2);
+        t[CPU::INS_CLD]     = op_info("CLD", IMPLIED, 2);
+        t[CPU::INS_CLI]     = op_info("CLI", IMPLIED, 2);
+        t[CPU::INS_CLV]     = op_info("CLV", IMPLIED, 2);
+        t[CPU::INS_SEC]     = op_info("SEC", IMPLIED, 2);
+        t[CPU::INS_SED]     = op_info("SED", IMPLIED, 2);
+        t[CPU::INS_SEI]     = op_info("SEI", IMPLIED, 2);
+        // Register Transfers
+        t[CPU::INS_TAX]     = op_info("TAX", IMPLIED, 2);
+        t[CPU::INS_TAY]     = op_info("TAY", IMPLIED, 2);
+        t[CPU::INS_TXA]     = op_info("TXA", IMPLIED, 2);
+        t[CPU::INS_TYA]     = op_info("TYA", IMPLIED, 2);
+        // System Functions, BRK skips the signature byte after it
+        t[CPU::INS_BRK]     = op_info("BRK", IMMEDIATE, 7, 0, true);
+        t[CPU::INS_RTI]     = op_info("RTI", IMPLIED, 6, 0, true);
+        t[CPU::INS_NOP]     = op_info("NOP", IMPLIED, 2);
+
+        return t;
+    }
+
+    // indexed by opcode
+    inline constexpr std::array<OpInfo, 256> opcode_info = make_opcode_info();
+}
+
+#endif
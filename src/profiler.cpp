@@ -0,0 +1,117 @@
+#include "profiler.h"
+
+#include <map>
+#include <string>
+
+using namespace emulator6502;
+
+Profiler::Profiler()
+    : hits(new Hits[Memory::MAX_MEMORY + 1])
+{
+    clear();
+}
+
+void Profiler::clear()
+{
+    std::fill(hits.get(), hits.get() + Memory::MAX_MEMORY + 1, Hits{ 0, 0 });
+    nodes.clear();
+    current = 0;
+    current_cycles = 0;
+    last_pc = NO_PC;
+}
+
+// child of the current node for the subroutine, created on its first call
+void Profiler::enter(word address)
+{
+    nodes[current].cycles += current_cycles;
+    current_cycles = 0;
+    u32 child = nodes[current].first_child;
+    while (child != NONE && nodes[child].address != address)
+    {
+        child = nodes[child].next_sibling;
+    }
+    if (child == NONE)
+    {
+        child = (u32)nodes.size();
+        nodes.push_back({ address, current });
+        nodes[child].next_sibling = nodes[current].first_child;
+        nodes[current].first_child = child;
+    }
+    nodes[child].calls++;
+    current = child;
+}
+
+void Profiler::leave()
+{
+    nodes[current].cycles += current_cycles;
+    current_cycles = 0;
+    current = nodes[current].parent;
+}
+
+// children are always added after their parent, so one pass from the back
+// sums every subtree
+std::vector<u64> Profiler::inclusive_cycles() const
+{
+    std::vector<u64> inclusive(nodes.size());
+    for (u32 i = (u32)nodes.size(); i-- > 0;)
+    {
+        inclusive[i] += nodes[i].cycles;
+        if (i != 0) inclusive[nodes[i].parent] += inclusive[i];
+    }
+    return inclusive;
+}
+
+std::vector<Profiler::Subroutine> Profiler::subroutines() const
+{
+    const std::vector<u64> inclusive = inclusive_cycles();
+    std::map<word, Subroutine> by_address;
+    for (u32 i = 1; i < nodes.size(); i++)
+    {
+        const Node& node = nodes[i];
+        Subroutine& subroutine = by_address.try_emplace(node.address, Subroutine{ node.address, 0, 0, 0 }).first->second;
+        subroutine.calls += node.calls;
+        subroutine.exclusive_cycles += node.cycles;
+
+        // a recursive call is already inside an outer one
+        bool outermost = true;
+        for (u32 up = node.parent; up != 0 && outermost; up = nodes[up].parent)
+        {
+            outermost = nodes[up].address != node.address;
+        }
+        if (outermost) subroutine.inclusive_cycles += inclusive[i];
+    }
+
+    std::vector<Subroutine> result;
+    for (const auto& [address, subroutine] : by_address)
+    {
+        result.push_back(subroutine);
+    }
+    return result;
+}
+
+void Profiler::write_collapsed(FILE* out) const
+{
+    std::vector<std::string> paths(nodes.size());
+    for (u32 i = 0; i < nodes.size(); i++)
+    {
+        char frame[8];
+        snprintf(frame, sizeof(frame), "0x%04X", nodes[i].address);
+        paths[i] = i == 0 ? frame : paths[nodes[i].parent] + ";" + frame;
+        if (nodes[i].cycles)
+        {
+            fprintf(out, "%s %llu\n", paths[i].c_str(), (unsigned long long)nodes[i].cycles);
+        }
+    }
+}
+
+void Profiler::write_hits(FILE* out) const
+{
+    for (u32 address = 0; address < Memory::MAX_MEMORY; address++)
+    {
+        if (hits[address].instructions)
+        {
+            fprintf(out, "0x%04X %llu %llu\n", address,
+                (unsigned long long)hits[address].instructions, (unsigned long long)hits[address].cycles);
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef _H_PROFILER
+#define _H_PROFILER
+
+#include "m6502.h"
+
+#include <memory>
+#include <vector>
+
+namespace emulator6502 {
+
+    /**
+     * Instruction and cycle counts per PC, and a call tree of guest
+     * subroutines, filled by CPU::execute(s32, Profiler&). The counters are
+     * flat arrays indexed by PC, allocated once by the constructor.
+     *
+     * The call tree follows a shadow call stack: JSR enters a subroutine at
+     * its target, RTS leaves it, and every instruction's cycles are charged
+     * to the PC and to the subroutine on top of the stack. The bottom of the
+     * stack is named after the PC profiling started at; an RTS with nothing
+     * to leave stays there.
+    */
+    class Profiler
+    {
+    public:
+        // same per instruction hook as the trace policies (see trace.h)
+        static constexpr bool enabled = true;
+
+        Profiler();
+
+        // drop every count and the call tree
+        void clear();
+
+        u64 instructions_at(word address) const { return hits[address].instructions; }
+        u64 cycles_at(word address) const { return hits[address].cycles; }
+
+        struct Subroutine
+        {
+            word address;
+            u64 calls;
+            u64 inclusive_cycles; // including the subroutines it calls, once for recursion
+            u64 exclusive_cycles;
+        };
+        /** @return every subroutine entered, by address */
+        std::vector<Subroutine> subroutines() const;
+
+        // one line per call path, frames as 0xADDR separated by ';' and
+        // followed by the exclusive cycles of the path, as read by
+        // flamegraph.pl and similar tools
+        void write_collapsed(FILE*) const;
+        // one line per address executed: address, instructions, cycles
+        void write_hits(FILE*) const;
+
+    private:
+        friend struct CPU;
+
+        struct Hits
+        {
+            u64 instructions;
+            u64 cycles;
+        };
+        // one past the last address takes the empty charge before the
+        // first instruction, and is never reported
+        static constexpr u32 NO_PC = Memory::MAX_MEMORY;
+        std::unique_ptr<Hits[]> hits;
+
+        struct Node
+        {
+            word address;
+            u32 parent;
+            u32 first_child = NONE;
+            u32 next_sibling = NONE;
+            u64 calls = 0;
+            u64 cycles = 0; // exclusive
+        };
+        static constexpr u32 NONE = ~0u;
+        std::vector<Node> nodes;
+        u32 current = 0;
+        // cycles of the current node not yet added to it
+        u64 current_cycles = 0;
+
+        // the instruction started last, charged once the next one starts
+        u32 last_pc = NO_PC;
+        byte last_opcode = CPU::INS_NOP;
+        s32 last_cycles = 0;
+
+        void start(word pc, s32 cycles_left)
+        {
+            if (nodes.empty()) nodes.push_back({ pc, 0 });
+            last_pc = NO_PC;
+            last_opcode = CPU::INS_NOP;
+            last_cycles = cycles_left;
+        }
+
+        M6502_ALWAYS_INLINE void instruction(word pc, byte opcode, s32 cycles_left)
+        {
+            retire(pc, cycles_left);
+            last_pc = pc;
+            last_opcode = opcode;
+            last_cycles = cycles_left;
+        }
+
+        // charges the last instruction, next_pc is where it went
+        M6502_ALWAYS_INLINE void retire(word next_pc, s32 cycles_left)
+        {
+            const u32 used = last_cycles - cycles_left;
+            hits[last_pc].instructions++;
+            hits[last_pc].cycles += used;
+            current_cycles += used;
+            // BRK, JSR, RTI and RTS in one test
+            if ((last_opcode & 0x9F) == 0) [[unlikely]]
+            {
+                if (last_opcode == CPU::INS_JSR) enter(next_pc);
+                if (last_opcode == CPU::INS_RTS) leave();
+            }
+        }
+
+        // charges the last instruction at the end of an execute
+        void finish(word next_pc, s32 cycles_left)
+        {
+            retire(next_pc, cycles_left);
+            nodes[current].cycles += current_cycles;
+            current_cycles = 0;
+            last_pc = NO_PC;
+        }
+
+        void enter(word address);
+        void leave();
+        std::vector<u64> inclusive_cycles() const;
+    };
+}
+
+#endif
@@ -11,5 +11,6 @@
 #include <algorithm>
 #include <iostream>
 #include <format>
+#include <memory>
 
 #endif
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "replay.h"
+
+#include <cstring>
+
+using namespace emulator6502;
+
+namespace
+{
+    // bytes kept in memory before they are written out
+    constexpr size_t FLUSH_SIZE = 1 << 16;
+
+    void put_varint(std::vector<byte>& out, u64 value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back((byte)value | 0x80);
+            value >>= 7;
+        }
+        out.push_back((byte)value);
+    }
+
+    /** @return false when the log ends inside the varint */
+    bool get_varint(const byte*& cursor, const byte* end, u64& value)
+    {
+        value = 0;
+        for (u32 shift = 0; cursor < end && shift < 64; shift += 7)
+        {
+            const byte b = *cursor++;
+            value |= (u64)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+}
+
+//~~~~~~~~~~~~~~~~~InputRecorder~~~~~~~~~~~~~~~~~
+
+InputRecorder::InputRecorder(CPU& cpu, Memory& mem, FILE* out)
+    : cpu(cpu), mem(mem), out(out),
+      bytes(std::begin(input_log::MAGIC), std::end(input_log::MAGIC))
+{}
+
+Memory::IOHandler InputRecorder::wrap(const Memory::IOHandler& device)
+{
+    devices.push_back(std::make_unique<Device>(Device{ this, device }));
+    return { &InputRecorder::read, &InputRecorder::write, devices.back().get() };
+}
+
+void InputRecorder::event(input_log::Kind kind)
+{
+    const u64 stamp = now();
+    put_varint(bytes, (stamp - last_stamp) << 1 | kind);
+    last_stamp = stamp;
+}
+
+byte InputRecorder::read(void* context, word address)
+{
+    Device& device = *static_cast<Device*>(context);
+    const byte value = device.handler.read ? device.handler.read(device.handler.context, address) : 0;
+
+    InputRecorder& recorder = *device.recorder;
+    recorder.event(input_log::IO_READ);
+    recorder.bytes.push_back(value);
+    if (recorder.out && recorder.bytes.size() >= FLUSH_SIZE) recorder.flush();
+    return value;
+}
+
+void InputRecorder::write(void* context, word address, byte value)
+{
+    const Device& device = *static_cast<Device*>(context);
+    if (device.handler.write) device.handler.write(device.handler.context, address, value);
+}
+
+void InputRecorder::inject(word address, byte value)
+{
+    assert(budget == 0);
+    mem[address] = value;
+    event(input_log::WRITE);
+    bytes.push_back(address & 0xFF);
+    bytes.push_back(address >> 8);
+    bytes.push_back(value);
+    if (out && bytes.size() >= FLUSH_SIZE) flush();
+}
+
+bool InputRecorder::flush()
+{
+    if (!out) return !failed;
+    if (!bytes.empty() && fwrite(bytes.data(), 1, bytes.size(), out) != bytes.size())
+    {
+        failed = true;
+    }
+    bytes.clear();
+    if (fflush(out) != 0) failed = true;
+    return !failed;
+}
+
+//~~~~~~~~~~~~~~~~~InputReplayer~~~~~~~~~~~~~~~~~
+
+InputReplayer::InputReplayer(CPU& cpu, Memory& mem, const byte* log, u32 size)
+    : cpu(cpu), mem(mem), end(log + size), reads{ log }, writes{ log }
+{
+    header_ok = size >= sizeof(input_log::MAGIC)
+        && memcmp(log, input_log::MAGIC, sizeof(input_log::MAGIC)) == 0;
+    if (!header_ok) return;
+    reads.at = writes.at = log + sizeof(input_log::MAGIC);
+    decode_next(reads, input_log::IO_READ);
+    decode_next(writes, input_log::WRITE);
+}
+
+Memory::IOHandler InputReplayer::wrap(const Memory::IOHandler& device)
+{
+    devices.push_back(std::make_unique<Device>(Device{ this, device }));
+    return { &InputReplayer::read, &InputReplayer::write, devices.back().get() };
+}
+
+// moves cursor to the next event of kind, a log cut short, by a crash
+// while recording, ends at its last whole event
+void InputReplayer::decode_next(Cursor& cursor, input_log::Kind kind)
+{
+    Event& next = cursor.next;
+    cursor.has_event = false;
+    u64 head;
+    while (get_varint(cursor.at, end, head))
+    {
+        next.stamp += head >> 1;
+        next.kind = (input_log::Kind)(head & 1);
+        const u32 size = next.kind == input_log::WRITE ? 3 : 1;
+        if ((u32)(end - cursor.at) < size) return;
+
+        const byte* operands = cursor.at;
+        cursor.at += size;
+        if (next.kind != kind) continue;
+
+        if (kind == input_log::WRITE)
+        {
+            next.address = operands[0] | (operands[1] << 8);
+            next.value = operands[2];
+        }
+        else
+        {
+            next.value = operands[0];
+        }
+        cursor.has_event = true;
+        return;
+    }
+}
+
+// injected writes due by now, a write that is overdue means the run took
+// a different path than the recording
+void InputReplayer::apply_writes()
+{
+    while (writes.has_event && writes.next.stamp <= elapsed)
+    {
+        if (writes.next.stamp != elapsed) sync = false;
+        mem[writes.next.address] = writes.next.value;
+        decode_next(writes, input_log::WRITE);
+    }
+}
+
+byte InputReplayer::read(void* context, word)
+{
+    InputReplayer& replayer = *static_cast<Device*>(context)->replayer;
+    Cursor& reads = replayer.reads;
+    if (!reads.has_event)
+    {
+        replayer.sync = false;
+        return 0;
+    }
+    if (reads.next.stamp != replayer.now()) replayer.sync = false;
+
+    const byte value = reads.next.value;
+    replayer.decode_next(reads, input_log::IO_READ);
+    return value;
+}
+
+void InputReplayer::write(void* context, word address, byte value)
+{
+    const Device& device = *static_cast<Device*>(context);
+    if (device.handler.write) device.handler.write(device.handler.context, address, value);
+}
@@ -0,0 +1,206 @@
+#ifndef _H_REPLAY
+#define _H_REPLAY
+
+#include "m6502.h"
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace emulator6502 {
+
+    /**
+     * Log of the inputs that make a run non-deterministic: values returned
+     * by I/O reads and writes injected into memory by the host. Everything
+     * else follows from the image and the registers at the start, so the
+     * log grows with the input, not with the instructions run.
+     *
+     * The log is a header followed by one event after another, each
+     * starting with a varint of the cycles since the previous event shifted
+     * left once, with the kind in bit 0:
+     *   IO_READ  value
+     *   WRITE    address (little endian), value
+    */
+    namespace input_log {
+        constexpr byte MAGIC[8] = { '6', '5', '0', '2', 'I', 'N', 'P', 1 };
+        enum Kind : byte { IO_READ = 0, WRITE = 1 };
+
+        // CPU::execute on the interpreter loops, which stamp every read at
+        // its own cycle; the block engines behind execute(s32) and
+        // execute(s32, BlockCache&) only count cycles per block
+        template<typename... Policy>
+        ExecuteResult execute(CPU& cpu, s32 cycle_count, Policy&... policy)
+        {
+            static_assert((!std::is_same_v<std::remove_cv_t<Policy>, BlockCache> && ...),
+                "input logs are stamped by the interpreter, not the block cache");
+            if constexpr (sizeof...(Policy) == 0) return cpu.execute<CycleExact>(cycle_count);
+            else return cpu.execute(cycle_count, policy...);
+        }
+    }
+
+    /**
+     * Records a run into an input log. I/O devices whose reads should be
+     * logged are mapped through wrap, the run is driven through execute and
+     * the host's own writes to memory go through inject.
+     *
+     * Events are stamped with the cycles run since the recorder was
+     * created. Whatever the build's engine, execute runs the interpreter
+     * so every read is stamped at its own cycle.
+    */
+    class InputRecorder
+    {
+    public:
+        // a null out keeps the whole log in memory, see log()
+        InputRecorder(CPU&, Memory&, FILE* out = nullptr);
+        ~InputRecorder() { flush(); }
+        InputRecorder(const InputRecorder&) = delete;
+        InputRecorder& operator=(const InputRecorder&) = delete;
+
+        /** @return a handler for Memory::map_io that logs what device's reads return */
+        Memory::IOHandler wrap(const Memory::IOHandler& device);
+
+        // CPU::execute, with any of its policies but a BlockCache
+        template<typename... Policy>
+        ExecuteResult execute(s32 cycle_count, Policy&... policy)
+        {
+            budget = cycle_count;
+            const ExecuteResult result = input_log::execute(cpu, cycle_count, policy...);
+            budget = 0;
+            elapsed += result.cycles;
+            return result;
+        }
+
+        // writes value to address as Memory::operator[] would, between executes
+        void inject(word address, byte value);
+
+        /** @return cycles run through execute */
+        u64 cycles() const { return elapsed; }
+        /** @return log bytes not yet written to out, or the whole log without one */
+        const std::vector<byte>& log() const { return bytes; }
+        /** @return false once a write to out has come up short */
+        bool flush();
+
+    private:
+        struct Device
+        {
+            InputRecorder* recorder;
+            Memory::IOHandler handler;
+        };
+
+        CPU& cpu;
+        Memory& mem;
+        FILE* out;
+        std::vector<byte> bytes;
+        std::vector<std::unique_ptr<Device>> devices;
+        u64 elapsed = 0;
+        u64 last_stamp = 0;
+        s32 budget = 0; // of the running execute, 0 outside of one
+        bool failed = false;
+
+        u64 now() const { return elapsed + (budget ? budget - cpu.cycles_left() : 0); }
+        void event(input_log::Kind);
+
+        static byte read(void* context, word address);
+        static void write(void* context, word address, byte value);
+    };
+
+    /**
+     * Feeds a recorded input log back into a run started from the same
+     * image and registers. Devices mapped through wrap return the logged
+     * values instead of reading, their writes still reach the device, and
+     * execute applies the injected writes at the cycles they were recorded
+     * at, running at full speed in between.
+     *
+     * Like the recorder, execute runs the interpreter, so the stamps line
+     * up however the two runs are sliced. A stamp that does not match, or
+     * a read where the log has none, marks the replay as out of sync;
+     * reads past the end of the log return 0.
+    */
+    class InputReplayer
+    {
+    public:
+        // log has to stay valid, a log without the header replays nothing
+        InputReplayer(CPU&, Memory&, const byte* log, u32 size);
+        InputReplayer(const InputReplayer&) = delete;
+        InputReplayer& operator=(const InputReplayer&) = delete;
+
+        /** @return a handler for Memory::map_io that replays the reads of device */
+        Memory::IOHandler wrap(const Memory::IOHandler& device);
+
+        // CPU::execute, with any of its policies but a BlockCache, stopping
+        // at injected writes to apply them
+        template<typename... Policy>
+        ExecuteResult execute(s32 cycle_count, Policy&... policy)
+        {
+            ExecuteResult total = { 0, StopReason::BUDGET, 0, 0 };
+            do
+            {
+                apply_writes();
+                s32 slice = cycle_count - total.cycles;
+                if (writes.has_event && writes.next.stamp - elapsed < (u64)slice)
+                {
+                    slice = (s32)(writes.next.stamp - elapsed);
+                }
+
+                budget = slice;
+                const ExecuteResult result = input_log::execute(cpu, slice, policy...);
+                budget = 0;
+                elapsed += result.cycles;
+                total = { total.cycles + result.cycles, result.reason, result.PC, result.opcode };
+            } while (total.reason == StopReason::BUDGET && total.cycles < cycle_count);
+            apply_writes();
+            return total;
+        }
+
+        bool valid() const { return header_ok; }
+        /** @return true once every event of the log has been replayed */
+        bool finished() const { return !reads.has_event && !writes.has_event; }
+        bool in_sync() const { return sync; }
+        /** @return cycles run through execute */
+        u64 cycles() const { return elapsed; }
+
+    private:
+        struct Event
+        {
+            u64 stamp;
+            input_log::Kind kind;
+            word address;
+            byte value;
+        };
+
+        // reads and writes are walked separately, so the next write is
+        // known however many reads come before it
+        struct Cursor
+        {
+            const byte* at;
+            Event next{};
+            bool has_event = false;
+        };
+
+        struct Device
+        {
+            InputReplayer* replayer;
+            Memory::IOHandler handler;
+        };
+
+        CPU& cpu;
+        Memory& mem;
+        const byte* end;
+        Cursor reads;
+        Cursor writes;
+        std::vector<std::unique_ptr<Device>> devices;
+        bool header_ok = false;
+        bool sync = true;
+        u64 elapsed = 0;
+        s32 budget = 0;
+
+        u64 now() const { return elapsed + (budget ? budget - cpu.cycles_left() : 0); }
+        void decode_next(Cursor&, input_log::Kind);
+        void apply_writes();
+
+        static byte read(void* context, word address);
+        static void write(void* context, word address, byte value);
+    };
+}
+
+#endif
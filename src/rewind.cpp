@@ -0,0 +1,191 @@
+#include "rewind.h"
+
+#include <climits>
+#include <cstring>
+
+using namespace emulator6502;
+
+namespace
+{
+    bool page_changed(const byte* a, const byte* b)
+    {
+        return std::memcmp(a, b, Memory::PAGE_SIZE) != 0;
+    }
+}
+
+// the ring holds at least one checkpoint of a single page
+RewindBuffer::RewindBuffer(CPU& cpu, Memory& mem, const RewindConfig& config)
+    : cpu(cpu), mem(mem),
+      interval(std::max(config.interval, 1u)),
+      capacity(std::max<u32>(config.memory_budget, sizeof(Header) + 1 + Memory::PAGE_SIZE)),
+      ring(new byte[capacity]),
+      shadow(new byte[Memory::MAX_MEMORY])
+{
+    std::memcpy(shadow.get(), mem.data, Memory::MAX_MEMORY);
+    checkpoint();
+}
+
+RewindBuffer::Header RewindBuffer::header(u32 offset) const
+{
+    Header h;
+    std::memcpy(&h, ring.get() + offset, sizeof(h));
+    return h;
+}
+
+void RewindBuffer::set_header(u32 offset, const Header& h)
+{
+    std::memcpy(ring.get() + offset, &h, sizeof(h));
+}
+
+u32 RewindBuffer::record_size(u32 offset) const
+{
+    return sizeof(Header) + header(offset).pages * (1 + Memory::PAGE_SIZE);
+}
+
+u32 RewindBuffer::bytes_used() const
+{
+    u32 used = 0;
+    for (u32 i = 0, offset = oldest; i < count; i++, offset = header(offset).next)
+    {
+        used += record_size(offset);
+    }
+    return used;
+}
+
+// drops the oldest checkpoints in the way of size bytes at head, starting
+// over at the front of the ring when they do not fit before its end
+u32 RewindBuffer::allocate(u32 size)
+{
+    if (count == 0) return 0;
+    const bool wrap = head + size > capacity;
+    const u32 offset = wrap ? 0 : head;
+    while (count)
+    {
+        const u32 start = oldest;
+        const u32 end = start + record_size(start);
+        // once wrapped, checkpoints above head would sit between the
+        // newest and the one before it
+        const bool stranded = wrap && start >= head;
+        if (!stranded && (end <= offset || start >= offset + size)) break;
+        oldest = header(oldest).next;
+        count--;
+    }
+    return count ? offset : 0;
+}
+
+void RewindBuffer::checkpoint()
+{
+    byte changed[Memory::PAGE_COUNT];
+    u32 pages = 0;
+    for (u32 page = 0; page < Memory::PAGE_COUNT; page++)
+    {
+        const u32 address = page * Memory::PAGE_SIZE;
+        if (page_changed(mem.data + address, shadow.get() + address)) changed[pages++] = page;
+    }
+
+    // the oldest checkpoint's pages are never applied, one that does not
+    // fit starts the ring over without them
+    u32 size = sizeof(Header) + pages * (1 + Memory::PAGE_SIZE);
+    if (size > capacity)
+    {
+        count = 0;
+        size = sizeof(Header);
+    }
+    const u32 offset = allocate(size);
+    const bool first = count == 0;
+
+    Header h = {};
+    h.stamp = elapsed;
+    h.prev = newest;
+    h.pages = first ? 0 : pages;
+    h.PC = cpu.PC;
+    h.SP = cpu.SP;
+    h.A = cpu.A;
+    h.X = cpu.X;
+    h.Y = cpu.Y;
+    h.PS = cpu.PS;
+    set_header(offset, h);
+
+    byte* indices = ring.get() + offset + sizeof(Header);
+    byte* contents = indices + h.pages;
+    for (u32 i = 0; i < pages; i++)
+    {
+        const u32 address = changed[i] * Memory::PAGE_SIZE;
+        if (i < h.pages)
+        {
+            indices[i] = changed[i];
+            std::memcpy(contents + i * Memory::PAGE_SIZE, shadow.get() + address, Memory::PAGE_SIZE);
+        }
+        std::memcpy(shadow.get() + address, mem.data + address, Memory::PAGE_SIZE);
+    }
+
+    if (first)
+    {
+        oldest = offset;
+    }
+    else
+    {
+        Header prev = header(newest);
+        prev.next = offset;
+        set_header(newest, prev);
+    }
+    newest = offset;
+    head = offset + h.pages * (1 + Memory::PAGE_SIZE) + sizeof(Header);
+    count++;
+    next_checkpoint = elapsed + interval;
+}
+
+// as the host would write it, so decoded code on the page is dropped
+void RewindBuffer::restore_page(byte page, const byte* contents)
+{
+    const u32 address = page * Memory::PAGE_SIZE;
+    if (page_changed(mem.data + address, contents)) mem.load(address, contents, Memory::PAGE_SIZE);
+    std::memcpy(shadow.get() + address, contents, Memory::PAGE_SIZE);
+}
+
+bool RewindBuffer::rewind(u64 cycle)
+{
+    if (cycle > elapsed || cycle < oldest_cycle()) return false;
+
+    // back to the newest checkpoint first
+    for (u32 page = 0; page < Memory::PAGE_COUNT; page++)
+    {
+        const u32 address = page * Memory::PAGE_SIZE;
+        if (page_changed(mem.data + address, shadow.get() + address))
+        {
+            mem.load(address, shadow.get() + address, Memory::PAGE_SIZE);
+        }
+    }
+
+    // then undo the checkpoints after the one to start from
+    Header h = header(newest);
+    while (h.stamp > cycle)
+    {
+        const byte* indices = ring.get() + newest + sizeof(Header);
+        const byte* contents = indices + h.pages;
+        for (u32 i = 0; i < h.pages; i++)
+        {
+            restore_page(indices[i], contents + i * Memory::PAGE_SIZE);
+        }
+        newest = h.prev;
+        count--;
+        h = header(newest);
+    }
+    head = newest + record_size(newest);
+
+    cpu.PC = h.PC;
+    cpu.SP = h.SP;
+    cpu.A = h.A;
+    cpu.X = h.X;
+    cpu.Y = h.Y;
+    cpu.PS = h.PS;
+    elapsed = h.stamp;
+    next_checkpoint = elapsed + interval;
+
+    while (elapsed < cycle)
+    {
+        const s32 slice = (s32)std::min<u64>(cycle - elapsed, INT32_MAX);
+        if (execute(slice).reason != StopReason::BUDGET) break;
+    }
+    return true;
+}
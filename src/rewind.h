@@ -0,0 +1,115 @@
+#ifndef _H_REWIND
+#define _H_REWIND
+
+#include "m6502.h"
+
+#include <memory>
+
+namespace emulator6502 {
+
+    struct RewindConfig
+    {
+        u32 interval = 1 << 17;         // cycles between checkpoints
+        u32 memory_budget = 1 << 22;    // bytes of the checkpoint ring
+    };
+
+    /**
+     * Lets a run step backwards. Execution goes through execute, which takes
+     * a checkpoint at the first instruction boundary every interval cycles;
+     * rewind restores the nearest checkpoint at or before a cycle and runs
+     * forward from it.
+     *
+     * A checkpoint holds the registers and the previous contents of the
+     * pages of Memory::data that changed since the checkpoint before it,
+     * found by comparing against a copy of data as of the newest
+     * checkpoint. Going back applies these in reverse from the newest
+     * checkpoint on. Checkpoints are stored one after another in a ring of
+     * memory_budget bytes allocated once by the constructor, the oldest
+     * are dropped to make room; the copy of data comes on top of that.
+     *
+     * Only Memory::data and the registers go back, the page mapping and
+     * the state of I/O devices do not. Running forward repeats the reads
+     * of I/O devices, for runs with input replay them from an input log
+     * (see replay.h).
+    */
+    class RewindBuffer
+    {
+    public:
+        // takes the first checkpoint, at cycle 0
+        RewindBuffer(CPU&, Memory&, const RewindConfig& = {});
+        RewindBuffer(const RewindBuffer&) = delete;
+        RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+        // CPU::execute, with any of its policies, stopping for checkpoints
+        template<typename... Policy>
+        ExecuteResult execute(s32 cycle_count, Policy&... policy)
+        {
+            ExecuteResult total = { 0, StopReason::BUDGET, 0, 0 };
+            do
+            {
+                s32 slice = cycle_count - total.cycles;
+                if (next_checkpoint - elapsed < (u64)slice)
+                {
+                    slice = (s32)(next_checkpoint - elapsed);
+                }
+
+                const ExecuteResult result = cpu.execute(slice, policy...);
+                elapsed += result.cycles;
+                total = { total.cycles + result.cycles, result.reason, result.PC, result.opcode };
+                if (elapsed >= next_checkpoint) checkpoint();
+            } while (total.reason == StopReason::BUDGET && total.cycles < cycle_count);
+            return total;
+        }
+
+        /**
+         * Puts the run back to the first instruction boundary at or after
+         * cycle, checkpoints past it are dropped.
+         * @return false, leaving the run as it is, for a cycle not run yet or
+         * older than the oldest checkpoint held
+        */
+        bool rewind(u64 cycle);
+        // takes a checkpoint now, after the host changed memory or registers
+        void checkpoint();
+
+        /** @return cycles run through execute, less those rewound */
+        u64 cycles() const { return elapsed; }
+        u32 checkpoints() const { return count; }
+        /** @return cycle of the oldest checkpoint held, as far back as rewind goes */
+        u64 oldest_cycle() const { return header(oldest).stamp; }
+        /** @return bytes of the ring in use */
+        u32 bytes_used() const;
+
+    private:
+        // stored in front of each checkpoint's page indices and pages
+        struct Header
+        {
+            u64 stamp;
+            u32 prev;
+            u32 next;
+            word pages;
+            word PC;
+            byte SP, A, X, Y, PS;
+        };
+
+        CPU& cpu;
+        Memory& mem;
+        const u32 interval;
+        const u32 capacity;
+        std::unique_ptr<byte[]> ring;
+        std::unique_ptr<byte[]> shadow; // Memory::data as of the newest checkpoint
+        u32 oldest = 0;
+        u32 newest = 0;
+        u32 head = 0; // end of the newest checkpoint
+        u32 count = 0;
+        u64 elapsed = 0;
+        u64 next_checkpoint = 0;
+
+        Header header(u32 offset) const;
+        void set_header(u32 offset, const Header&);
+        u32 record_size(u32 offset) const;
+        u32 allocate(u32 size);
+        void restore_page(byte page, const byte* contents);
+    };
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include "save_state.h"
+
+#include <cstring>
+
+using namespace emulator6502;
+
+namespace emulator6502
+{
+    // private members needed for a complete snapshot
+    struct StateAccess
+    {
+        static s32 cycles(const CPU& cpu) { return cpu.cycles; }
+        static void set_cycles(CPU& cpu, s32 cycles) { cpu.cycles = cycles; }
+
+        // every page may have changed, drops decoded code as well
+        static void data_replaced(Memory& mem)
+        {
+            std::fill(std::begin(mem.dirty_pages), std::end(mem.dirty_pages), ~0ull);
+            mem.release_code(true);
+        }
+
+        // pages the next diff holds
+        static void diff_pages(const Memory& mem, u64* pages)
+        {
+            for (u32 i = 0; i < Memory::PAGE_COUNT / 64; i++)
+            {
+                pages[i] = mem.dirty_pages[i] | mem.unsent_pages[i];
+            }
+        }
+
+        static void diff_sent(Memory& mem)
+        {
+            for (u32 i = 0; i < Memory::PAGE_COUNT / 64; i++)
+            {
+                mem.sent_pages[i] |= mem.dirty_pages[i];
+                mem.dirty_pages[i] = Memory::TRACK_DIRTY_PAGES ? 0 : ~0ull;
+                mem.unsent_pages[i] = 0;
+            }
+        }
+    };
+}
+
+namespace
+{
+    constexpr byte MAGIC[4] = { '6', '5', '0', '2' };
+    constexpr u32 BITMAP_SIZE = Memory::PAGE_COUNT / 8;
+
+    bool page_is_zero(const byte* page)
+    {
+        u64 bits = 0;
+        for (u32 i = 0; i < Memory::PAGE_SIZE; i += sizeof(u64))
+        {
+            u64 chunk;
+            std::memcpy(&chunk, page + i, sizeof(chunk));
+            bits |= chunk;
+        }
+        return bits == 0;
+    }
+
+    // status flags in 6502 bit order, independent of the StatusFlags layout
+    byte pack_flags(const StatusFlags& flag)
+    {
+        return flag.C | (flag.Z << 1) | (flag.I << 2) | (flag.D << 3)
+            | (flag.B << 4) | (flag._ << 5) | (flag.V << 6) | (flag.N << 7);
+    }
+
+    void unpack_flags(StatusFlags& flag, byte value)
+    {
+        flag.C = value;
+        flag.Z = value >> 1;
+        flag.I = value >> 2;
+        flag.D = value >> 3;
+        flag.B = value >> 4;
+        flag._ = value >> 5;
+        flag.V = value >> 6;
+        flag.N = value >> 7;
+    }
+}
+
+u32 emulator6502::save_state(const CPU& cpu, const Memory& mem, byte* buffer, u32 capacity,
+    StateEncoding encoding)
+{
+    const bool sparse = encoding == StateEncoding::SPARSE;
+
+    byte bitmap[BITMAP_SIZE] = {};
+    u32 pages = Memory::PAGE_COUNT;
+    if (sparse)
+    {
+        pages = 0;
+        for (u32 page = 0; page < Memory::PAGE_COUNT; page++)
+        {
+            if (!page_is_zero(mem.data + page * Memory::PAGE_SIZE))
+            {
+                bitmap[page / 8] |= 1 << (page % 8);
+                pages++;
+            }
+        }
+    }
+
+    const u32 size = STATE_HEADER_SIZE + (sparse ? BITMAP_SIZE : 0) + pages * Memory::PAGE_SIZE;
+    if (size > capacity) return 0;
+
+    byte* out = buffer;
+    std::memcpy(out, MAGIC, sizeof(MAGIC));
+    out += sizeof(MAGIC);
+    *out++ = STATE_VERSION;
+    *out++ = (byte)encoding;
+
+    *out++ = cpu.PC & 0xFF;
+    *out++ = cpu.PC >> 8;
+    *out++ = cpu.SP;
+    *out++ = cpu.A;
+    *out++ = cpu.X;
+    *out++ = cpu.Y;
+    *out++ = pack_flags(cpu.flag);
+
+    const u32 cycles = StateAccess::cycles(cpu);
+    for (u32 i = 0; i < 4; i++)
+    {
+        *out++ = cycles >> (i * 8);
+    }
+
+    if (!sparse)
+    {
+        std::memcpy(out, mem.data, Memory::MAX_MEMORY);
+        return size;
+    }
+
+    std::memcpy(out, bitmap, BITMAP_SIZE);
+    out += BITMAP_SIZE;
+    for (u32 page = 0; page < Memory::PAGE_COUNT; page++)
+    {
+        if (bitmap[page / 8] & (1 << (page % 8)))
+        {
+            std::memcpy(out, mem.data + page * Memory::PAGE_SIZE, Memory::PAGE_SIZE);
+            out += Memory::PAGE_SIZE;
+        }
+    }
+    return size;
+}
+
+u32 emulator6502::load_state(CPU& cpu, Memory& mem, const byte* buffer, u32 size)
+{
+    // validate everything before touching cpu or mem
+    if (size < STATE_HEADER_SIZE) return 0;
+    if (std::memcmp(buffer, MAGIC, sizeof(MAGIC)) != 0) return 0;
+    if (buffer[4] != STATE_VERSION) return 0;
+
+    const byte encoding = buffer[5];
+    if (encoding != (byte)StateEncoding::FULL && encoding != (byte)StateEncoding::SPARSE) return 0;
+    const bool sparse = encoding == (byte)StateEncoding::SPARSE;
+
+    const byte* in = buffer + STATE_HEADER_SIZE;
+    const byte* bitmap = in;
+    u32 pages = Memory::PAGE_COUNT;
+    if (sparse)
+    {
+        if (size < STATE_HEADER_SIZE + BITMAP_SIZE) return 0;
+        pages = 0;
+        for (u32 i = 0; i < BITMAP_SIZE; i++)
+        {
+            pages += std::popcount(bitmap[i]);
+        }
+        in += BITMAP_SIZE;
+    }
+
+    const u32 expected = STATE_HEADER_SIZE + (sparse ? BITMAP_SIZE : 0) + pages * Memory::PAGE_SIZE;
+    if (size < expected) return 0;
+
+    const byte* registers = buffer + 6;
+    cpu.PC = registers[0] | (registers[1] << 8);
+    cpu.SP = registers[2];
+    cpu.A = registers[3];
+    cpu.X = registers[4];
+    cpu.Y = registers[5];
+    unpack_flags(cpu.flag, registers[6]);
+
+    u32 cycles = 0;
+    for (u32 i = 0; i < 4; i++)
+    {
+        cycles |= (u32)registers[7 + i] << (i * 8);
+    }
+    StateAccess::set_cycles(cpu, (s32)cycles);
+
+    if (!sparse)
+    {
+        std::memcpy(mem.data, in, Memory::MAX_MEMORY);
+    }
+    else
+    {
+        for (u32 page = 0; page < Memory::PAGE_COUNT; page++)
+        {
+            byte* dst = mem.data + page * Memory::PAGE_SIZE;
+            if (bitmap[page / 8] & (1 << (page % 8)))
+            {
+                std::memcpy(dst, in, Memory::PAGE_SIZE);
+                in += Memory::PAGE_SIZE;
+            }
+            else
+            {
+                std::memset(dst, 0, Memory::PAGE_SIZE);
+            }
+        }
+    }
+    StateAccess::data_replaced(mem);
+
+    return expected;
+}
+
+u32 emulator6502::save_diff(Memory& mem, byte* buffer, u32 capacity)
+{
+    u64 dirty[Memory::PAGE_COUNT / 64];
+    StateAccess::diff_pages(mem, dirty);
+    u32 pages = 0;
+    for (u32 i = 0; i < Memory::PAGE_COUNT / 64; i++)
+    {
+        pages += std::popcount(dirty[i]);
+    }
+
+    const u32 size = 2 + pages * (1 + Memory::PAGE_SIZE);
+    if (size > capacity) return 0;
+
+    byte* out = buffer;
+    *out++ = pages & 0xFF;
+    *out++ = pages >> 8;
+    for (u32 i = 0; i < Memory::PAGE_COUNT / 64; i++)
+    {
+        for (u64 bits = dirty[i]; bits; bits &= bits - 1)
+        {
+            const u32 page = i * 64 + std::countr_zero(bits);
+            *out++ = page;
+            std::memcpy(out, mem.data + page * Memory::PAGE_SIZE, Memory::PAGE_SIZE);
+            out += Memory::PAGE_SIZE;
+        }
+    }
+    StateAccess::diff_sent(mem);
+    return size;
+}
+
+u32 emulator6502::load_diff(Memory& mem, const byte* buffer, u32 size)
+{
+    if (size < 2) return 0;
+    const u32 pages = buffer[0] | (buffer[1] << 8);
+    const u32 expected = 2 + pages * (1 + Memory::PAGE_SIZE);
+    if (pages > Memory::PAGE_COUNT || size < expected) return 0;
+
+    // as the host would write them, so decoded code on the pages is dropped
+    const byte* in = buffer + 2;
+    for (u32 i = 0; i < pages; i++, in += 1 + Memory::PAGE_SIZE)
+    {
+        mem.load(in[0] * Memory::PAGE_SIZE, in + 1, Memory::PAGE_SIZE);
+    }
+    return expected;
+}
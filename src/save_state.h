@@ -0,0 +1,59 @@
+#ifndef _H_SAVE_STATE
+#define _H_SAVE_STATE
+
+#include "m6502.h"
+
+namespace emulator6502 {
+
+    /**
+     * Versioned binary snapshots of a CPU and its Memory. Layout, all values
+     * little endian:
+     *
+     *  magic "6502", version, encoding
+     *  PC (2), SP, A, X, Y, status flags (NV-BDIZC bit order), cycles (4)
+     *  memory:
+     *      FULL   : all 64K of Memory::data
+     *      SPARSE : 32 byte bitmap of non-zero pages, followed by those pages
+     *
+     * Only Memory::data is stored, the page mapping is configuration and is
+     * left as it is on load. Neither function allocates.
+    */
+    enum class StateEncoding : byte
+    {
+        FULL = 0,
+        SPARSE = 1,
+    };
+
+    constexpr byte STATE_VERSION = 1;
+    constexpr u32 STATE_HEADER_SIZE = 6 + 7 + 4;
+    // large enough for either encoding
+    constexpr u32 MAX_STATE_SIZE = STATE_HEADER_SIZE + Memory::PAGE_COUNT / 8 + Memory::MAX_MEMORY;
+
+    /** @return bytes written, 0 if the buffer is too small */
+    u32 save_state(const CPU&, const Memory&, byte* buffer, u32 capacity,
+        StateEncoding = StateEncoding::SPARSE);
+
+    /** @return bytes read, 0 if the buffer does not hold a valid state */
+    u32 load_state(CPU&, Memory&, const byte* buffer, u32 size);
+
+    /**
+     * Diffs of Memory::data for keeping a copy of it elsewhere up to date.
+     * A diff holds the pages written since the previous one was saved:
+     *
+     *  page count (2), then per page its index and contents
+     *
+     * The first diff of a Memory, and the first after init or load_state,
+     * holds every page. Saving one marks its pages as sent, a diff that did
+     * not fit marks nothing. Restoring a baseline leaves the pages it copies
+     * back that were sent already for the next diff.
+    */
+    constexpr u32 MAX_DIFF_SIZE = 2 + Memory::PAGE_COUNT * (1 + Memory::PAGE_SIZE);
+
+    /** @return bytes written, 0 if the buffer is too small */
+    u32 save_diff(Memory&, byte* buffer, u32 capacity);
+
+    /** @return bytes read, 0 if the buffer does not hold a valid diff */
+    u32 load_diff(Memory&, const byte* buffer, u32 size);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+
+using namespace emulator6502;
+
+class AccuracyTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    AccuracyTests()
+        : cpu(CPU(mem))
+    {}
+};
+
+TEST_F(AccuracyTests, FunctionalChargesBaseCycles)
+{
+    // with X = Y = 0 and operands 0x0300 no instruction crosses a page, so
+    // every opcode costs the same under both policies, apart from a taken
+    // branch which is charged as not taken
+    for (u32 opcode = 0; opcode < 256; opcode++)
+    {
+        const bool branch = (opcode & 0x1F) == 0x10;
+        mem = Memory();
+        mem[0x0200] = opcode;
+        mem[0x0201] = 0x00;
+        mem[0x0202] = 0x03;
+        mem[0x0300] = 0x80;
+
+        Memory exact_mem = mem;
+        CPU exact(exact_mem);
+        exact.reset(0x0200);
+        const ExecuteResult exact_result = exact.execute<CycleExact>(1);
+        if (exact_result.reason != StopReason::BUDGET) continue;
+        const s32 exact_cycles = exact_result.cycles;
+
+        cpu.reset(0x0200);
+        EXPECT_EQ(cpu.execute<Functional>(1).cycles, branch ? 2 : exact_cycles) << "opcode " << opcode;
+        EXPECT_EQ(cpu.PC, exact.PC) << "opcode " << opcode;
+        EXPECT_EQ(cpu.SP, exact.SP) << "opcode " << opcode;
+        EXPECT_EQ(cpu.A, exact.A) << "opcode " << opcode;
+        EXPECT_EQ(cpu.PS, exact.PS) << "opcode " << opcode;
+        EXPECT_EQ(memcmp(mem.data, exact_mem.data, Memory::MAX_MEMORY), 0) << "opcode " << opcode;
+    }
+}
+
+TEST_F(AccuracyTests, FunctionalIgnoresPageCrossing)
+{
+    cpu.reset(0x0200);
+    cpu.X = 0x01;
+    mem[0x0200] = CPU::INS_LDA_AX;
+    mem[0x0201] = 0xFF;
+    mem[0x0202] = 0x30;
+    mem[0x3100] = 0x42;
+
+    Memory exact_mem = mem;
+    CPU exact(exact_mem);
+    exact.reset(0x0200);
+    exact.X = 0x01;
+
+    EXPECT_EQ(exact.execute<CycleExact>(1).cycles, 5);
+    EXPECT_EQ(cpu.execute<Functional>(1).cycles, 4);
+    EXPECT_EQ(cpu.A, 0x42);
+    EXPECT_EQ(exact.A, 0x42);
+}
+
+TEST_F(AccuracyTests, FunctionalStopsOnWholeInstructions)
+{
+    cpu.reset(0x0200);
+    mem[0x0200] = CPU::INS_LDA_IM;
+    mem[0x0201] = 0x01;
+    mem[0x0202] = CPU::INS_JMP_ABS;
+    mem[0x0203] = 0x00;
+    mem[0x0204] = 0x02;
+
+    // the budget runs out inside the second instruction, which completes
+    EXPECT_EQ(cpu.execute<Functional>(3).cycles, 5);
+    EXPECT_EQ(cpu.PC, 0x0200);
+    EXPECT_EQ(cpu.execute<Functional>(5 * 1000).cycles, 5 * 1000);
+    EXPECT_EQ(cpu.PC, 0x0200);
+    EXPECT_EQ(cpu.A, 0x01);
+}
+
+TEST_F(AccuracyTests, FunctionalIgnoresTakenBranches)
+{
+    // taken, to the next page
+    cpu.reset(0x02F0);
+    mem[0x02F0] = CPU::INS_BCC;
+    mem[0x02F1] = 0x20;
+
+    Memory exact_mem = mem;
+    CPU exact(exact_mem);
+    exact.reset(0x02F0);
+
+    EXPECT_EQ(exact.execute<CycleExact>(1).cycles, 4);
+    EXPECT_EQ(cpu.execute<Functional>(1).cycles, 2);
+    EXPECT_EQ(cpu.PC, 0x0312);
+    EXPECT_EQ(exact.PC, 0x0312);
+}
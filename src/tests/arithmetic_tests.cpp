@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "alu.h"
+
+using namespace emulator6502;
+
+class ArithmeticTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    ArithmeticTests()
+        : cpu(CPU(mem))
+    {}
+
+    virtual void SetUp()
+    {
+        cpu.reset();
+    }
+
+    // runs opcode #value on A with the given flags
+    void run_immediate(byte opcode, byte a, byte value, byte ps)
+    {
+        cpu.reset();
+        cpu.A = a;
+        cpu.PS = ps;
+        mem[0xFFFC] = opcode;
+        mem[0xFFFD] = value;
+        EXPECT_EQ(cpu.execute(2).cycles, 2);
+    }
+};
+
+TEST_F(ArithmeticTests, TablesMatchComputedFlags)
+{
+    for (u32 value = 0; value < 256; value++)
+    {
+        EXPECT_EQ(alu_tables.nz[value], nz_flags(value));
+    }
+    for (u32 index = 0; index < AluTables::ENTRIES; index++)
+    {
+        const bool carry = index >> 16;
+        const byte a = index >> 8;
+        const byte value = index;
+        ASSERT_EQ(alu_tables.adc[index], adc_binary(a, value, carry)) << index;
+        ASSERT_EQ(alu_tables.adc_decimal[index], adc_decimal(a, value, carry)) << index;
+        ASSERT_EQ(alu_tables.sbc_decimal[index], sbc_decimal(a, value, carry)) << index;
+    }
+}
+
+TEST_F(ArithmeticTests, ADC_IM)
+{
+    run_immediate(CPU::INS_ADC_IM, 0x10, 0x22, FLAG_C);
+    EXPECT_EQ(cpu.A, 0x33);
+    EXPECT_EQ(cpu.PS, 0x00);
+
+    // carry out and zero
+    run_immediate(CPU::INS_ADC_IM, 0xFF, 0x01, 0x00);
+    EXPECT_EQ(cpu.A, 0x00);
+    EXPECT_EQ(cpu.PS, FLAG_C | FLAG_Z);
+
+    // signed overflow
+    run_immediate(CPU::INS_ADC_IM, 0x7F, 0x01, 0x00);
+    EXPECT_EQ(cpu.A, 0x80);
+    EXPECT_EQ(cpu.PS, FLAG_V | FLAG_N);
+}
+
+TEST_F(ArithmeticTests, ADC_DECIMAL)
+{
+    run_immediate(CPU::INS_ADC_IM, 0x19, 0x28, FLAG_D);
+    EXPECT_EQ(cpu.A, 0x47);
+    EXPECT_EQ(cpu.PS, FLAG_D);
+
+    run_immediate(CPU::INS_ADC_IM, 0x58, 0x46, FLAG_D | FLAG_C);
+    EXPECT_EQ(cpu.A, 0x05);
+    EXPECT_EQ(cpu.PS & FLAG_C, FLAG_C);
+
+    // Z follows the binary sum on NMOS, 0x99 + 0x01 is 0x00 decimal
+    run_immediate(CPU::INS_ADC_IM, 0x99, 0x01, FLAG_D);
+    EXPECT_EQ(cpu.A, 0x00);
+    EXPECT_EQ(cpu.PS & (FLAG_C | FLAG_Z), FLAG_C);
+}
+
+TEST_F(ArithmeticTests, SBC_IM)
+{
+    run_immediate(CPU::INS_SBC_IM, 0x50, 0x20, FLAG_C);
+    EXPECT_EQ(cpu.A, 0x30);
+    EXPECT_EQ(cpu.PS, FLAG_C);
+
+    // borrow
+    run_immediate(CPU::INS_SBC_IM, 0x00, 0x01, FLAG_C);
+    EXPECT_EQ(cpu.A, 0xFF);
+    EXPECT_EQ(cpu.PS, FLAG_N);
+
+    // signed overflow, -128 - 1
+    run_immediate(CPU::INS_SBC_IM, 0x80, 0x00, 0x00);
+    EXPECT_EQ(cpu.A, 0x7F);
+    EXPECT_EQ(cpu.PS, FLAG_V | FLAG_C);
+}
+
+TEST_F(ArithmeticTests, SBC_DECIMAL)
+{
+    run_immediate(CPU::INS_SBC_IM, 0x46, 0x12, FLAG_D | FLAG_C);
+    EXPECT_EQ(cpu.A, 0x34);
+    EXPECT_EQ(cpu.PS, FLAG_D | FLAG_C);
+
+    run_immediate(CPU::INS_SBC_IM, 0x12, 0x21, FLAG_D | FLAG_C);
+    EXPECT_EQ(cpu.A, 0x91);
+    EXPECT_EQ(cpu.PS & FLAG_C, 0);
+}
+
+TEST_F(ArithmeticTests, ADC_ABS)
+{
+    cpu.A = 0x01;
+    mem[0xFFFC] = CPU::INS_ADC_ABS;
+    mem.write_word(0x4480, 0xFFFD);
+    mem[0x4480] = 0x41;
+    EXPECT_EQ(cpu.execute(4).cycles, 4);
+    EXPECT_EQ(cpu.A, 0x42);
+}
+
+TEST_F(ArithmeticTests, SBC_IY)
+{
+    cpu.A = 0x50;
+    cpu.Y = 0xFF;
+    cpu.flag.C = 1;
+    mem[0xFFFC] = CPU::INS_SBC_IY;
+    mem[0xFFFD] = 0x02;
+    mem.write_word(0x7F01, 0x0002);
+    mem[0x8000] = 0x08;
+    EXPECT_EQ(cpu.execute(6).cycles, 6);
+    EXPECT_EQ(cpu.A, 0x48);
+}
+
+TEST_F(ArithmeticTests, CMP)
+{
+    run_immediate(CPU::INS_CMP_IM, 0x40, 0x40, 0x00);
+    EXPECT_EQ(cpu.PS, FLAG_Z | FLAG_C);
+    EXPECT_EQ(cpu.A, 0x40);
+
+    run_immediate(CPU::INS_CMP_IM, 0x40, 0x41, 0x00);
+    EXPECT_EQ(cpu.PS, FLAG_N);
+
+    // decimal mode does not apply to compares, V is left alone
+    run_immediate(CPU::INS_CMP_IM, 0x41, 0x40, FLAG_D | FLAG_V);
+    EXPECT_EQ(cpu.PS, FLAG_D | FLAG_V | FLAG_C);
+}
+
+TEST_F(ArithmeticTests, CPX_CPY)
+{
+    cpu.X = 0x10;
+    mem[0xFFFC] = CPU::INS_CPX_ZP;
+    mem[0xFFFD] = 0x20;
+    mem[0x0020] = 0x20;
+    EXPECT_EQ(cpu.execute(3).cycles, 3);
+    EXPECT_EQ(cpu.PS, FLAG_N);
+
+    cpu.reset();
+    cpu.Y = 0x30;
+    mem[0xFFFC] = CPU::INS_CPY_ABS;
+    mem.write_word(0x4480, 0xFFFD);
+    mem[0x4480] = 0x20;
+    EXPECT_EQ(cpu.execute(4).cycles, 4);
+    EXPECT_EQ(cpu.PS, FLAG_C);
+}
+
+TEST_F(ArithmeticTests, BIT)
+{
+    cpu.A = 0x01;
+    mem[0xFFFC] = CPU::INS_BIT_ZP;
+    mem[0xFFFD] = 0x20;
+    mem[0x0020] = 0xC0;
+    EXPECT_EQ(cpu.execute(3).cycles, 3);
+    EXPECT_EQ(cpu.PS, FLAG_N | FLAG_V | FLAG_Z);
+    EXPECT_EQ(cpu.A, 0x01);
+
+    cpu.reset();
+    cpu.A = 0x41;
+    cpu.PS = FLAG_N | FLAG_V | FLAG_Z;
+    mem[0xFFFC] = CPU::INS_BIT_ABS;
+    mem.write_word(0x4480, 0xFFFD);
+    mem[0x4480] = 0x01;
+    EXPECT_EQ(cpu.execute(4).cycles, 4);
+    EXPECT_EQ(cpu.PS, 0x00);
+}
@@ -0,0 +1,186 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "block_cache.h"
+
+#include <vector>
+
+using namespace emulator6502;
+
+class BlockCacheTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    BlockCacheTests()
+        : cpu(CPU(mem))
+    {}
+
+    void load(word address, const std::vector<byte>& program)
+    {
+        for (byte b : program)
+        {
+            mem[address++] = b;
+        }
+    }
+
+    // runs the loaded program for every budget up to max_cycles, through
+    // the cache and the interpreter, and compares the results
+    void expect_matches_interpreter(s32 max_cycles)
+    {
+        const Memory program = mem;
+        for (s32 budget = 1; budget <= max_cycles; budget++)
+        {
+            mem = program;
+            Memory reference_mem = program;
+            CPU reference(reference_mem);
+            reference.reset(0x0200);
+            cpu.reset(0x0200);
+
+            BlockCache cache(mem);
+            s32 cycles = reference.execute(budget).cycles;
+            EXPECT_EQ(cpu.execute(budget, cache).cycles, cycles) << "budget " << budget;
+            EXPECT_EQ(cpu.PC, reference.PC) << "budget " << budget;
+            EXPECT_EQ(cpu.SP, reference.SP) << "budget " << budget;
+            EXPECT_EQ(cpu.A, reference.A) << "budget " << budget;
+            EXPECT_EQ(cpu.X, reference.X) << "budget " << budget;
+            EXPECT_EQ(cpu.Y, reference.Y) << "budget " << budget;
+            EXPECT_EQ(cpu.PS, reference.PS) << "budget " << budget;
+            EXPECT_EQ(memcmp(mem.data, reference_mem.data, Memory::MAX_MEMORY), 0) << "budget " << budget;
+        }
+    }
+};
+
+TEST_F(BlockCacheTests, MatchesInterpreter)
+{
+    load(0x0200, {
+        CPU::INS_LDX_IM,  0x03,
+        CPU::INS_LDY_IM,  0x81,
+        CPU::INS_LDA_IM,  0x0F,
+        CPU::INS_STA_ZPX, 0x10,
+        CPU::INS_AND_ZP,  0x13,
+        CPU::INS_EOR_IM,  0xF0,
+        CPU::INS_ORA_ABS, 0x00, 0x30,
+        CPU::INS_STA_AY,  0xF0, 0x20,
+        CPU::INS_LDA_IY,  0x20,
+        CPU::INS_PHA,
+        CPU::INS_PHP,
+        CPU::INS_PLP,
+        CPU::INS_PLA,
+        CPU::INS_JSR,     0x00, 0x40,
+        CPU::INS_JMP_I,   0x22, 0x00,
+    });
+    mem[0x3000] = 0x01;
+    mem[0x0022] = 0x00;
+    mem[0x0023] = 0x02;
+    mem[0x4000] = CPU::INS_TSX;
+    mem[0x4001] = CPU::INS_RTS;
+
+    expect_matches_interpreter(150);
+}
+
+TEST_F(BlockCacheTests, ReusesBlocks)
+{
+    load(0x0200, {
+        CPU::INS_LDA_IM,  0x01,
+        CPU::INS_EOR_IM,  0xFF,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    cpu.reset(0x0200);
+
+    BlockCache cache(mem);
+    EXPECT_EQ(cpu.execute(7 * 100, cache).cycles, 7 * 100);
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cpu.A, 0xFE);
+    EXPECT_EQ(cpu.PC, 0x0200);
+}
+
+TEST_F(BlockCacheTests, WriteToRunningBlock)
+{
+    // the store rewrites the operand of the LDX that follows it
+    load(0x0200, {
+        CPU::INS_LDA_IM,  0x05,
+        CPU::INS_STA_ABS, 0x06, 0x02,
+        CPU::INS_LDX_IM,  0x00,
+        CPU::INS_JMP_ABS, 0x07, 0x02,
+    });
+    cpu.reset(0x0200);
+
+    BlockCache cache(mem);
+    cpu.execute(8, cache);
+    EXPECT_EQ(cpu.X, 0x05);
+    EXPECT_EQ(cache.invalidations(), 1u);
+
+    expect_matches_interpreter(40);
+}
+
+TEST_F(BlockCacheTests, WriteToOtherBlock)
+{
+    // the block at 0x0200 rewrites the immediate loaded by the subroutine
+    load(0x0200, {
+        CPU::INS_JSR,     0x00, 0x03,
+        CPU::INS_LDA_IM,  0x22,
+        CPU::INS_STA_ABS, 0x01, 0x03,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    load(0x0300, {
+        CPU::INS_LDA_IM,  0x11,
+        CPU::INS_STX_ZP,  0x40,
+        CPU::INS_RTS,
+    });
+
+    expect_matches_interpreter(80);
+}
+
+TEST_F(BlockCacheTests, HostWriteInvalidates)
+{
+    load(0x0200, {
+        CPU::INS_LDA_IM,  0x11,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    cpu.reset(0x0200);
+
+    BlockCache cache(mem);
+    cpu.execute(5, cache);
+    EXPECT_EQ(cpu.A, 0x11);
+
+    mem[0x0201] = 0x22;
+    EXPECT_EQ(cache.size(), 0u);
+    cpu.execute(5, cache);
+    EXPECT_EQ(cpu.A, 0x22);
+}
+
+TEST_F(BlockCacheTests, UnknownInstructionStops)
+{
+    load(0x0200, {
+        CPU::INS_LDA_IM,  0x11,
+        0xFF,
+    });
+    cpu.reset(0x0200);
+
+    BlockCache cache(mem);
+    const ExecuteResult result = cpu.execute(10, cache);
+    EXPECT_EQ(result.reason, StopReason::ILLEGAL_OPCODE);
+    EXPECT_EQ(result.cycles, 2 + 1);
+    EXPECT_EQ(result.PC, 0x0202);
+    EXPECT_EQ(cpu.A, 0x11);
+}
+
+TEST_F(BlockCacheTests, DestroyedCacheReleasesMemory)
+{
+    load(0x0200, {
+        CPU::INS_STA_ABS, 0x80, 0x02,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    cpu.reset(0x0200);
+    {
+        BlockCache cache(mem);
+        cpu.execute(7, cache);
+        EXPECT_EQ(cache.size(), 1u);
+    }
+    // the code page is writable again without a cache behind it
+    cpu.reset(0x0200);
+    cpu.A = 0x42;
+    cpu.execute(4);
+    EXPECT_EQ(mem[0x0280], 0x42);
+}
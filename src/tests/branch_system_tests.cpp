@@ -0,0 +1,169 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+
+using namespace emulator6502;
+
+class BranchSystemTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    BranchSystemTests()
+        : cpu(CPU(mem))
+    {}
+
+    virtual void SetUp()
+    {
+        cpu.reset();
+    }
+
+    // runs the branch at address with the given flags
+    /** @return cycles used */
+    s32 run_branch(byte opcode, byte ps, word address, byte offset)
+    {
+        cpu.reset(address);
+        cpu.PS = ps;
+        mem[address] = opcode;
+        mem[address + 1] = offset;
+        return cpu.execute(1).cycles;
+    }
+};
+
+TEST_F(BranchSystemTests, BRANCHES)
+{
+    struct Branch { byte opcode; byte taken_ps; byte not_taken_ps; };
+    const Branch branches[] = {
+        { CPU::INS_BCC, 0x00, FLAG_C }, { CPU::INS_BCS, FLAG_C, 0x00 },
+        { CPU::INS_BNE, 0x00, FLAG_Z }, { CPU::INS_BEQ, FLAG_Z, 0x00 },
+        { CPU::INS_BPL, 0x00, FLAG_N }, { CPU::INS_BMI, FLAG_N, 0x00 },
+        { CPU::INS_BVC, 0x00, FLAG_V }, { CPU::INS_BVS, FLAG_V, 0x00 },
+    };
+
+    for (const Branch& branch : branches)
+    {
+        EXPECT_EQ(run_branch(branch.opcode, branch.not_taken_ps, 0x0280, 0x10), 2);
+        EXPECT_EQ(cpu.PC, 0x0282);
+
+        EXPECT_EQ(run_branch(branch.opcode, branch.taken_ps, 0x0280, 0x10), 3);
+        EXPECT_EQ(cpu.PC, 0x0292);
+
+        // backwards, the offset is relative to the next instruction
+        EXPECT_EQ(run_branch(branch.opcode, branch.taken_ps, 0x0280, 0xFE), 3);
+        EXPECT_EQ(cpu.PC, 0x0280);
+
+        // onto the previous and the next page
+        EXPECT_EQ(run_branch(branch.opcode, branch.taken_ps, 0x0300, 0x80), 4);
+        EXPECT_EQ(cpu.PC, 0x0282);
+        EXPECT_EQ(run_branch(branch.opcode, branch.taken_ps, 0x02F0, 0x10), 4);
+        EXPECT_EQ(cpu.PC, 0x0302);
+    }
+}
+
+TEST_F(BranchSystemTests, BRANCH_LOOP)
+{
+    // counts X down from 5, the last BNE falls through
+    const byte program[] = {
+        CPU::INS_LDX_IM, 0x05,
+        CPU::INS_DEX,
+        CPU::INS_BNE,    0xFD,
+        CPU::INS_NOP,
+    };
+    cpu.reset(0x0200);
+    for (u32 i = 0; i < sizeof(program); i++)
+    {
+        mem[0x0200 + i] = program[i];
+    }
+
+    EXPECT_EQ(cpu.execute(2 + 4 * 5 + 4 + 2).cycles, 2 + 4 * 5 + 4 + 2);
+    EXPECT_EQ(cpu.X, 0x00);
+    EXPECT_EQ(cpu.PC, 0x0206);
+}
+
+TEST_F(BranchSystemTests, FLAG_CHANGES)
+{
+    const byte program[] = {
+        CPU::INS_SEC, CPU::INS_SED, CPU::INS_SEI,
+        CPU::INS_CLC, CPU::INS_CLD, CPU::INS_CLI, CPU::INS_CLV,
+    };
+    cpu.reset(0x0200);
+    for (u32 i = 0; i < sizeof(program); i++)
+    {
+        mem[0x0200 + i] = program[i];
+    }
+
+    EXPECT_EQ(cpu.execute(6).cycles, 6);
+    EXPECT_EQ(cpu.PS, FLAG_C | FLAG_D | FLAG_I);
+
+    cpu.PS |= FLAG_V | FLAG_N;
+    EXPECT_EQ(cpu.execute(8).cycles, 8);
+    EXPECT_EQ(cpu.PS, FLAG_N);
+}
+
+TEST_F(BranchSystemTests, TRANSFERS)
+{
+    cpu.A = 0x80;
+    mem[0xFFFC] = CPU::INS_TAX;
+    EXPECT_EQ(cpu.execute(2).cycles, 2);
+    EXPECT_EQ(cpu.X, 0x80);
+    EXPECT_EQ(cpu.PS, FLAG_N);
+
+    cpu.reset();
+    cpu.A = 0x00;
+    cpu.Y = 0x42;
+    mem[0xFFFC] = CPU::INS_TAY;
+    EXPECT_EQ(cpu.execute(2).cycles, 2);
+    EXPECT_EQ(cpu.Y, 0x00);
+    EXPECT_EQ(cpu.PS, FLAG_Z);
+
+    cpu.reset();
+    cpu.X = 0x42;
+    mem[0xFFFC] = CPU::INS_TXA;
+    EXPECT_EQ(cpu.execute(2).cycles, 2);
+    EXPECT_EQ(cpu.A, 0x42);
+    EXPECT_EQ(cpu.PS, 0x00);
+
+    cpu.reset();
+    cpu.Y = 0x43;
+    mem[0xFFFC] = CPU::INS_TYA;
+    EXPECT_EQ(cpu.execute(2).cycles, 2);
+    EXPECT_EQ(cpu.A, 0x43);
+}
+
+TEST_F(BranchSystemTests, BRK_RTI)
+{
+    cpu.reset(0x0200);
+    cpu.PS = FLAG_C | FLAG_D;
+    mem[0x0200] = CPU::INS_BRK;
+    mem[0x0201] = 0xEA; // skipped
+    mem[0x0202] = CPU::INS_LDA_IM;
+    mem[0x0203] = 0x42;
+    mem.write_word(0x4000, 0xFFFE);
+    mem[0x4000] = CPU::INS_CLC;
+    mem[0x4001] = CPU::INS_RTI;
+
+    EXPECT_EQ(cpu.execute(7).cycles, 7);
+    EXPECT_EQ(cpu.PC, 0x4000);
+    EXPECT_EQ(cpu.SP, 0xFC);
+    EXPECT_EQ(cpu.PS, FLAG_C | FLAG_D | FLAG_I);
+    // return address, then the flags with B and the unused bit
+    EXPECT_EQ(mem[0x01FF], 0x02);
+    EXPECT_EQ(mem[0x01FE], 0x02);
+    EXPECT_EQ(mem[0x01FD], FLAG_C | FLAG_D | FLAG_B | FLAG_U);
+
+    // RTI restores the pushed flags, and returns past the padding byte
+    EXPECT_EQ(cpu.execute(2 + 6 + 2).cycles, 2 + 6 + 2);
+    EXPECT_EQ(cpu.PC, 0x0204);
+    EXPECT_EQ(cpu.SP, 0xFF);
+    EXPECT_EQ(cpu.A, 0x42);
+    EXPECT_EQ(cpu.PS & (FLAG_C | FLAG_D | FLAG_I), FLAG_C | FLAG_D);
+}
+
+TEST_F(BranchSystemTests, NOP)
+{
+    mem[0xFFFC] = CPU::INS_NOP;
+    EXPECT_EQ(cpu.execute(2).cycles, 2);
+    EXPECT_EQ(cpu.PC, 0xFFFD);
+    EXPECT_EQ(cpu.PS, 0x00);
+    EXPECT_EQ(cpu.SP, 0xFF);
+}
@@ -0,0 +1,210 @@
+#include "gtest/gtest.h"
+#include "cpu_batch.h"
+
+#include <cstring>
+
+using namespace emulator6502;
+
+class CPUBatchTests : public testing::Test
+{
+public:
+    static constexpr u32 INSTANCES = 40;
+
+    // program shared by every instance, the input byte at 0x0010 differs
+    static void load_program(Memory& mem, byte input)
+    {
+        const byte program[] = {
+            CPU::INS_LDX_ZP,  0x10,
+            CPU::INS_LDA_AX,  0xF0, 0x20,
+            CPU::INS_EOR_IM,  0x5A,
+            CPU::INS_STA_ZPX, 0x40,
+            CPU::INS_AND_ZP,  0x10,
+            CPU::INS_ORA_ABS, 0x00, 0x30,
+            CPU::INS_TSX,
+            CPU::INS_JSR,     0x00, 0x40,
+            CPU::INS_STY_ABS, 0x00, 0x50,
+            CPU::INS_JMP_ABS, 0x00, 0x02,
+        };
+        word address = 0x0200;
+        for (byte b : program)
+        {
+            mem[address++] = b;
+        }
+        mem[0x4000] = CPU::INS_LDY_IM;
+        mem[0x4001] = 0x80;
+        mem[0x4002] = CPU::INS_RTS;
+        mem[0x0010] = input;
+        for (u32 i = 0; i < 0x200; i++)
+        {
+            mem[0x20F0 + i] = (byte)(i * 7);
+        }
+    }
+};
+
+TEST_F(CPUBatchTests, MatchesIndividualCPUs)
+{
+    CPUBatch batch(INSTANCES);
+    for (u32 i = 0; i < INSTANCES; i++)
+    {
+        batch.memory(i).init();
+        // a few distinct inputs, some of them crossing a page in LDA_AX
+        load_program(batch.memory(i), (byte)(i % 4 * 0x21));
+    }
+    batch.reset(0x0200);
+    batch.execute(1000);
+
+    for (u32 i = 0; i < INSTANCES; i++)
+    {
+        Memory mem;
+        CPU cpu(mem);
+        cpu.reset(0x0200);
+        load_program(mem, (byte)(i % 4 * 0x21));
+        s32 cycles_used = cpu.execute(1000).cycles;
+
+        EXPECT_EQ(batch.cycles_used(i), cycles_used);
+        EXPECT_EQ(batch.PC[i], cpu.PC);
+        EXPECT_EQ(batch.SP[i], cpu.SP);
+        EXPECT_EQ(batch.A[i], cpu.A);
+        EXPECT_EQ(batch.X[i], cpu.X);
+        EXPECT_EQ(batch.Y[i], cpu.Y);
+        EXPECT_EQ(batch.PS[i], cpu.PS);
+        EXPECT_EQ(0, std::memcmp(batch.memory(i).data, mem.data, Memory::MAX_MEMORY));
+    }
+}
+
+TEST_F(CPUBatchTests, BranchesAndArithmeticMatchIndividualCPUs)
+{
+    // loop count, decimal mode and the branches taken all depend on the input
+    const byte program[] = {
+        CPU::INS_LDA_ZP,  0x10,
+        CPU::INS_AND_IM,  0x03,
+        CPU::INS_TAX,
+        CPU::INS_INX,
+        CPU::INS_LDA_ZP,  0x10,
+        CPU::INS_AND_IM,  0x04,
+        CPU::INS_BEQ,     0x01,
+        CPU::INS_SED,
+        CPU::INS_CLC,
+        // 0x02FE, the loop branch crosses back over the page
+        CPU::INS_ADC_ZP,  0x11,
+        CPU::INS_SBC_IM,  0x07,
+        CPU::INS_DEX,
+        CPU::INS_BNE,     0xF9,
+        CPU::INS_CMP_IM,  0x80,
+        CPU::INS_BCS,     0x02,
+        CPU::INS_INY,
+        CPU::INS_INY,
+        CPU::INS_CPY_IM,  0x05,
+        CPU::INS_BCC,     0x03,
+        CPU::INS_LDY_IM,  0x00,
+        CPU::INS_NOP,
+        CPU::INS_CLD,
+        CPU::INS_CLV,
+        CPU::INS_TYA,
+        CPU::INS_STA_ZP,  0x12,
+        CPU::INS_JMP_ABS, 0xF0, 0x02,
+    };
+    auto load = [&](Memory& mem, u32 instance)
+    {
+        word address = 0x02F0;
+        for (byte b : program)
+        {
+            mem[address++] = b;
+        }
+        mem[0x0010] = (byte)(instance * 37);
+        mem[0x0011] = (byte)(instance * 11 + 3);
+    };
+
+    CPUBatch batch(INSTANCES);
+    for (u32 i = 0; i < INSTANCES; i++)
+    {
+        batch.memory(i).init();
+        load(batch.memory(i), i);
+    }
+    batch.reset(0x02F0);
+    batch.execute(3000);
+
+    for (u32 i = 0; i < INSTANCES; i++)
+    {
+        Memory mem;
+        CPU cpu(mem);
+        cpu.reset(0x02F0);
+        load(mem, i);
+        s32 cycles_used = cpu.execute(3000).cycles;
+
+        EXPECT_EQ(batch.cycles_used(i), cycles_used);
+        EXPECT_EQ(batch.PC[i], cpu.PC);
+        EXPECT_EQ(batch.A[i], cpu.A);
+        EXPECT_EQ(batch.X[i], cpu.X);
+        EXPECT_EQ(batch.Y[i], cpu.Y);
+        EXPECT_EQ(batch.PS[i], cpu.PS);
+        EXPECT_EQ(0, std::memcmp(batch.memory(i).data, mem.data, Memory::MAX_MEMORY));
+    }
+}
+
+TEST_F(CPUBatchTests, DivergentCodeFallsBack)
+{
+    CPUBatch batch(3);
+    for (u32 i = 0; i < 3; i++)
+    {
+        batch.memory(i).init();
+        load_program(batch.memory(i), 0x01);
+    }
+    // instance 1 runs different code at the same PC
+    batch.memory(1)[0x0200] = CPU::INS_LDY_IM;
+    batch.memory(1)[0x0201] = 0x33;
+    batch.set_code_verification(true);
+    batch.reset(0x0200);
+    batch.execute(2);
+
+    EXPECT_EQ(batch.X[0], 0x01);
+    EXPECT_EQ(batch.Y[1], 0x33);
+    EXPECT_EQ(batch.X[1], 0x00);
+    EXPECT_EQ(batch.cycles_used(0), 3);
+    EXPECT_EQ(batch.cycles_used(1), 2);
+}
+
+TEST_F(CPUBatchTests, StoresDoNotPayPageCrossing)
+{
+    CPUBatch batch(INSTANCES);
+    for (u32 i = 0; i < INSTANCES; i++)
+    {
+        Memory& mem = batch.memory(i);
+        mem.init();
+        // LDX #$20, STA $30F0,X crosses into page 0x31
+        mem[0x0200] = CPU::INS_LDX_IM;
+        mem[0x0201] = 0x20;
+        mem[0x0202] = CPU::INS_STA_AX;
+        mem[0x0203] = 0xF0;
+        mem[0x0204] = 0x30;
+    }
+    batch.reset(0x0200);
+    batch.execute(7);
+
+    for (u32 i = 0; i < INSTANCES; i++)
+    {
+        EXPECT_EQ(batch.cycles_used(i), 2 + 5);
+        EXPECT_EQ(batch.PC[i], 0x0205);
+    }
+}
+
+TEST_F(CPUBatchTests, UnknownInstructionStopsInstance)
+{
+    CPUBatch batch(3);
+    for (u32 i = 0; i < 3; i++)
+    {
+        batch.memory(i).init();
+        load_program(batch.memory(i), 0x01);
+    }
+    batch.memory(1)[0x0202] = 0xFF;
+    batch.set_code_verification(true);
+    batch.reset(0x0200);
+    batch.execute(100);
+
+    EXPECT_EQ(batch.stop_reason(0), StopReason::BUDGET);
+    EXPECT_EQ(batch.stop_reason(1), StopReason::ILLEGAL_OPCODE);
+    EXPECT_EQ(batch.stop_reason(2), StopReason::BUDGET);
+    EXPECT_EQ(batch.PC[1], 0x0202);
+    EXPECT_EQ(batch.cycles_used(1), 3 + 1);
+    EXPECT_GE(batch.cycles_used(0), 100);
+}
@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "disassembler.h"
+#include "trace.h"
+
+#include <string>
+
+using namespace emulator6502;
+
+class DisassemblerTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    DisassemblerTests()
+        : cpu(CPU(mem))
+    {}
+
+    std::string line(word address)
+    {
+        char out[DISASSEMBLY_LINE_MAX];
+        return std::string(out, disassemble(mem, address, out));
+    }
+
+    // everything written through a DisassemblyWriter
+    template<typename Write>
+    std::string stream(Write write)
+    {
+        char* text = nullptr;
+        size_t size = 0;
+        FILE* out = open_memstream(&text, &size);
+        {
+            DisassemblyWriter writer(out, 64);
+            write(writer);
+        }
+        fclose(out);
+        std::string result(text, size);
+        free(text);
+        return result;
+    }
+};
+
+TEST_F(DisassemblerTests, EveryAddressingMode)
+{
+    const byte program[] = {
+        CPU::INS_NOP,
+        CPU::INS_ASL_A,
+        CPU::INS_LDA_IM,  0x42,
+        CPU::INS_LDA_ZP,  0x10,
+        CPU::INS_LDA_ZPX, 0x10,
+        CPU::INS_LDX_ZPY, 0x10,
+        CPU::INS_LDA_ABS, 0x34, 0x12,
+        CPU::INS_LDA_AX,  0x34, 0x12,
+        CPU::INS_LDA_AY,  0x34, 0x12,
+        CPU::INS_JMP_I,   0x34, 0x12,
+        CPU::INS_LDA_IX,  0x10,
+        CPU::INS_LDA_IY,  0x10,
+    };
+    mem.load(0x0200, program, sizeof(program));
+
+    EXPECT_EQ(line(0x0200), "0200  EA        NOP");
+    EXPECT_EQ(line(0x0201), "0201  0A        ASL A");
+    EXPECT_EQ(line(0x0202), "0202  A9 42     LDA #$42");
+    EXPECT_EQ(line(0x0204), "0204  A5 10     LDA $10");
+    EXPECT_EQ(line(0x0206), "0206  B5 10     LDA $10,X");
+    EXPECT_EQ(line(0x0208), "0208  B6 10     LDX $10,Y");
+    EXPECT_EQ(line(0x020A), "020A  AD 34 12  LDA $1234");
+    EXPECT_EQ(line(0x020D), "020D  BD 34 12  LDA $1234,X");
+    EXPECT_EQ(line(0x0210), "0210  B9 34 12  LDA $1234,Y");
+    EXPECT_EQ(line(0x0213), "0213  6C 34 12  JMP ($1234)");
+    EXPECT_EQ(line(0x0216), "0216  A1 10     LDA ($10,X)");
+    EXPECT_EQ(line(0x0218), "0218  B1 10     LDA ($10),Y");
+}
+
+TEST_F(DisassemblerTests, BranchTargetsAreAbsolute)
+{
+    mem[0x0200] = CPU::INS_BNE;
+    mem[0x0201] = 0xFE;
+    mem[0x0202] = CPU::INS_BCC;
+    mem[0x0203] = 0x10;
+
+    EXPECT_EQ(line(0x0200), "0200  D0 FE     BNE $0200");
+    EXPECT_EQ(line(0x0202), "0202  90 10     BCC $0214");
+}
+
+TEST_F(DisassemblerTests, UnknownOpcodesAreBytes)
+{
+    mem[0x0200] = 0x02;
+    EXPECT_EQ(line(0x0200), "0200  02        .byte $02");
+}
+
+TEST_F(DisassemblerTests, LongestLineFits)
+{
+    mem[0x0200] = CPU::INS_LDA_IY;
+    mem[0x0201] = 0xFF;
+    mem[0x0202] = 0xFF;
+    EXPECT_LE(line(0x0200).size(), DISASSEMBLY_LINE_MAX);
+}
+
+TEST_F(DisassemblerTests, RangeIsStreamedInOnePass)
+{
+    const byte program[] = {
+        CPU::INS_LDA_IM,  0x01,
+        CPU::INS_STA_ABS, 0x00, 0x30,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    };
+    mem.load(0x0200, program, sizeof(program));
+
+    u64 lines = 0;
+    const std::string text = stream([&](DisassemblyWriter& writer) {
+        lines = writer.write_range(mem, 0x0200, 0x0207);
+    });
+    EXPECT_EQ(lines, 3u);
+    EXPECT_EQ(text,
+        "0200  A9 01     LDA #$01\n"
+        "0202  8D 00 30  STA $3000\n"
+        "0205  4C 00 02  JMP $0200\n");
+}
+
+TEST_F(DisassemblerTests, RangeEndingAtTopOfMemory)
+{
+    u64 lines = 0;
+    const std::string text = stream([&](DisassemblyWriter& writer) {
+        lines = writer.write_range(mem, 0xFFFE, 0xFFFF);
+    });
+    // zeroed memory is BRK with its signature byte
+    EXPECT_EQ(lines, 1u);
+    EXPECT_EQ(text, "FFFE  00 00     BRK #$00\n");
+}
+
+TEST_F(DisassemblerTests, TraceLinesCarryRegisters)
+{
+    mem[0x0200] = CPU::INS_LDA_IM;
+    mem[0x0201] = 0x42;
+    mem[0x0202] = CPU::INS_TAX;
+    cpu.reset(0x0200);
+
+    TraceRing trace(4);
+    cpu.execute(4, trace);
+
+    const std::string text = stream([&](DisassemblyWriter& writer) {
+        EXPECT_EQ(writer.write_trace(trace), 2u);
+    });
+    EXPECT_EQ(text,
+        "0200  A9 42     LDA #$42     A:00 X:00 Y:00 SP:FF PS:00 CY:4\n"
+        "0202  AA        TAX          A:42 X:00 Y:00 SP:FF PS:00 CY:2\n");
+}
@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+
+using namespace emulator6502;
+
+class DispatchTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    DispatchTests()
+        : cpu(CPU(mem))
+    {}
+
+    using Engine = ExecuteResult (CPU::*)(s32);
+
+    static constexpr s32 PROGRAM_CYCLES = 44;
+
+    void load_program()
+    {
+        const byte program[] = {
+            CPU::INS_LDX_IM,  0x03,
+            CPU::INS_LDY_IM,  0x81,
+            CPU::INS_LDA_IM,  0x0F,
+            CPU::INS_STA_ZPX, 0x10,
+            CPU::INS_AND_ZP,  0x13,
+            CPU::INS_EOR_IM,  0xF0,
+            CPU::INS_ORA_ABS, 0x00, 0x30,
+            CPU::INS_STA_AY,  0xF0, 0x20,
+            CPU::INS_PHA,
+            CPU::INS_PHP,
+            CPU::INS_JSR,     0x00, 0x40,
+        };
+        word address = 0xFF00;
+        for (byte b : program)
+        {
+            mem[address++] = b;
+        }
+        mem[0x3000] = 0x01;
+        mem[0x4000] = CPU::INS_TSX;
+        mem[0x4001] = CPU::INS_RTS;
+    }
+
+    struct Registers
+    {
+        word PC;
+        byte SP, A, X, Y, PS;
+    };
+
+    Registers run(Engine engine)
+    {
+        cpu.reset(0xFF00);
+        load_program();
+        EXPECT_EQ((cpu.*engine)(PROGRAM_CYCLES).cycles, PROGRAM_CYCLES);
+        return { cpu.PC, cpu.SP, cpu.A, cpu.X, cpu.Y, cpu.PS };
+    }
+};
+
+TEST_F(DispatchTests, EnginesAgree)
+{
+    Registers reference = run(&CPU::execute_switch);
+    EXPECT_EQ(reference.A, 0xFF);
+    EXPECT_EQ(reference.PC, 0xFF17);
+
+    const Engine engines[] = {
+        &CPU::execute,
+        &CPU::execute_table,
+    #if M6502_HAS_COMPUTED_GOTO
+        &CPU::execute_threaded,
+    #endif
+    };
+
+    for (Engine engine : engines)
+    {
+        Registers other = run(engine);
+        EXPECT_EQ(other.PC, reference.PC);
+        EXPECT_EQ(other.SP, reference.SP);
+        EXPECT_EQ(other.A, reference.A);
+        EXPECT_EQ(other.X, reference.X);
+        EXPECT_EQ(other.Y, reference.Y);
+        EXPECT_EQ(other.PS, reference.PS);
+        EXPECT_EQ(mem[0x2171], 0xFF);
+    }
+}
+
+TEST_F(DispatchTests, UnknownInstructionStops)
+{
+    const Engine engines[] = {
+        &CPU::execute_switch,
+        &CPU::execute_table,
+    #if M6502_HAS_COMPUTED_GOTO
+        &CPU::execute_threaded,
+    #endif
+    };
+
+    for (Engine engine : engines)
+    {
+        cpu.reset();
+        mem[0xFFFC] = CPU::INS_NOP;
+        mem[0xFFFD] = 0xFF;
+        const ExecuteResult result = (cpu.*engine)(10);
+        EXPECT_EQ(result.reason, StopReason::ILLEGAL_OPCODE);
+        EXPECT_EQ(result.cycles, 2 + 1);
+        EXPECT_EQ(result.PC, 0xFFFD);
+        EXPECT_EQ(result.opcode, 0xFF);
+        EXPECT_EQ(cpu.PC, 0xFFFD);
+    }
+}
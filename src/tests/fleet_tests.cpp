@@ -0,0 +1,178 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "fleet.h"
+
+#include <thread>
+#include <vector>
+
+using namespace emulator6502;
+
+class FleetTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    FleetTests()
+        : cpu(CPU(mem))
+    {}
+
+    // counts X up and stores it through A until the budget runs out
+    static FleetJob counting_job(byte start, s32 cycles)
+    {
+        FleetJob job;
+        job.image = {
+            CPU::INS_LDX_ZP,  0x10,
+            CPU::INS_TSX,
+            CPU::INS_LDA_ZP,  0x10,
+            CPU::INS_EOR_IM,  0x5A,
+            CPU::INS_STA_ZP,  0x10,
+            CPU::INS_PHA,
+            CPU::INS_JMP_ABS, 0x00, 0x02,
+        };
+        job.load_address = 0x0200;
+        job.PC = 0x0200;
+        job.A = start;
+        job.SP = start;
+        job.cycles = cycles;
+        job.capture = { { 0x0010, 1 }, { 0x0100, 0x100 } };
+        return job;
+    }
+
+    // the result of running the job on one CPU in a single execute
+    FleetResult reference(const FleetJob& job)
+    {
+        mem.init();
+        std::copy(job.image.begin(), job.image.end(), mem.data + job.load_address);
+        cpu.reset(job.PC);
+        cpu.SP = job.SP;
+        cpu.A = job.A;
+        cpu.X = job.X;
+        cpu.Y = job.Y;
+        cpu.PS = job.PS;
+
+        FleetResult result;
+        result.cycles_used = cpu.execute(job.cycles).cycles;
+        result.PC = cpu.PC;
+        result.SP = cpu.SP;
+        result.A = cpu.A;
+        result.X = cpu.X;
+        result.Y = cpu.Y;
+        result.PS = cpu.PS;
+        for (const FleetJob::Range& range : job.capture)
+        {
+            result.memory.insert(result.memory.end(), mem.data + range.start, mem.data + range.start + range.length);
+        }
+        return result;
+    }
+
+    void expect_same(const FleetResult& result, const FleetResult& expected, u32 job)
+    {
+        EXPECT_EQ(result.cycles_used, expected.cycles_used) << "job " << job;
+        EXPECT_EQ(result.PC, expected.PC) << "job " << job;
+        EXPECT_EQ(result.SP, expected.SP) << "job " << job;
+        EXPECT_EQ(result.A, expected.A) << "job " << job;
+        EXPECT_EQ(result.X, expected.X) << "job " << job;
+        EXPECT_EQ(result.Y, expected.Y) << "job " << job;
+        EXPECT_EQ(result.PS, expected.PS) << "job " << job;
+        EXPECT_EQ(result.memory, expected.memory) << "job " << job;
+        EXPECT_FALSE(result.failed) << "job " << job;
+        EXPECT_FALSE(result.cancelled) << "job " << job;
+    }
+};
+
+TEST_F(FleetTests, MatchesSingleCPU)
+{
+    // uneven budgets so threads run dry at different times and steal
+    std::vector<FleetJob> jobs;
+    for (u32 i = 0; i < 200; i++)
+    {
+        jobs.push_back(counting_job(i, 100 + (i * 37) % 5000));
+    }
+
+    // small slices, so jobs are split at many points
+    Fleet fleet(4, 7);
+    std::vector<FleetResult> results = fleet.run(jobs);
+    ASSERT_EQ(results.size(), jobs.size());
+    for (u32 i = 0; i < jobs.size(); i++)
+    {
+        expect_same(results[i], reference(jobs[i]), i);
+    }
+}
+
+TEST_F(FleetTests, SharedImage)
+{
+    const FleetJob original = counting_job(3, 2000);
+    std::vector<FleetJob> jobs(50, original);
+    for (FleetJob& job : jobs)
+    {
+        job.image.clear();
+        job.shared_image = original.image;
+    }
+
+    Fleet fleet(4);
+    std::vector<FleetResult> results = fleet.run(jobs);
+    ASSERT_EQ(results.size(), jobs.size());
+    const FleetResult expected = reference(original);
+    for (u32 i = 0; i < jobs.size(); i++)
+    {
+        expect_same(results[i], expected, i);
+    }
+}
+
+TEST_F(FleetTests, MoreThreadsThanJobs)
+{
+    std::vector<FleetJob> jobs = { counting_job(1, 300), counting_job(2, 400) };
+
+    Fleet fleet(16);
+    std::vector<FleetResult> results = fleet.run(jobs);
+    ASSERT_EQ(results.size(), 2u);
+    expect_same(results[0], reference(jobs[0]), 0);
+    expect_same(results[1], reference(jobs[1]), 1);
+
+    EXPECT_TRUE(fleet.run({}).empty());
+}
+
+TEST_F(FleetTests, UnknownInstructionFailsJob)
+{
+    FleetJob bad;
+    bad.image = { CPU::INS_LDA_IM, 0x11, 0xFF };
+    bad.load_address = 0x0300;
+    bad.PC = 0x0300;
+    bad.cycles = 100;
+
+    std::vector<FleetJob> jobs = { counting_job(1, 300), bad, counting_job(3, 300) };
+    Fleet fleet(2);
+    std::vector<FleetResult> results = fleet.run(jobs);
+
+    EXPECT_TRUE(results[1].failed);
+    EXPECT_EQ(results[1].reason, StopReason::ILLEGAL_OPCODE);
+    EXPECT_EQ(results[1].PC, 0x0302);
+    EXPECT_EQ(results[1].A, 0x11);
+    expect_same(results[0], reference(jobs[0]), 0);
+    expect_same(results[2], reference(jobs[2]), 2);
+}
+
+TEST_F(FleetTests, CancelStopsJobs)
+{
+    std::vector<FleetJob> jobs;
+    for (u32 i = 0; i < 8; i++)
+    {
+        jobs.push_back(counting_job(i, 2'000'000'000));
+    }
+
+    Fleet fleet(2, 1000);
+    std::thread canceller([&fleet]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        fleet.cancel();
+    });
+    std::vector<FleetResult> results = fleet.run(jobs);
+    canceller.join();
+
+    for (const FleetResult& result : results)
+    {
+        EXPECT_TRUE(result.cancelled);
+        EXPECT_LT(result.cycles_used, 2'000'000'000);
+    }
+}
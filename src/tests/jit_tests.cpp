@@ -0,0 +1,344 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "block_cache.h"
+
+#include <vector>
+
+using namespace emulator6502;
+
+#if M6502_HAS_JIT
+
+class JitTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    JitTests()
+        : cpu(CPU(mem))
+    {}
+
+    void load(word address, const std::vector<byte>& program)
+    {
+        for (byte b : program)
+        {
+            mem[address++] = b;
+        }
+    }
+
+    // runs the loaded program for every budget up to max_cycles, compiling
+    // every block, and compares the results with the interpreter
+    void expect_matches_interpreter(s32 max_cycles)
+    {
+        const Memory program = mem;
+        for (s32 budget = 1; budget <= max_cycles; budget++)
+        {
+            mem = program;
+            Memory reference_mem = program;
+            CPU reference(reference_mem);
+            reference.reset(0x0200);
+            cpu.reset(0x0200);
+
+            BlockCache cache(mem);
+            ASSERT_TRUE(cache.enable_jit(0));
+            s32 cycles = reference.execute_table(budget).cycles;
+            EXPECT_EQ(cpu.execute(budget, cache).cycles, cycles) << "budget " << budget;
+            EXPECT_EQ(cpu.PC, reference.PC) << "budget " << budget;
+            EXPECT_EQ(cpu.SP, reference.SP) << "budget " << budget;
+            EXPECT_EQ(cpu.A, reference.A) << "budget " << budget;
+            EXPECT_EQ(cpu.X, reference.X) << "budget " << budget;
+            EXPECT_EQ(cpu.Y, reference.Y) << "budget " << budget;
+            EXPECT_EQ(cpu.PS, reference.PS) << "budget " << budget;
+            EXPECT_EQ(memcmp(mem.data, reference_mem.data, Memory::MAX_MEMORY), 0) << "budget " << budget;
+        }
+    }
+};
+
+TEST_F(JitTests, MatchesInterpreter)
+{
+    load(0x0200, {
+        CPU::INS_LDX_IM,  0x03,
+        CPU::INS_LDY_IM,  0x81,
+        CPU::INS_LDA_IM,  0x0F,
+        CPU::INS_STA_ZPX, 0x10,
+        CPU::INS_AND_ZP,  0x13,
+        CPU::INS_EOR_IM,  0xF0,
+        CPU::INS_ORA_ABS, 0x00, 0x30,
+        CPU::INS_STA_AY,  0xF0, 0x20,
+        CPU::INS_LDA_IY,  0x20,
+        CPU::INS_PHA,
+        CPU::INS_PHP,
+        CPU::INS_PLP,
+        CPU::INS_PLA,
+        CPU::INS_JSR,     0x00, 0x40,
+        CPU::INS_JMP_I,   0x22, 0x00,
+    });
+    mem[0x3000] = 0x01;
+    mem[0x0022] = 0x00;
+    mem[0x0023] = 0x02;
+    mem[0x4000] = CPU::INS_TSX;
+    mem[0x4001] = CPU::INS_RTS;
+
+    expect_matches_interpreter(150);
+}
+
+TEST_F(JitTests, IndexedModesMatchInterpreter)
+{
+    // page crossing and zero page wrapping indexes, pointers at 0xFF
+    load(0x0200, {
+        CPU::INS_LDX_IM,  0xF0,
+        CPU::INS_LDY_IM,  0x20,
+        CPU::INS_LDA_AX,  0x20, 0x30,
+        CPU::INS_LDY_AX,  0x00, 0x30,
+        CPU::INS_LDX_AY,  0xF0, 0x30,
+        CPU::INS_EOR_ZPX, 0x20,
+        CPU::INS_LDX_ZPY, 0xFF,
+        CPU::INS_ORA_IX,  0xFE,
+        CPU::INS_AND_IY,  0xFF,
+        CPU::INS_STA_IX,  0x10,
+        CPU::INS_STA_IY,  0x10,
+        CPU::INS_STX_ZPY, 0x40,
+        CPU::INS_STY_ZPX, 0x40,
+        CPU::INS_STY_ABS, 0x00, 0x31,
+        CPU::INS_STX_ABS, 0x01, 0x31,
+        CPU::INS_TXS,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    for (word address = 0x3000; address < 0x3200; address++)
+    {
+        mem[address] = (byte)(address * 7);
+    }
+    mem[0x0010] = 0x80;
+    mem[0x00FF] = 0x42;
+    mem[0x0100] = 0x31;
+
+    expect_matches_interpreter(200);
+}
+
+TEST_F(JitTests, CompilesHotBlocks)
+{
+    load(0x0200, {
+        CPU::INS_LDA_IM,  0x01,
+        CPU::INS_EOR_IM,  0xFF,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    cpu.reset(0x0200);
+
+    BlockCache cache(mem);
+    ASSERT_TRUE(cache.enable_jit(3));
+    EXPECT_EQ(cpu.execute(7 * 3, cache).cycles, 7 * 3);
+    EXPECT_EQ(cache.compiled_blocks(), 0u);
+    EXPECT_EQ(cpu.execute(7 * 100, cache).cycles, 7 * 100);
+    EXPECT_EQ(cache.compiled_blocks(), 1u);
+    EXPECT_EQ(cpu.A, 0xFE);
+    EXPECT_EQ(cpu.PC, 0x0200);
+}
+
+TEST_F(JitTests, WriteToRunningBlock)
+{
+    // the store rewrites the operand of the LDX that follows it
+    load(0x0200, {
+        CPU::INS_LDA_IM,  0x05,
+        CPU::INS_STA_ABS, 0x06, 0x02,
+        CPU::INS_LDX_IM,  0x00,
+        CPU::INS_JMP_ABS, 0x07, 0x02,
+    });
+    cpu.reset(0x0200);
+
+    BlockCache cache(mem);
+    ASSERT_TRUE(cache.enable_jit(0));
+    cpu.execute(20, cache);
+    EXPECT_EQ(cpu.X, 0x05);
+    EXPECT_EQ(cache.invalidations(), 1u);
+
+    expect_matches_interpreter(40);
+}
+
+TEST_F(JitTests, WriteToOtherBlock)
+{
+    load(0x0200, {
+        CPU::INS_JSR,     0x00, 0x03,
+        CPU::INS_LDA_IM,  0x22,
+        CPU::INS_STA_ABS, 0x01, 0x03,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    load(0x0300, {
+        CPU::INS_LDA_IM,  0x11,
+        CPU::INS_STX_ZP,  0x40,
+        CPU::INS_RTS,
+    });
+
+    expect_matches_interpreter(80);
+}
+
+TEST_F(JitTests, InterpretedInstructionsMatchInterpreter)
+{
+    // native prefixes followed by instructions the JIT leaves to the
+    // interpreter, a pointer at the end of a page and a stack that wraps
+    load(0x0200, {
+        CPU::INS_LDX_IM,  0x00,
+        CPU::INS_TXS,
+        CPU::INS_LDX_IM,  0xFD,
+        CPU::INS_LDA_IM,  0x30,
+        CPU::INS_PHA,
+        CPU::INS_PHP,
+        CPU::INS_ADC_ZP,  0x10,
+        CPU::INS_STA_IY,  0x10,
+        CPU::INS_PLP,
+        CPU::INS_PLA,
+        CPU::INS_INX,
+        CPU::INS_BNE,     0xF3,
+        CPU::INS_JSR,     0x00, 0x03,
+        CPU::INS_JMP_I,   0xFF, 0x30,
+    });
+    load(0x0300, {
+        CPU::INS_LDA_IY,  0x10,
+        CPU::INS_TAY,
+        CPU::INS_ROL_A,
+        CPU::INS_RTS,
+    });
+    mem[0x0010] = 0xF0;
+    mem[0x0011] = 0x30;
+    mem[0x30FF] = 0x00;
+    mem[0x3000] = 0x02;
+
+    expect_matches_interpreter(300);
+}
+
+TEST_F(JitTests, CountedLoopCompilesWhole)
+{
+    // the loop body is one block, native up to and including the branch
+    load(0x0200, {
+        CPU::INS_LDX_IM,  0x00,
+        CPU::INS_LDA_AX,  0x00, 0x30,
+        CPU::INS_STA_AX,  0x00, 0x31,
+        CPU::INS_INX,
+        CPU::INS_BNE,     0xF7,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    for (word address = 0x3000; address < 0x3100; address++)
+    {
+        mem[address] = (byte)(address * 3);
+    }
+    cpu.reset(0x0200);
+
+    BlockCache cache(mem);
+    ASSERT_TRUE(cache.enable_jit(0));
+    cpu.execute(2 + 100 * 14, cache);
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.compiled_blocks(), 2u);
+    EXPECT_EQ(cpu.X, 100);
+    EXPECT_EQ(mem[0x3163], (byte)(0x3063 * 3));
+
+    expect_matches_interpreter(400);
+}
+
+TEST_F(JitTests, ArithmeticAndBranchesMatchInterpreter)
+{
+    // decimal and binary arithmetic, compares, transfers and flag changes,
+    // then a loop whose branches cross pages both ways
+    load(0x0200, {
+        CPU::INS_SED,
+        CPU::INS_LDA_IM,  0x19,
+        CPU::INS_CLC,
+        CPU::INS_ADC_IM,  0x28,
+        CPU::INS_SBC_ZP,  0x10,
+        CPU::INS_CLD,
+        CPU::INS_SEC,
+        CPU::INS_SBC_IM,  0x70,
+        CPU::INS_ADC_ABS, 0x00, 0x30,
+        CPU::INS_CMP_IM,  0x10,
+        CPU::INS_CPX_IM,  0x00,
+        CPU::INS_CPY_ABS, 0x01, 0x30,
+        CPU::INS_TAX,
+        CPU::INS_DEX,
+        CPU::INS_TXA,
+        CPU::INS_TAY,
+        CPU::INS_INY,
+        CPU::INS_TYA,
+        CPU::INS_CLV,
+        CPU::INS_SEI,
+        CPU::INS_CLI,
+        CPU::INS_BVS,     0x00,
+        CPU::INS_LDY_IM,  0x04,
+        CPU::INS_JMP_ABS, 0xF0, 0x02,
+    });
+    load(0x02F0, {
+        CPU::INS_DEY,
+        CPU::INS_CPY_IM,  0x01,
+        CPU::INS_BEQ,     0x10,
+        CPU::INS_BCS,     0xF9,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    load(0x0305, {
+        CPU::INS_LDY_IM,  0x05,
+        CPU::INS_ADC_IM,  0x81,
+        CPU::INS_BMI,     0x02,
+        CPU::INS_BPL,     0xE5,
+        CPU::INS_BNE,     0xE3,
+    });
+    mem[0x0010] = 0x05;
+    mem[0x3000] = 0x37;
+    mem[0x3001] = 0x22;
+
+    expect_matches_interpreter(400);
+}
+
+struct Counter
+{
+    u32 reads = 0;
+    u32 writes = 0;
+    byte last_value = 0;
+};
+
+TEST_F(JitTests, IOPagesUseHandlers)
+{
+    Counter counter;
+    Memory::IOHandler handler;
+    handler.read = [](void* context, word address) -> byte
+    {
+        static_cast<Counter*>(context)->reads++;
+        return address & 0xFF;
+    };
+    handler.write = [](void* context, word, byte value)
+    {
+        static_cast<Counter*>(context)->writes++;
+        static_cast<Counter*>(context)->last_value = value;
+    };
+    handler.context = &counter;
+    mem.map_io(0xD0, 0xD0, handler);
+
+    load(0x0200, {
+        CPU::INS_LDA_ABS, 0x42, 0xD0,
+        CPU::INS_STA_ABS, 0x01, 0xD0,
+        CPU::INS_JMP_ABS, 0x00, 0x02,
+    });
+    cpu.reset(0x0200);
+
+    BlockCache cache(mem);
+    ASSERT_TRUE(cache.enable_jit(0));
+    EXPECT_EQ(cpu.execute(11 * 10, cache).cycles, 11 * 10);
+    EXPECT_EQ(cache.compiled_blocks(), 1u);
+    EXPECT_EQ(counter.reads, 10u);
+    EXPECT_EQ(counter.writes, 10u);
+    EXPECT_EQ(counter.last_value, 0x42);
+}
+
+TEST_F(JitTests, UnknownInstructionStops)
+{
+    load(0x0200, {
+        CPU::INS_LDA_IM,  0x11,
+        0xFF,
+    });
+    cpu.reset(0x0200);
+
+    BlockCache cache(mem);
+    ASSERT_TRUE(cache.enable_jit(0));
+    const ExecuteResult result = cpu.execute(10, cache);
+    EXPECT_EQ(result.reason, StopReason::ILLEGAL_OPCODE);
+    EXPECT_EQ(result.cycles, 2 + 1);
+    EXPECT_EQ(result.PC, 0x0202);
+    EXPECT_EQ(cpu.A, 0x11);
+}
+
+#endif
@@ -26,7 +26,7 @@ TEST_F(JumpReturnTests, JSR_Basic)
     mem.write_word(0x4242, 0xFFFD);
     mem[0x4242] = CPU::INS_LDA_IM;
     mem[0x4243] = 0x84;
-    auto cycles_used = cpu.execute(8);
+    auto cycles_used = cpu.execute(8).cycles;
     EXPECT_EQ(cpu.A, 0x84);
     EXPECT_EQ(cycles_used, 8);
 }
@@ -39,7 +39,7 @@ TEST_F(JumpReturnTests, JSR_RTS)
     mem[0x4242] = CPU::INS_RTS;
     mem[0xFF03] = CPU::INS_LDA_IM;
     mem[0xFF04] = 0x42;
-    auto cycles_used = cpu.execute(14);
+    auto cycles_used = cpu.execute(14).cycles;
     EXPECT_EQ(cpu.A, 0x42);
     EXPECT_EQ(cycles_used, 14);
     EXPECT_EQ(cpu.SP, default_cpu_state.SP);
@@ -49,7 +49,7 @@ TEST_F(JumpReturnTests, JSR_PS_DEFAULT)
 {
     mem[0xFFFC] = CPU::INS_JSR;
     mem.write_word(0x4242, 0xFF01);
-    auto cycles_used = cpu.execute(6);
+    auto cycles_used = cpu.execute(6).cycles;
     EXPECT_EQ(cycles_used, 6);
     EXPECT_EQ(cpu.PS, default_cpu_state.PS);
 }
@@ -59,7 +59,7 @@ TEST_F(JumpReturnTests, RTS_PS_DEFAULT)
     mem[0xFFFC] = CPU::INS_JSR;
     mem.write_word(0x4242, 0xFFFD);
     mem[0x4242] = CPU::INS_RTS;
-    auto cycles_used = cpu.execute(12);
+    auto cycles_used = cpu.execute(12).cycles;
     EXPECT_EQ(cycles_used, 12);
     EXPECT_EQ(cpu.PS, default_cpu_state.PS);
 }
@@ -68,7 +68,7 @@ TEST_F(JumpReturnTests, JMP_ABS)
 {
     mem[0xFFFC] = CPU::INS_JMP_ABS;
     mem.write_word(0x4242, 0xFFFD);
-    auto cycles_used = cpu.execute(3);
+    auto cycles_used = cpu.execute(3).cycles;
     EXPECT_EQ(cpu.PC, 0x4242);
     EXPECT_EQ(cycles_used, 3);
     EXPECT_EQ(cpu.SP, default_cpu_state.SP);
@@ -79,8 +79,34 @@ TEST_F(JumpReturnTests, JMP_I)
     mem[0xFFFC] = CPU::INS_JMP_I;
     mem.write_word(0x4242, 0xFFFD);
     mem.write_word(0x2000, 0x4242);
-    auto cycles_used = cpu.execute(5);
+    auto cycles_used = cpu.execute(5).cycles;
     EXPECT_EQ(cpu.PC, 0x2000);
     EXPECT_EQ(cycles_used, 5);
     EXPECT_EQ(cpu.SP, default_cpu_state.SP);
-}
\ No newline at end of file
+}
+
+TEST_F(JumpReturnTests, JSR_STACK)
+{
+    // the return address - 1 is pushed high byte first
+    cpu.reset(0x0200);
+    mem[0x0200] = CPU::INS_JSR;
+    mem.write_word(0x4242, 0x0201);
+    auto cycles_used = cpu.execute(6).cycles;
+    EXPECT_EQ(cycles_used, 6);
+    EXPECT_EQ(mem[0x01FF], 0x02);
+    EXPECT_EQ(mem[0x01FE], 0x02);
+    EXPECT_EQ(cpu.SP, 0xFD);
+}
+
+TEST_F(JumpReturnTests, JMP_I_PAGE_WRAP)
+{
+    // the high byte of a pointer at the end of a page comes from its start
+    mem[0xFFFC] = CPU::INS_JMP_I;
+    mem.write_word(0x30FF, 0xFFFD);
+    mem[0x30FF] = 0x42;
+    mem[0x3000] = 0x20;
+    mem[0x3100] = 0x99;
+    auto cycles_used = cpu.execute(5).cycles;
+    EXPECT_EQ(cpu.PC, 0x2042);
+    EXPECT_EQ(cycles_used, 5);
+}
@@ -45,7 +45,7 @@ void LoadRegisterTests::test_load_register_im(byte opcode, byte CPU::*reg)
 {
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = 0x84;
-    s32 cycles_used = cpu.execute(2);
+    s32 cycles_used = cpu.execute(2).cycles;
     EXPECT_EQ(cpu.*reg, 0x84);
     EXPECT_EQ(cycles_used, 2);
     check_LD__unmodified_flags();
@@ -56,7 +56,7 @@ void LoadRegisterTests::test_load_register_zp(byte opcode, byte CPU::*reg)
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = 0x0F;
     mem[0x000F] = 0x0004;
-    auto cycles_used = cpu.execute(3);
+    auto cycles_used = cpu.execute(3).cycles;
     EXPECT_EQ(cpu.*reg, 0x0004);
     EXPECT_EQ(cycles_used, 3);
     check_LD__unmodified_flags();
@@ -68,7 +68,7 @@ void LoadRegisterTests::test_load_register_zpx(byte opcode, byte CPU::*reg)
     mem[0xFFFD] = 0x000F;
     mem[0x0010] = 0x0004;
     cpu.X = 0x1;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cpu.*reg, 0x0004);
     EXPECT_EQ(cycles_used, 4);
     check_LD__unmodified_flags();
@@ -90,7 +90,7 @@ void LoadRegisterTests::test_load_register_zpy(byte opcode, byte CPU::*reg)
     mem[0xFFFD] = 0x000F;
     mem[0x0010] = 0x0004;
     cpu.Y = 0x1;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cpu.*reg, 0x0004);
     EXPECT_EQ(cycles_used, 4);
     check_LD__unmodified_flags();
@@ -111,7 +111,7 @@ void LoadRegisterTests::test_load_register_abs(byte opcode, byte CPU::*reg)
     mem[0xFFFC] = opcode;
     mem.write_word(0xFFFF, 0xFFFD);
     mem[0xFFFF] = 0x42;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cpu.*reg, 0x42);
     EXPECT_EQ(cycles_used, 4);
 }
@@ -122,7 +122,7 @@ void LoadRegisterTests::test_load_register_ax(byte opcode, byte CPU::*reg)
     mem.write_word(0x4480, 0xFFFD);
     mem[0x4481] = 0x42;
     cpu.X = 1;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cpu.*reg, 0x42);
     EXPECT_EQ(cycles_used, 4);
 
@@ -134,7 +134,7 @@ void LoadRegisterTests::test_load_register_ax(byte opcode, byte CPU::*reg)
     mem[0x4501] = 0x42; // 0x4402 + 0xFF
     // force page cross
     cpu.X = 0xFF;
-    cycles_used = cpu.execute(5);
+    cycles_used = cpu.execute(5).cycles;
     EXPECT_EQ(cpu.*reg, 0x42);
     EXPECT_EQ(cycles_used, 5);
 }
@@ -145,7 +145,7 @@ void LoadRegisterTests::test_load_register_ay(byte opcode, byte CPU::*reg)
     mem.write_word(0x4480, 0xFFFD);
     mem[0x4481] = 0x42;
     cpu.Y = 1;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cpu.*reg, 0x42);
     EXPECT_EQ(cycles_used, 4);
 
@@ -157,7 +157,7 @@ void LoadRegisterTests::test_load_register_ay(byte opcode, byte CPU::*reg)
     mem[0x4501] = 0x42; // 0x4402 + 0xFF
     // force page cross
     cpu.Y = 0xFF;
-    cycles_used = cpu.execute(5);
+    cycles_used = cpu.execute(5).cycles;
     EXPECT_EQ(cpu.*reg, 0x42);
     EXPECT_EQ(cycles_used, 5);
 }
@@ -169,7 +169,7 @@ void LoadRegisterTests::test_load_register_ix(byte opcode, byte CPU::*reg)
     mem.write_word(0x8000, 0x0006);
     mem[0x8000] = 0x42;
     cpu.X = 0x4;
-    auto cycles_used = cpu.execute(6);
+    auto cycles_used = cpu.execute(6).cycles;
     EXPECT_EQ(cpu.*reg, 0x42);
     EXPECT_EQ(cycles_used, 6);
 }
@@ -178,10 +178,10 @@ void LoadRegisterTests::test_load_register_iy(byte opcode, byte CPU::*reg)
 {
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = 0x02;
-    mem.write_word(0x8000, 0x0006);
-    mem[0x8000] = 0x42;
+    mem.write_word(0x8000, 0x0002);
+    mem[0x8004] = 0x42;
     cpu.Y = 0x4;
-    auto cycles_used = cpu.execute(5);
+    auto cycles_used = cpu.execute(5).cycles;
     EXPECT_EQ(cpu.*reg, 0x42);
     EXPECT_EQ(cycles_used, 5);
 
@@ -190,10 +190,10 @@ void LoadRegisterTests::test_load_register_iy(byte opcode, byte CPU::*reg)
     // page cross check
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = 0x02;
-    mem.write_word(0x8000, 0x0001);
+    mem.write_word(0x7F01, 0x0002);
     mem[0x8000] = 0x42;
     cpu.Y = 0xFF;
-    cycles_used = cpu.execute(6);
+    cycles_used = cpu.execute(6).cycles;
     EXPECT_EQ(cpu.*reg, 0x42);
     EXPECT_EQ(cycles_used, 6);
 }
@@ -236,15 +236,31 @@ void LoadRegisterTests::test_load_register_flags(byte opcode)
 TEST_F(LoadRegisterTests, CPU_IDLE)
 {
     constexpr s32 NUM_CYCLES = 0;
-    auto cycles_used = cpu.execute(NUM_CYCLES);
+    auto cycles_used = cpu.execute(NUM_CYCLES).cycles;
     EXPECT_EQ(cycles_used, NUM_CYCLES);
 }
 
 TEST_F(LoadRegisterTests, UNKNOWN_INSTRUCTION)
 {
-    mem[0xFFFC] = 0x0; // invalid opcode
-    
-    EXPECT_THROW(cpu.execute(1), UnknownInstructionException);
+    mem[0xFFFC] = 0xFF; // invalid opcode
+
+    ExecuteResult result = cpu.execute(1);
+    EXPECT_EQ(result.reason, StopReason::ILLEGAL_OPCODE);
+    EXPECT_EQ(result.PC, 0xFFFC);
+    EXPECT_EQ(result.opcode, 0xFF);
+    EXPECT_EQ(cpu.PC, 0xFFFC);
+
+    // jam opcodes lock up the cpu
+    mem[0xFFFC] = 0x02;
+    result = cpu.execute(10);
+    EXPECT_EQ(result.reason, StopReason::HALT);
+    EXPECT_EQ(result.cycles, 1);
+    EXPECT_EQ(result.opcode, 0x02);
+
+    EXPECT_THROW(cpu.execute_checked(10), UnknownInstructionException);
+    cpu.reset();
+    mem[0xFFFC] = CPU::INS_NOP;
+    EXPECT_EQ(cpu.execute_checked(2), 2);
 }
 
 // makes sure the cpu can execute more cycles than given to complete the instruction
@@ -252,7 +268,7 @@ TEST_F(LoadRegisterTests, CPU_NOT_ENOUGH_CYCLES_CONT)
 {
     mem[0xFFFC] = CPU::INS_LDA_IM;
     mem[0xFFFD] = 0x0004;
-    auto cycles_used = cpu.execute(1);
+    auto cycles_used = cpu.execute(1).cycles;
     EXPECT_EQ(cycles_used, 2);
 }
 
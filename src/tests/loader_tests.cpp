@@ -0,0 +1,161 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "loader.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace emulator6502;
+
+class LoaderTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    LoaderTests()
+        : cpu(CPU(mem))
+    {}
+
+    static std::string write_file(const char* name, const void* contents, size_t size)
+    {
+        const std::string path = testing::TempDir() + name;
+        FILE* file = fopen(path.c_str(), "wb");
+        EXPECT_NE(file, nullptr);
+        EXPECT_EQ(fwrite(contents, 1, size, file), size);
+        fclose(file);
+        return path;
+    }
+
+    static std::string write_file(const char* name, const std::string& text)
+    {
+        return write_file(name, text.data(), text.size());
+    }
+};
+
+TEST_F(LoaderTests, RawAndPrg)
+{
+    const byte program[] = { CPU::INS_LDA_IM, 0x42, CPU::INS_STA_ZP, 0x10 };
+    mem.save_baseline();
+
+    LoadedImage loaded = load_file(mem, write_file("raw.bin", program, sizeof(program)).c_str(), 0x0800);
+    EXPECT_EQ(loaded.size, 4u);
+    EXPECT_EQ(loaded.address, 0x0800);
+    EXPECT_EQ(loaded.start, 0x0800);
+    EXPECT_EQ(mem[0x0801], 0x42);
+    EXPECT_EQ(mem[0x0803], 0x10);
+
+    const byte prg[] = { 0x01, 0x08, CPU::INS_LDA_IM, 0x43 };
+    loaded = load_file(mem, write_file("program.PRG", prg, sizeof(prg)).c_str());
+    EXPECT_EQ(loaded.size, 2u);
+    EXPECT_EQ(loaded.address, 0x0801);
+    EXPECT_EQ(mem[0x0801], CPU::INS_LDA_IM);
+    EXPECT_EQ(mem[0x0802], 0x43);
+
+    // loads mark their pages dirty like any other write
+    mem.restore_baseline();
+    EXPECT_EQ(mem[0x0801], 0x00);
+
+    // the end of memory cuts the image short
+    loaded = load_raw(mem, program, sizeof(program), 0xFFFE);
+    EXPECT_EQ(loaded.size, 2u);
+    EXPECT_EQ(mem[0xFFFF], 0x42);
+    EXPECT_EQ(mem[0x0000], 0x00);
+
+    EXPECT_EQ(load_prg(mem, prg, 1).size, 0u);
+    EXPECT_EQ(load_file(mem, (testing::TempDir() + "missing.bin").c_str()).size, 0u);
+}
+
+TEST_F(LoaderTests, IntelHex)
+{
+    const std::string hex =
+        ":020000040000FA\r\n"
+        ":0403000001020304EF\r\n"
+        ":02020000A9EA69\n"
+        "\n"
+        ":0400000500000200F5\n"
+        ":00000001FF\n"
+        ":01000000FF00\n"; // after the end of file, not loaded
+    LoadedImage loaded = load_file(mem, write_file("program.hex", hex).c_str());
+    EXPECT_EQ(loaded.size, 6u);
+    EXPECT_EQ(loaded.address, 0x0200);
+    EXPECT_EQ(loaded.start, 0x0200);
+    EXPECT_EQ(mem[0x0200], 0xA9);
+    EXPECT_EQ(mem[0x0201], 0xEA);
+    EXPECT_EQ(mem[0x0300], 0x01);
+    EXPECT_EQ(mem[0x0303], 0x04);
+    EXPECT_EQ(mem[0x0000], 0x00);
+    // the start record went into the reset vector
+    EXPECT_EQ(mem[0xFFFC], 0x00);
+    EXPECT_EQ(mem[0xFFFD], 0x02);
+
+    // bad checksum, bad digit, past the end of memory, unknown type
+    const char* malformed[] = {
+        ":0100000042BE\n",
+        ":01000000G200\n",
+        ":02FFFF000101FE\n",
+        ":00000006FA\n",
+        "0100000042BD\n",
+    };
+    for (const char* text : malformed)
+    {
+        EXPECT_EQ(load_hex(mem, text, (u32)strlen(text)).size, 0u) << text;
+    }
+    // the end of file record is optional
+    const char* unterminated = ":0100000042BD";
+    loaded = load_hex(mem, unterminated, (u32)strlen(unterminated));
+    EXPECT_EQ(loaded.size, 1u);
+    EXPECT_EQ(mem[0x0000], 0x42);
+}
+
+TEST_F(LoaderTests, IntelHexStartSetsResetVector)
+{
+    // CS:IP 0000:0340 in a type 03 record
+    const char* segment_start = ":02034000A9EA28\n:0400000300000340B6\n:00000001FF\n";
+    LoadedImage loaded = load_hex(mem, segment_start, (u32)strlen(segment_start));
+    ASSERT_EQ(loaded.size, 2u);
+    EXPECT_EQ(loaded.start, 0x0340);
+    EXPECT_EQ(mem[0xFFFC], 0x40);
+    EXPECT_EQ(mem[0xFFFD], 0x03);
+    cpu.reset(mem[0xFFFC] | mem[0xFFFD] << 8);
+    EXPECT_EQ(cpu.PC, 0x0340);
+
+    // without a start record the vector is left as it was
+    const char* no_start = ":02020000A9EA69\n:00000001FF\n";
+    loaded = load_hex(mem, no_start, (u32)strlen(no_start));
+    EXPECT_EQ(loaded.start, 0x0200);
+    EXPECT_EQ(mem[0xFFFC], 0x40);
+    EXPECT_EQ(mem[0xFFFD], 0x03);
+}
+
+TEST_F(LoaderTests, MapRomFile)
+{
+    std::vector<byte> rom(Memory::PAGE_SIZE + 44);
+    for (u32 i = 0; i < rom.size(); i++)
+    {
+        rom[i] = (byte)(i * 7);
+    }
+    MappedFile file(write_file("rom.bin", rom.data(), rom.size()).c_str());
+    ASSERT_EQ(file.size(), rom.size());
+
+    ASSERT_TRUE(map_rom_file(mem, file, 0xE0));
+    EXPECT_EQ(mem.read(0xE000), rom[0]);
+    EXPECT_EQ(mem.read(0xE105), rom[0x105]);
+    // past the end of the file, inside the last page
+    EXPECT_EQ(mem.read(0xE1FF), 0x00);
+    EXPECT_EQ(mem.read(0xE200), 0x00);
+
+    mem.write(0xE001, 0x99);
+    EXPECT_EQ(mem.read(0xE001), rom[1]);
+
+    // moves keep the mapping valid
+    MappedFile moved = std::move(file);
+    EXPECT_TRUE(file.empty());
+    EXPECT_EQ(mem.peek(0xE002), rom[2]);
+    EXPECT_EQ(moved.data()[2], rom[2]);
+
+    EXPECT_FALSE(map_rom_file(mem, moved, 0xFF));
+    EXPECT_FALSE(map_rom_file(mem, MappedFile(), 0x10));
+    mem.map_ram(0xE0, 0xE1);
+}
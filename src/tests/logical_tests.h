@@ -50,7 +50,7 @@ void LogicalTests::test_logical_im(byte opcode, const F& f)
     cpu.A = a_value;
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = memory_value;
-    auto cycles_used = cpu.execute(2);
+    auto cycles_used = cpu.execute(2).cycles;
     EXPECT_EQ(cycles_used, 2);
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     check_logical_unmodified_flags();
@@ -65,7 +65,7 @@ void LogicalTests::test_logical_zp(byte opcode, const F& f)
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = 0x0004;
     mem[0x0004] = memory_value;
-    auto cycles_used = cpu.execute(3);
+    auto cycles_used = cpu.execute(3).cycles;
     EXPECT_EQ(cycles_used, 3);
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     check_logical_unmodified_flags();
@@ -81,7 +81,7 @@ void LogicalTests::test_logical_zpx(byte opcode, const F& f)
     mem[0xFFFD] = 0x0004;
     cpu.X = 0x1;
     mem[0x0005] = memory_value;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cycles_used, 4);
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     check_logical_unmodified_flags();
@@ -94,7 +94,7 @@ void LogicalTests::test_logical_zpx(byte opcode, const F& f)
     mem[0xFFFD] = 0x0004;
     cpu.X = 0xFF;
     mem[0x0003] = memory_value;
-    cycles_used = cpu.execute(4);
+    cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cycles_used, 4);
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     check_logical_unmodified_flags();
@@ -109,7 +109,7 @@ void LogicalTests::test_logical_abs(byte opcode, const F& f)
     mem[0xFFFC] = opcode;
     mem.write_word(0xFFFF, 0xFFFD);
     mem[0xFFFF] = memory_value;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cycles_used, 4);
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     check_logical_unmodified_flags();
@@ -126,7 +126,7 @@ void LogicalTests::test_logical_ax(byte opcode, const F& f)
     mem.write_word(0x4480, 0xFFFD);
     mem[0x4481] = memory_value;
     cpu.X = 1;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     EXPECT_EQ(cycles_used, 4);
 
@@ -139,7 +139,7 @@ void LogicalTests::test_logical_ax(byte opcode, const F& f)
     mem[0x4501] = memory_value; // 0x4402 + 0xFF
     // force page cross
     cpu.X = 0xFF;
-    cycles_used = cpu.execute(5);
+    cycles_used = cpu.execute(5).cycles;
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     EXPECT_EQ(cycles_used, 5);
 }
@@ -155,7 +155,7 @@ void LogicalTests::test_logical_ay(byte opcode, const F& f)
     mem.write_word(0x4480, 0xFFFD);
     mem[0x4481] = memory_value;
     cpu.Y = 1;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     EXPECT_EQ(cycles_used, 4);
 
@@ -168,7 +168,7 @@ void LogicalTests::test_logical_ay(byte opcode, const F& f)
     mem[0x4501] = memory_value; // 0x4402 + 0xFF
     // force page cross
     cpu.Y = 0xFF;
-    cycles_used = cpu.execute(5);
+    cycles_used = cpu.execute(5).cycles;
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     EXPECT_EQ(cycles_used, 5);
 }
@@ -184,7 +184,7 @@ void LogicalTests::test_logical_ix(byte opcode, const F& f)
     mem.write_word(0x8000, 0x0006);
     mem[0x8000] = memory_value;
     cpu.X = 0x4;
-    auto cycles_used = cpu.execute(6);
+    auto cycles_used = cpu.execute(6).cycles;
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     EXPECT_EQ(cycles_used, 6);
 }
@@ -197,10 +197,10 @@ void LogicalTests::test_logical_iy(byte opcode, const F& f)
     cpu.A = a_value;
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = 0x02;
-    mem.write_word(0x8000, 0x0006);
-    mem[0x8000] = memory_value;
+    mem.write_word(0x8000, 0x0002);
+    mem[0x8004] = memory_value;
     cpu.Y = 0x4;
-    auto cycles_used = cpu.execute(5);
+    auto cycles_used = cpu.execute(5).cycles;
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     EXPECT_EQ(cycles_used, 5);
 
@@ -210,10 +210,10 @@ void LogicalTests::test_logical_iy(byte opcode, const F& f)
     cpu.A = a_value;
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = 0x02;
-    mem.write_word(0x8000, 0x0001);
+    mem.write_word(0x7F01, 0x0002);
     mem[0x8000] = memory_value;
     cpu.Y = 0xFF;
-    cycles_used = cpu.execute(6);
+    cycles_used = cpu.execute(6).cycles;
     EXPECT_EQ(f(a_value, memory_value), cpu.A);
     EXPECT_EQ(cycles_used, 6);
 }
@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+
+using namespace emulator6502;
+
+class MemoryBusTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    MemoryBusTests()
+        : cpu(CPU(mem))
+    {}
+
+    virtual void SetUp()
+    {
+        cpu.reset();
+    }
+
+    // simple device: reads return the low address byte, writes are recorded
+    struct Device
+    {
+        word last_address = 0;
+        byte last_value = 0;
+        u32 reads = 0;
+        u32 writes = 0;
+    };
+
+    static Memory::IOHandler device_handler(Device& device)
+    {
+        Memory::IOHandler handler;
+        handler.read = [](void* context, word address) -> byte
+        {
+            static_cast<Device*>(context)->reads++;
+            return address & 0xFF;
+        };
+        handler.write = [](void* context, word address, byte value)
+        {
+            Device* device = static_cast<Device*>(context);
+            device->writes++;
+            device->last_address = address;
+            device->last_value = value;
+        };
+        handler.context = &device;
+        return handler;
+    }
+};
+
+TEST_F(MemoryBusTests, RAM_ReadWrite)
+{
+    mem.write(0x1234, 0x42);
+    EXPECT_EQ(mem.read(0x1234), 0x42);
+    EXPECT_EQ(mem[0x1234], 0x42);
+}
+
+TEST_F(MemoryBusTests, ROM_IgnoresWrites)
+{
+    mem[0xF000] = 0x42;
+    mem.map_rom(0xF0, 0xFF);
+    mem.write(0xF000, 0x11);
+    EXPECT_EQ(mem.read(0xF000), 0x42);
+}
+
+TEST_F(MemoryBusTests, ROM_ExternalImage)
+{
+    byte image[Memory::PAGE_SIZE * 2] = {};
+    image[0x101] = 0x42;
+    mem.map_rom(0x80, 0x81, image);
+    EXPECT_EQ(mem.read(0x8101), 0x42);
+    EXPECT_EQ(mem.peek(0x8101), 0x42);
+}
+
+TEST_F(MemoryBusTests, IO_HandlersCalled)
+{
+    Device device;
+    mem.map_io(0xD0, 0xD0, device_handler(device));
+
+    EXPECT_EQ(mem.read(0xD012), 0x12);
+    mem.write(0xD020, 0x07);
+    EXPECT_EQ(device.reads, 1u);
+    EXPECT_EQ(device.writes, 1u);
+    EXPECT_EQ(device.last_address, 0xD020);
+    EXPECT_EQ(device.last_value, 0x07);
+
+    // neighbouring pages are still RAM
+    mem.write(0xD100, 0x33);
+    EXPECT_EQ(mem.read(0xD100), 0x33);
+    EXPECT_EQ(device.writes, 1u);
+}
+
+TEST_F(MemoryBusTests, IO_FromCPU)
+{
+    Device device;
+    mem.map_io(0xD0, 0xD0, device_handler(device));
+
+    cpu.reset(0x0200);
+    mem[0x0200] = CPU::INS_LDA_ABS;
+    mem.write_word(0xD042, 0x0201);
+    mem[0x0203] = CPU::INS_STA_ABS;
+    mem.write_word(0xD001, 0x0204);
+
+    auto cycles_used = cpu.execute(8).cycles;
+    EXPECT_EQ(cycles_used, 8);
+    EXPECT_EQ(cpu.A, 0x42);
+    EXPECT_EQ(device.writes, 1u);
+    EXPECT_EQ(device.last_address, 0xD001);
+    EXPECT_EQ(device.last_value, 0x42);
+}
+
+TEST_F(MemoryBusTests, CopyRebasesPages)
+{
+    mem.map_rom(0xF0, 0xFF);
+    mem[0xF000] = 0x42;
+    Memory copy = mem;
+    mem[0xF000] = 0x11;
+
+    EXPECT_EQ(copy.read(0xF000), 0x42);
+    copy.write(0x0010, 0x22);
+    EXPECT_EQ(copy.read(0x0010), 0x22);
+    EXPECT_NE(mem.read(0x0010), 0x22);
+}
@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "opcodes.h"
+
+using namespace emulator6502;
+
+class OpcodesTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    OpcodesTests()
+        : cpu(CPU(mem))
+    {}
+
+    // runs opcode alone from start, operand bytes 0x01 0x03 and the zero
+    // page pointer at 0x01 both give 0x0301
+    ExecuteResult run_one(byte opcode, word start, byte index)
+    {
+        mem = Memory();
+        mem[start] = opcode;
+        mem[start + 1] = 0x01;
+        mem[start + 2] = 0x03;
+        mem[0x0001] = 0x01;
+        mem[0x0002] = 0x03;
+        cpu.reset(start);
+        cpu.X = index;
+        cpu.Y = index;
+        return cpu.execute<CycleExact>(1);
+    }
+};
+
+TEST_F(OpcodesTests, LengthFollowsMode)
+{
+    u32 implemented = 0;
+    for (u32 opcode = 0; opcode < 256; opcode++)
+    {
+        const OpInfo& info = opcode_info[opcode];
+        EXPECT_EQ(info.length, instruction_length(info.mode)) << "opcode " << opcode;
+        implemented += info.implemented();
+    }
+    EXPECT_EQ(implemented, 151u);
+}
+
+TEST_F(OpcodesTests, CycleExactMatchesOpcodeInfo)
+{
+    // no page is crossed with X = Y = 0, branches are taken when their flag
+    // is clear since PS starts out zero
+    for (u32 opcode = 0; opcode < 256; opcode++)
+    {
+        const OpInfo& info = opcode_info[opcode];
+        const ExecuteResult result = run_one(opcode, 0x0200, 0x00);
+        if (!info.implemented())
+        {
+            EXPECT_NE(result.reason, StopReason::BUDGET) << "opcode " << opcode;
+            continue;
+        }
+
+        ASSERT_EQ(result.reason, StopReason::BUDGET) << "opcode " << opcode;
+        const bool taken = info.mode == AddressMode::RELATIVE && cpu.PC != 0x0202;
+        EXPECT_EQ(result.cycles, info.cycles + taken) << info.mnemonic << " opcode " << opcode;
+        if (!info.sets_pc)
+        {
+            EXPECT_EQ(cpu.PC, 0x0200 + info.length) << info.mnemonic << " opcode " << opcode;
+        }
+    }
+}
+
+TEST_F(OpcodesTests, PagePenaltyMatchesCycleExact)
+{
+    for (u32 opcode = 0; opcode < 256; opcode++)
+    {
+        const OpInfo& info = opcode_info[opcode];
+        if (info.mode != AddressMode::ABSOLUTE_X && info.mode != AddressMode::ABSOLUTE_Y
+            && info.mode != AddressMode::INDIRECT_Y) continue;
+
+        // 0x0301 + 0xFF is on the next page
+        const ExecuteResult result = run_one(opcode, 0x0200, 0xFF);
+        EXPECT_EQ(result.cycles, info.cycles + info.page_penalty) << info.mnemonic << " opcode " << opcode;
+    }
+}
+
+TEST_F(OpcodesTests, BranchPagePenaltyMatchesCycleExact)
+{
+    for (u32 opcode = 0; opcode < 256; opcode++)
+    {
+        const OpInfo& info = opcode_info[opcode];
+        if (info.mode != AddressMode::RELATIVE) continue;
+
+        // taken, from 0x02F2 to the next page
+        mem = Memory();
+        mem[0x02F0] = opcode;
+        mem[0x02F1] = 0x20;
+        cpu.reset(0x02F0);
+        const ExecuteResult result = cpu.execute<CycleExact>(1);
+        if (cpu.PC == 0x02F2) continue;
+
+        EXPECT_EQ(cpu.PC, 0x0312);
+        EXPECT_EQ(result.cycles, info.cycles + 1 + info.page_penalty) << info.mnemonic;
+    }
+}
@@ -0,0 +1,158 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "profiler.h"
+
+#include <string>
+#include <vector>
+
+using namespace emulator6502;
+
+class ProfilerTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    ProfilerTests()
+        : cpu(CPU(mem))
+    {}
+
+    void load(word address, const std::vector<byte>& program)
+    {
+        for (byte b : program)
+        {
+            mem[address++] = b;
+        }
+    }
+
+    // calls 0x0300, which calls 0x0310, then calls 0x0310 directly
+    void load_calls()
+    {
+        load(0x0200, {
+            CPU::INS_JSR, 0x00, 0x03,           // 0x0200
+            CPU::INS_JSR, 0x10, 0x03,           // 0x0203
+            0xFF,                               // 0x0206
+        });
+        load(0x0300, {
+            CPU::INS_JSR, 0x10, 0x03,           // 0x0300
+            CPU::INS_RTS,                       // 0x0303
+        });
+        load(0x0310, {
+            CPU::INS_INX,                       // 0x0310
+            CPU::INS_RTS,                       // 0x0311
+        });
+        cpu.reset(0x0200);
+    }
+
+    template<typename Write>
+    static std::string output(const Profiler& profiler, Write write)
+    {
+        FILE* file = tmpfile();
+        (profiler.*write)(file);
+        std::string text(ftell(file), '\0');
+        rewind(file);
+        EXPECT_EQ(fread(text.data(), 1, text.size(), file), text.size());
+        fclose(file);
+        return text;
+    }
+};
+
+TEST_F(ProfilerTests, CallGraph)
+{
+    load_calls();
+    Profiler profiler;
+    ExecuteResult result = cpu.execute(1000, profiler);
+    EXPECT_EQ(result.reason, StopReason::ILLEGAL_OPCODE);
+    EXPECT_EQ(result.cycles, 6 + 6 + 2 + 6 + 6 + 6 + 2 + 6 + 1);
+
+    EXPECT_EQ(profiler.instructions_at(0x0310), 2u);
+    EXPECT_EQ(profiler.cycles_at(0x0310), 4u);
+    EXPECT_EQ(profiler.cycles_at(0x0311), 12u);
+    EXPECT_EQ(profiler.instructions_at(0x0206), 1u);
+    EXPECT_EQ(profiler.cycles_at(0x0206), 1u);
+    EXPECT_EQ(profiler.instructions_at(0x0207), 0u);
+
+    std::vector<Profiler::Subroutine> subroutines = profiler.subroutines();
+    ASSERT_EQ(subroutines.size(), 2u);
+    EXPECT_EQ(subroutines[0].address, 0x0300);
+    EXPECT_EQ(subroutines[0].calls, 1u);
+    EXPECT_EQ(subroutines[0].inclusive_cycles, 6u + 6 + 2 + 6);
+    EXPECT_EQ(subroutines[0].exclusive_cycles, 6u + 6);
+    EXPECT_EQ(subroutines[1].address, 0x0310);
+    EXPECT_EQ(subroutines[1].calls, 2u);
+    EXPECT_EQ(subroutines[1].inclusive_cycles, 2u * (2 + 6));
+    EXPECT_EQ(subroutines[1].exclusive_cycles, 2u * (2 + 6));
+
+    EXPECT_EQ(output(profiler, &Profiler::write_collapsed),
+        "0x0200 13\n"
+        "0x0200;0x0300 12\n"
+        "0x0200;0x0300;0x0310 8\n"
+        "0x0200;0x0310 8\n");
+    EXPECT_EQ(output(profiler, &Profiler::write_hits),
+        "0x0200 1 6\n"
+        "0x0203 1 6\n"
+        "0x0206 1 1\n"
+        "0x0300 1 6\n"
+        "0x0303 1 6\n"
+        "0x0310 2 4\n"
+        "0x0311 2 12\n");
+
+    profiler.clear();
+    EXPECT_EQ(profiler.instructions_at(0x0310), 0u);
+    EXPECT_TRUE(profiler.subroutines().empty());
+    EXPECT_EQ(output(profiler, &Profiler::write_collapsed), "");
+}
+
+TEST_F(ProfilerTests, RecursionCountsInclusiveOnce)
+{
+    // 0x0300 calls itself until X reaches 0
+    load(0x0200, {
+        CPU::INS_LDX_IM, 0x02,                  // 0x0200
+        CPU::INS_JSR, 0x00, 0x03,               // 0x0202
+        0xFF,                                   // 0x0205
+    });
+    load(0x0300, {
+        CPU::INS_DEX,                           // 0x0300
+        CPU::INS_BEQ, 0x04,                     // 0x0301
+        CPU::INS_JSR, 0x00, 0x03,               // 0x0303
+        CPU::INS_RTS,                           // 0x0306
+        CPU::INS_RTS,                           // 0x0307
+    });
+    cpu.reset(0x0200);
+
+    Profiler profiler;
+    EXPECT_EQ(cpu.execute(1000, profiler).reason, StopReason::ILLEGAL_OPCODE);
+
+    std::vector<Profiler::Subroutine> subroutines = profiler.subroutines();
+    ASSERT_EQ(subroutines.size(), 1u);
+    EXPECT_EQ(subroutines[0].calls, 2u);
+    EXPECT_EQ(subroutines[0].exclusive_cycles, (2u + 2 + 6 + 6) + (2 + 3 + 6));
+    EXPECT_EQ(subroutines[0].inclusive_cycles, subroutines[0].exclusive_cycles);
+    EXPECT_EQ(output(profiler, &Profiler::write_collapsed),
+        "0x0200 9\n"
+        "0x0200;0x0300 16\n"
+        "0x0200;0x0300;0x0300 11\n");
+}
+
+TEST_F(ProfilerTests, SlicedRunsMatchOneRun)
+{
+    load_calls();
+    Profiler whole;
+    cpu.execute(1000, whole);
+
+    // every slice ends on a different instruction, the counts carry over
+    load_calls();
+    Profiler sliced;
+    while (cpu.execute(1, sliced).reason == StopReason::BUDGET)
+    {
+    }
+    EXPECT_EQ(output(sliced, &Profiler::write_collapsed), output(whole, &Profiler::write_collapsed));
+    EXPECT_EQ(output(sliced, &Profiler::write_hits), output(whole, &Profiler::write_hits));
+
+    // an RTS with no call to return from stays at the bottom
+    mem[0x0206] = CPU::INS_RTS;
+    cpu.SP = 0xFD;
+    cpu.execute(6, sliced);
+    EXPECT_EQ(sliced.subroutines().size(), 2u);
+    EXPECT_EQ(output(sliced, &Profiler::write_collapsed).substr(0, 11), "0x0200 19\n0");
+}
@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "replay.h"
+
+using namespace emulator6502;
+
+class ReplayTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+    Memory replay_mem;
+    CPU replay_cpu;
+
+    ReplayTests()
+        : cpu(CPU(mem)), replay_cpu(CPU(replay_mem))
+    {}
+
+    // adds what the device at 0xD000 reads, and 0x0011, to 0x0010 forever
+    static void load_program(Memory& mem, CPU& cpu)
+    {
+        const byte program[] = {
+            CPU::INS_LDA_ABS, 0x00, 0xD0,
+            CPU::INS_CLC,
+            CPU::INS_ADC_ZP,  0x10,
+            CPU::INS_ADC_ZP,  0x11,
+            CPU::INS_STA_ZP,  0x10,
+            CPU::INS_JMP_ABS, 0x00, 0x02,
+        };
+        mem.load(0x0200, program, sizeof(program));
+        cpu.reset(0x0200);
+    }
+
+    // a device whose reads differ from run to run
+    static Memory::IOHandler device(u32& state)
+    {
+        Memory::IOHandler handler;
+        handler.read = [](void* context, word) -> byte
+        {
+            u32& state = *static_cast<u32*>(context);
+            state = state * 1103515245 + 12345;
+            return state >> 16;
+        };
+        handler.context = &state;
+        return handler;
+    }
+
+    // records slices of 100 cycles, injecting a write every tenth
+    std::vector<byte> record(u32 slices)
+    {
+        u32 seed = 1;
+        load_program(mem, cpu);
+        InputRecorder recorder(cpu, mem);
+        mem.map_io(0xD0, 0xD0, recorder.wrap(device(seed)));
+        for (u32 i = 0; i < slices; i++)
+        {
+            if (i % 10 == 0) recorder.inject(0x0011, i);
+            recorder.execute(100);
+        }
+        recorded_cycles = recorder.cycles();
+        return recorder.log();
+    }
+
+    // replays log in slices of a different size than the recording
+    void replay(InputReplayer& replayer, u64 cycles)
+    {
+        while (replayer.cycles() < cycles)
+        {
+            replayer.execute((s32)std::min<u64>(333, cycles - replayer.cycles()));
+        }
+    }
+
+    u64 recorded_cycles = 0;
+};
+
+TEST_F(ReplayTests, ReplayReachesTheRecordedState)
+{
+    const std::vector<byte> log = record(100);
+
+    u32 other_seed = 99;
+    load_program(replay_mem, replay_cpu);
+    InputReplayer replayer(replay_cpu, replay_mem, log.data(), log.size());
+    replay_mem.map_io(0xD0, 0xD0, replayer.wrap(device(other_seed)));
+    ASSERT_TRUE(replayer.valid());
+    replay(replayer, recorded_cycles);
+
+    EXPECT_TRUE(replayer.finished());
+    EXPECT_TRUE(replayer.in_sync());
+    EXPECT_EQ(replayer.cycles(), recorded_cycles);
+    EXPECT_EQ(replay_cpu.PC, cpu.PC);
+    EXPECT_EQ(replay_cpu.A, cpu.A);
+    EXPECT_EQ(replay_cpu.PS, cpu.PS);
+    EXPECT_EQ(replay_mem[0x0010], mem[0x0010]);
+    EXPECT_EQ(replay_mem[0x0011], mem[0x0011]);
+    // the device was never read
+    EXPECT_EQ(other_seed, 99u);
+}
+
+TEST_F(ReplayTests, LogGrowsWithInputNotInstructions)
+{
+    const byte loop[] = { CPU::INS_JMP_ABS, 0x00, 0x02 };
+    mem.load(0x0200, loop, sizeof(loop));
+    cpu.reset(0x0200);
+
+    InputRecorder recorder(cpu, mem);
+    recorder.execute(1'000'000);
+    EXPECT_EQ(recorder.log().size(), sizeof(input_log::MAGIC));
+
+    // a varint of the cycles since the start, address and value
+    recorder.inject(0x0011, 0x42);
+    EXPECT_EQ(recorder.log().size(), sizeof(input_log::MAGIC) + 3 + 3);
+}
+
+TEST_F(ReplayTests, DivergedRunIsOutOfSync)
+{
+    const std::vector<byte> log = record(20);
+
+    // an extra NOP in front moves every read by two cycles
+    u32 seed = 1;
+    load_program(replay_mem, replay_cpu);
+    replay_mem[0x01FF] = CPU::INS_NOP;
+    replay_cpu.reset(0x01FF);
+    InputReplayer replayer(replay_cpu, replay_mem, log.data(), log.size());
+    replay_mem.map_io(0xD0, 0xD0, replayer.wrap(device(seed)));
+    replay(replayer, recorded_cycles);
+
+    EXPECT_FALSE(replayer.in_sync());
+}
+
+TEST_F(ReplayTests, TruncatedLogEndsAtLastWholeEvent)
+{
+    std::vector<byte> log = record(20);
+    log.pop_back();
+
+    u32 seed = 1;
+    load_program(replay_mem, replay_cpu);
+    InputReplayer replayer(replay_cpu, replay_mem, log.data(), log.size());
+    replay_mem.map_io(0xD0, 0xD0, replayer.wrap(device(seed)));
+    replay(replayer, recorded_cycles);
+
+    EXPECT_TRUE(replayer.finished());
+    // the last read found nothing to replay
+    EXPECT_FALSE(replayer.in_sync());
+}
+
+TEST_F(ReplayTests, LogWithoutHeaderIsInvalid)
+{
+    const byte log[] = { 'n', 'o', 't', ' ', 'a', ' ', 'l', 'o', 'g' };
+    InputReplayer replayer(replay_cpu, replay_mem, log, sizeof(log));
+    EXPECT_FALSE(replayer.valid());
+    EXPECT_TRUE(replayer.finished());
+}
@@ -0,0 +1,98 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+
+using namespace emulator6502;
+
+class ResetTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    ResetTests()
+        : cpu(CPU(mem))
+    {}
+
+    virtual void SetUp()
+    {
+        cpu.reset();
+    }
+};
+
+TEST_F(ResetTests, ResetKeepsMemory)
+{
+    mem[0x4242] = 0x42;
+    cpu.A = 0x11;
+    cpu.SP = 0x10;
+    cpu.reset(0x1000);
+    EXPECT_EQ(mem[0x4242], 0x42);
+    EXPECT_EQ(cpu.PC, 0x1000);
+    EXPECT_EQ(cpu.SP, 0xFF);
+    EXPECT_EQ(cpu.A, 0x00);
+}
+
+TEST_F(ResetTests, ResetClearsMemoryOnRequest)
+{
+    mem[0x4242] = 0x42;
+    cpu.reset(0xFFFC, true);
+    EXPECT_EQ(mem[0x4242], 0x00);
+}
+
+TEST_F(ResetTests, RestoreBaseline)
+{
+    mem[0x0200] = CPU::INS_STA_ZP;
+    mem[0x0201] = 0x10;
+    mem[0x0202] = CPU::INS_STA_ABS;
+    mem.write_word(0x4000, 0x0203);
+    mem[0x0010] = 0x99;
+    mem.save_baseline();
+
+    cpu.reset(0x0200);
+    cpu.A = 0x42;
+    cpu.execute(7);
+    mem[0x8000] = 0x55;
+    EXPECT_EQ(mem[0x0010], 0x42);
+    EXPECT_EQ(mem[0x4000], 0x42);
+
+    mem.restore_baseline();
+    EXPECT_EQ(mem[0x0010], 0x99);
+    EXPECT_EQ(mem[0x4000], 0x00);
+    EXPECT_EQ(mem[0x8000], 0x00);
+    EXPECT_EQ(mem[0x0200], CPU::INS_STA_ZP);
+
+    // the baseline can be restored again
+    cpu.reset(0x0200);
+    cpu.A = 0x24;
+    cpu.execute(7);
+    mem.restore_baseline();
+    EXPECT_EQ(mem[0x0010], 0x99);
+    EXPECT_EQ(mem[0x4000], 0x00);
+}
+
+TEST_F(ResetTests, RestoreBaselineAfterInit)
+{
+    mem[0x1234] = 0x42;
+    mem.save_baseline();
+    mem.init();
+    mem.restore_baseline();
+    EXPECT_EQ(mem[0x1234], 0x42);
+}
+
+TEST_F(ResetTests, DirtyPagesSinceBaseline)
+{
+    if (!Memory::TRACK_DIRTY_PAGES) GTEST_SKIP();
+    mem.save_baseline();
+    EXPECT_FALSE(mem.is_dirty(0x00));
+
+    cpu.reset(0x0200);
+    mem[0x0200] = CPU::INS_STA_ZP;
+    mem[0x0201] = 0x10;
+    cpu.execute(3);
+    EXPECT_TRUE(mem.is_dirty(0x00));
+    EXPECT_TRUE(mem.is_dirty(0x02));
+    EXPECT_FALSE(mem.is_dirty(0x01));
+
+    mem.restore_baseline();
+    EXPECT_FALSE(mem.is_dirty(0x00));
+    EXPECT_FALSE(mem.is_dirty(0x02));
+}
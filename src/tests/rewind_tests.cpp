@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "rewind.h"
+
+#include <cstring>
+
+using namespace emulator6502;
+
+class RewindTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+    Memory reference_mem;
+    CPU reference;
+
+    RewindTests()
+        : cpu(CPU(mem)), reference(CPU(reference_mem))
+    {}
+
+    virtual void SetUp()
+    {
+        load_program(mem, cpu);
+    }
+
+    // fills a page with X, then moves its own store on to the next page
+    static void load_program(Memory& mem, CPU& cpu)
+    {
+        const byte program[] = {
+            CPU::INS_INX,
+            CPU::INS_STA_AX,  0x00, 0x30,
+            CPU::INS_BNE,     0xFA,
+            CPU::INS_INC_ABS, 0x03, 0x02,
+            CPU::INS_ADC_IM,  0x01,
+            CPU::INS_JMP_ABS, 0x00, 0x02,
+        };
+        mem.load(0x0200, program, sizeof(program));
+        cpu.reset(0x0200);
+    }
+
+    // the state of a straight run at the first instruction boundary at or
+    // after cycle
+    void run_reference(u64 cycle)
+    {
+        reference_mem.init();
+        load_program(reference_mem, reference);
+        reference.execute((s32)cycle);
+    }
+
+    void expect_reference_state()
+    {
+        EXPECT_EQ(cpu.PC, reference.PC);
+        EXPECT_EQ(cpu.A, reference.A);
+        EXPECT_EQ(cpu.X, reference.X);
+        EXPECT_EQ(cpu.SP, reference.SP);
+        EXPECT_EQ(cpu.PS, reference.PS);
+        EXPECT_EQ(memcmp(mem.data, reference_mem.data, Memory::MAX_MEMORY), 0);
+    }
+};
+
+TEST_F(RewindTests, RewindMatchesStraightRun)
+{
+    RewindBuffer rewind(cpu, mem, { 4096, 1 << 20 });
+    rewind.execute(200'000);
+    EXPECT_GT(rewind.checkpoints(), 40u);
+
+    for (u64 cycle : { 150'001u, 100'000u, 12'345u, 0u })
+    {
+        ASSERT_TRUE(rewind.rewind(cycle));
+        run_reference(cycle);
+        expect_reference_state();
+    }
+}
+
+TEST_F(RewindTests, RunContinuesAfterRewind)
+{
+    RewindBuffer rewind(cpu, mem, { 4096, 1 << 20 });
+    rewind.execute(200'000);
+    ASSERT_TRUE(rewind.rewind(50'000));
+    rewind.execute(100'000);
+
+    run_reference(rewind.cycles());
+    expect_reference_state();
+}
+
+TEST_F(RewindTests, CheckpointsHoldChangedPagesOnly)
+{
+    // the store moves on a page every 2560 cycles, so a checkpoint holds
+    // the code page and one or two pages of stores instead of all 256
+    RewindBuffer rewind(cpu, mem, { 4096, 1 << 20 });
+    rewind.execute(100'000);
+    EXPECT_LT(rewind.bytes_used(), rewind.checkpoints() * 4 * (Memory::PAGE_SIZE + 1));
+}
+
+TEST_F(RewindTests, BudgetDropsOldestCheckpoints)
+{
+    RewindBuffer rewind(cpu, mem, { 4096, 8 * 1024 });
+    rewind.execute(200'000);
+
+    EXPECT_LE(rewind.bytes_used(), 8u * 1024);
+    EXPECT_GT(rewind.oldest_cycle(), 0u);
+    EXPECT_FALSE(rewind.rewind(0));
+
+    const u64 cycle = rewind.oldest_cycle() + 100;
+    ASSERT_TRUE(rewind.rewind(cycle));
+    run_reference(cycle);
+    expect_reference_state();
+}
+
+TEST_F(RewindTests, FutureCycleIsRefused)
+{
+    RewindBuffer rewind(cpu, mem);
+    rewind.execute(1000);
+    const word pc = cpu.PC;
+    EXPECT_FALSE(rewind.rewind(rewind.cycles() + 1));
+    EXPECT_EQ(cpu.PC, pc);
+}
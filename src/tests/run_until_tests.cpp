@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "breakpoints.h"
+
+using namespace emulator6502;
+
+class RunUntilTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    RunUntilTests()
+        : cpu(CPU(mem))
+    {}
+
+    // counts X up forever, 2 + 3 cycles per iteration
+    virtual void SetUp()
+    {
+        const byte program[] = {
+            CPU::INS_INX,                       // 0x0200
+            CPU::INS_JMP_ABS, 0x00, 0x02,       // 0x0201
+            0xFF,                               // 0x0204
+        };
+        for (u32 i = 0; i < sizeof(program); i++)
+        {
+            mem[0x0200 + i] = program[i];
+        }
+        cpu.reset(0x0200);
+    }
+
+    static bool x_reached_three(void* context, const CPU& cpu)
+    {
+        (*(u32*)context)++;
+        return cpu.X == 3;
+    }
+};
+
+TEST_F(RunUntilTests, Breakpoints)
+{
+    Breakpoints breakpoints;
+    EXPECT_TRUE(breakpoints.empty());
+    breakpoints.add(0x0201);
+    breakpoints.add(0x0201);
+    breakpoints.add(0xFFFF);
+    EXPECT_EQ(breakpoints.size(), 2u);
+    EXPECT_TRUE(breakpoints.contains(0x0201));
+    EXPECT_FALSE(breakpoints.contains(0x0200));
+    EXPECT_TRUE(breakpoints.contains(0xFFFF));
+
+    breakpoints.remove(0xFFFF);
+    breakpoints.remove(0x1234);
+    EXPECT_EQ(breakpoints.size(), 1u);
+    EXPECT_FALSE(breakpoints.contains(0xFFFF));
+
+    breakpoints.clear();
+    EXPECT_TRUE(breakpoints.empty());
+    EXPECT_FALSE(breakpoints.contains(0x0201));
+}
+
+TEST_F(RunUntilTests, StopsOnBreakpoint)
+{
+    Breakpoints breakpoints;
+    breakpoints.add(0x0201);
+
+    ExecuteResult result = cpu.run_until(1000, breakpoints);
+    EXPECT_EQ(result.reason, StopReason::BREAKPOINT);
+    EXPECT_EQ(result.cycles, 2);
+    EXPECT_EQ(result.PC, 0x0201);
+    EXPECT_EQ(result.opcode, CPU::INS_JMP_ABS);
+    EXPECT_EQ(cpu.X, 1);
+
+    // a run starting on the breakpoint goes past it
+    result = cpu.run_until(1000, breakpoints);
+    EXPECT_EQ(result.reason, StopReason::BREAKPOINT);
+    EXPECT_EQ(result.cycles, 3 + 2);
+    EXPECT_EQ(cpu.PC, 0x0201);
+    EXPECT_EQ(cpu.X, 2);
+
+    // the budget still applies
+    result = cpu.run_until(3, breakpoints);
+    EXPECT_EQ(result.reason, StopReason::BUDGET);
+    EXPECT_EQ(cpu.PC, 0x0200);
+}
+
+TEST_F(RunUntilTests, EmptySetRunsLikeExecute)
+{
+    Breakpoints breakpoints;
+    ExecuteResult result = cpu.run_until(5 * 10, breakpoints);
+    EXPECT_EQ(result.reason, StopReason::BUDGET);
+    EXPECT_EQ(result.cycles, 5 * 10);
+    EXPECT_EQ(cpu.X, 10);
+
+    result = cpu.run_until(5 * 10, RunUntil());
+    EXPECT_EQ(result.reason, StopReason::BUDGET);
+    EXPECT_EQ(cpu.X, 20);
+}
+
+TEST_F(RunUntilTests, InstructionLimit)
+{
+    RunUntil until;
+    until.instructions = 5;
+    ExecuteResult result = cpu.run_until(1000, until);
+    EXPECT_EQ(result.reason, StopReason::INSTRUCTION_LIMIT);
+    EXPECT_EQ(result.cycles, 2 + 3 + 2 + 3 + 2);
+    EXPECT_EQ(cpu.X, 3);
+    EXPECT_EQ(cpu.PC, 0x0201);
+
+    // whichever condition is met first
+    Breakpoints breakpoints;
+    breakpoints.add(0x0200);
+    until.breakpoints = &breakpoints;
+    result = cpu.run_until(1000, until);
+    EXPECT_EQ(result.reason, StopReason::BREAKPOINT);
+    EXPECT_EQ(result.cycles, 3);
+}
+
+TEST_F(RunUntilTests, Predicate)
+{
+    u32 calls = 0;
+    RunUntil until;
+    until.predicate = &RunUntilTests::x_reached_three;
+    until.context = &calls;
+
+    ExecuteResult result = cpu.run_until(1000, until);
+    EXPECT_EQ(result.reason, StopReason::PREDICATE);
+    EXPECT_EQ(cpu.X, 3);
+    EXPECT_EQ(cpu.PC, 0x0201);
+    EXPECT_EQ(calls, 5u);
+}
+
+TEST_F(RunUntilTests, UnknownInstructionOnBreakpoint)
+{
+    mem[0x0201] = CPU::INS_JMP_ABS;
+    mem[0x0202] = 0x04;
+    Breakpoints breakpoints;
+    breakpoints.add(0x0204);
+
+    ExecuteResult result = cpu.run_until(1000, breakpoints);
+    EXPECT_EQ(result.reason, StopReason::BREAKPOINT);
+    EXPECT_EQ(result.PC, 0x0204);
+
+    result = cpu.run_until(1000, breakpoints);
+    EXPECT_EQ(result.reason, StopReason::ILLEGAL_OPCODE);
+    EXPECT_EQ(result.cycles, 1);
+    EXPECT_EQ(result.PC, 0x0204);
+}
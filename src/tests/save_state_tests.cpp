@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "save_state.h"
+
+#include <vector>
+
+using namespace emulator6502;
+
+class SaveStateTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+    std::vector<byte> buffer;
+
+    SaveStateTests()
+        : cpu(CPU(mem)), buffer(MAX_STATE_SIZE)
+    {}
+
+    virtual void SetUp()
+    {
+        cpu.reset();
+        // LDA #$42, STA $0200, JMP $FF00
+        mem[0xFF00] = CPU::INS_LDA_IM;
+        mem[0xFF01] = 0x42;
+        mem[0xFF02] = CPU::INS_STA_ABS;
+        mem[0xFF03] = 0x00;
+        mem[0xFF04] = 0x02;
+        mem[0xFF05] = CPU::INS_JMP_ABS;
+        mem[0xFF06] = 0x00;
+        mem[0xFF07] = 0xFF;
+        cpu.PC = 0xFF00;
+        cpu.X = 0x12;
+        cpu.Y = 0x34;
+        cpu.SP = 0xF0;
+        cpu.flag.C = 1;
+        cpu.flag.V = 1;
+    }
+
+    void expect_same_registers(const CPU& other)
+    {
+        EXPECT_EQ(cpu.PC, other.PC);
+        EXPECT_EQ(cpu.SP, other.SP);
+        EXPECT_EQ(cpu.A, other.A);
+        EXPECT_EQ(cpu.X, other.X);
+        EXPECT_EQ(cpu.Y, other.Y);
+        EXPECT_EQ(cpu.PS, other.PS);
+    }
+
+    void roundtrip(StateEncoding encoding)
+    {
+        cpu.execute(5);
+        u32 size = save_state(cpu, mem, buffer.data(), (u32)buffer.size(), encoding);
+        ASSERT_GT(size, 0u);
+
+        Memory restored_mem;
+        restored_mem[0x1234] = 0x99; // must be cleared by the load
+        CPU restored(restored_mem);
+        restored.reset();
+        EXPECT_EQ(load_state(restored, restored_mem, buffer.data(), size), size);
+
+        expect_same_registers(restored);
+        EXPECT_EQ(memcmp(mem.data, restored_mem.data, Memory::MAX_MEMORY), 0);
+
+        // both continue identically, including the cycle overrun
+        s32 cycles = cpu.execute(7).cycles;
+        EXPECT_EQ(restored.execute(7).cycles, cycles);
+        expect_same_registers(restored);
+    }
+};
+
+TEST_F(SaveStateTests, FullRoundtrip)
+{
+    roundtrip(StateEncoding::FULL);
+}
+
+TEST_F(SaveStateTests, SparseRoundtrip)
+{
+    roundtrip(StateEncoding::SPARSE);
+}
+
+TEST_F(SaveStateTests, SparseStoresOnlyUsedPages)
+{
+    cpu.execute(6);
+    u32 size = save_state(cpu, mem, buffer.data(), (u32)buffer.size());
+    // code page and the page written by STA
+    EXPECT_EQ(size, STATE_HEADER_SIZE + Memory::PAGE_COUNT / 8 + 2 * Memory::PAGE_SIZE);
+
+    u32 full = save_state(cpu, mem, buffer.data(), (u32)buffer.size(), StateEncoding::FULL);
+    EXPECT_EQ(full, STATE_HEADER_SIZE + Memory::MAX_MEMORY);
+}
+
+TEST_F(SaveStateTests, SmallBufferFails)
+{
+    EXPECT_EQ(save_state(cpu, mem, buffer.data(), STATE_HEADER_SIZE, StateEncoding::SPARSE), 0u);
+    EXPECT_EQ(save_state(cpu, mem, buffer.data(), Memory::MAX_MEMORY, StateEncoding::FULL), 0u);
+}
+
+TEST_F(SaveStateTests, InvalidStateIsRejected)
+{
+    u32 size = save_state(cpu, mem, buffer.data(), (u32)buffer.size());
+    cpu.A = 0x77;
+
+    std::vector<byte> bad(buffer.begin(), buffer.begin() + size);
+    bad[0] = 'X';
+    EXPECT_EQ(load_state(cpu, mem, bad.data(), size), 0u);
+
+    bad = std::vector<byte>(buffer.begin(), buffer.begin() + size);
+    bad[4] = STATE_VERSION + 1;
+    EXPECT_EQ(load_state(cpu, mem, bad.data(), size), 0u);
+
+    EXPECT_EQ(load_state(cpu, mem, buffer.data(), size - 1), 0u);
+
+    // nothing was modified by the failed loads
+    EXPECT_EQ(cpu.A, 0x77);
+    EXPECT_EQ(mem[0xFF01], 0x42);
+}
+
+TEST_F(SaveStateTests, DiffMirrorsMemory)
+{
+    std::vector<byte> diff(MAX_DIFF_SIZE);
+    Memory mirror;
+
+    // the first diff holds every page
+    u32 size = save_diff(mem, diff.data(), (u32)diff.size());
+    EXPECT_EQ(size, MAX_DIFF_SIZE);
+    EXPECT_EQ(load_diff(mirror, diff.data(), size), size);
+
+    cpu.execute(6);
+    size = save_diff(mem, diff.data(), (u32)diff.size());
+    EXPECT_EQ(load_diff(mirror, diff.data(), size), size);
+    EXPECT_EQ(memcmp(mem.data, mirror.data, Memory::MAX_MEMORY), 0);
+    if (!Memory::TRACK_DIRTY_PAGES) return;
+
+    // only the page written by STA
+    EXPECT_EQ(size, 2 + 1 + Memory::PAGE_SIZE);
+    EXPECT_EQ(diff[2], 0x02);
+    EXPECT_EQ(save_diff(mem, diff.data(), (u32)diff.size()), 2u);
+}
+
+TEST_F(SaveStateTests, DiffThatDoesNotFitKeepsPages)
+{
+    if (!Memory::TRACK_DIRTY_PAGES) GTEST_SKIP();
+    std::vector<byte> diff(MAX_DIFF_SIZE);
+    save_diff(mem, diff.data(), (u32)diff.size());
+
+    mem.write(0x3000, 0x01);
+    EXPECT_EQ(save_diff(mem, diff.data(), Memory::PAGE_SIZE), 0u);
+    EXPECT_EQ(save_diff(mem, diff.data(), (u32)diff.size()), 2 + 1 + Memory::PAGE_SIZE);
+}
+
+TEST_F(SaveStateTests, DiffAcrossBaselines)
+{
+    if (!Memory::TRACK_DIRTY_PAGES) GTEST_SKIP();
+    std::vector<byte> diff(MAX_DIFF_SIZE);
+    Memory mirror;
+    mirror.load(0, mem.data, Memory::MAX_MEMORY);
+    save_diff(mem, diff.data(), (u32)diff.size());
+
+    // written before the baseline and not sent yet
+    mem.write(0x3000, 0x01);
+    mem.save_baseline();
+    u32 size = save_diff(mem, diff.data(), (u32)diff.size());
+    EXPECT_EQ(size, 2 + 1 + Memory::PAGE_SIZE);
+    load_diff(mirror, diff.data(), size);
+
+    // sent after the baseline, then copied back by restoring it
+    mem.write(0x3000, 0x02);
+    size = save_diff(mem, diff.data(), (u32)diff.size());
+    load_diff(mirror, diff.data(), size);
+    mem.restore_baseline();
+    size = save_diff(mem, diff.data(), (u32)diff.size());
+    EXPECT_EQ(size, 2 + 1 + Memory::PAGE_SIZE);
+    load_diff(mirror, diff.data(), size);
+    EXPECT_EQ(mirror[0x3000], 0x01);
+    EXPECT_EQ(memcmp(mem.data, mirror.data, Memory::MAX_MEMORY), 0);
+}
+
+TEST_F(SaveStateTests, InvalidDiffIsRejected)
+{
+    const byte short_diff[] = { 0x01, 0x00, 0x02 };
+    EXPECT_EQ(load_diff(mem, short_diff, sizeof(short_diff)), 0u);
+    const byte too_many[] = { 0x01, 0x01 };
+    EXPECT_EQ(load_diff(mem, too_many, sizeof(too_many)), 0u);
+}
@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+
+using namespace emulator6502;
+
+class ShiftIncrementTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    ShiftIncrementTests()
+        : cpu(CPU(mem))
+    {}
+
+    virtual void SetUp()
+    {
+        cpu.reset();
+    }
+
+    // runs a read-modify-write instruction on 0x0042 in each of its memory modes
+    void test_modify(byte zp, byte zpx, byte abs, byte ax, byte value, byte ps, byte expected, byte expected_ps)
+    {
+        struct Case { byte opcode; s32 cycles; };
+        const Case cases[] = { { zp, 5 }, { zpx, 6 }, { abs, 6 }, { ax, 7 } };
+        for (const Case& c : cases)
+        {
+            cpu.reset();
+            mem.init();
+            cpu.PS = ps;
+            cpu.X = 0x02;
+            const bool indexed = c.opcode == zpx || c.opcode == ax;
+            mem[0xFFFC] = c.opcode;
+            mem.write_word(indexed ? 0x0040 : 0x0042, 0xFFFD);
+            mem[0x0042] = value;
+            EXPECT_EQ(cpu.execute(c.cycles).cycles, c.cycles) << "opcode " << (u32)c.opcode;
+            EXPECT_EQ(mem[0x0042], expected) << "opcode " << (u32)c.opcode;
+            EXPECT_EQ(cpu.PS, expected_ps) << "opcode " << (u32)c.opcode;
+        }
+    }
+
+    void test_accumulator(byte opcode, byte value, byte ps, byte expected, byte expected_ps)
+    {
+        cpu.reset();
+        cpu.A = value;
+        cpu.PS = ps;
+        mem[0xFFFC] = opcode;
+        EXPECT_EQ(cpu.execute(2).cycles, 2);
+        EXPECT_EQ(cpu.A, expected);
+        EXPECT_EQ(cpu.PS, expected_ps);
+    }
+};
+
+TEST_F(ShiftIncrementTests, ASL)
+{
+    test_accumulator(CPU::INS_ASL_A, 0x81, 0x00, 0x02, FLAG_C);
+    test_accumulator(CPU::INS_ASL_A, 0x40, FLAG_C, 0x80, FLAG_N);
+    test_modify(CPU::INS_ASL_ZP, CPU::INS_ASL_ZPX, CPU::INS_ASL_ABS, CPU::INS_ASL_AX, 0x80, 0x00, 0x00, FLAG_C | FLAG_Z);
+}
+
+TEST_F(ShiftIncrementTests, LSR)
+{
+    test_accumulator(CPU::INS_LSR_A, 0x81, FLAG_N, 0x40, FLAG_C);
+    test_modify(CPU::INS_LSR_ZP, CPU::INS_LSR_ZPX, CPU::INS_LSR_ABS, CPU::INS_LSR_AX, 0x01, 0x00, 0x00, FLAG_C | FLAG_Z);
+}
+
+TEST_F(ShiftIncrementTests, ROL)
+{
+    test_accumulator(CPU::INS_ROL_A, 0x80, FLAG_C, 0x01, FLAG_C);
+    test_modify(CPU::INS_ROL_ZP, CPU::INS_ROL_ZPX, CPU::INS_ROL_ABS, CPU::INS_ROL_AX, 0x40, 0x00, 0x80, FLAG_N);
+}
+
+TEST_F(ShiftIncrementTests, ROR)
+{
+    test_accumulator(CPU::INS_ROR_A, 0x01, FLAG_C, 0x80, FLAG_C | FLAG_N);
+    test_modify(CPU::INS_ROR_ZP, CPU::INS_ROR_ZPX, CPU::INS_ROR_ABS, CPU::INS_ROR_AX, 0x01, 0x00, 0x00, FLAG_C | FLAG_Z);
+}
+
+TEST_F(ShiftIncrementTests, INC_DEC)
+{
+    test_modify(CPU::INS_INC_ZP, CPU::INS_INC_ZPX, CPU::INS_INC_ABS, CPU::INS_INC_AX, 0xFF, FLAG_C, 0x00, FLAG_C | FLAG_Z);
+    test_modify(CPU::INS_INC_ZP, CPU::INS_INC_ZPX, CPU::INS_INC_ABS, CPU::INS_INC_AX, 0x7F, 0x00, 0x80, FLAG_N);
+    test_modify(CPU::INS_DEC_ZP, CPU::INS_DEC_ZPX, CPU::INS_DEC_ABS, CPU::INS_DEC_AX, 0x00, 0x00, 0xFF, FLAG_N);
+    test_modify(CPU::INS_DEC_ZP, CPU::INS_DEC_ZPX, CPU::INS_DEC_ABS, CPU::INS_DEC_AX, 0x01, FLAG_V, 0x00, FLAG_V | FLAG_Z);
+}
+
+TEST_F(ShiftIncrementTests, INX_INY_DEX_DEY)
+{
+    const byte program[] = { CPU::INS_INX, CPU::INS_INY, CPU::INS_INY, CPU::INS_DEX, CPU::INS_DEX, CPU::INS_DEY };
+    cpu.reset(0x0200);
+    for (u32 i = 0; i < sizeof(program); i++)
+    {
+        mem[0x0200 + i] = program[i];
+    }
+
+    EXPECT_EQ(cpu.execute(6).cycles, 6);
+    EXPECT_EQ(cpu.X, 0x01);
+    EXPECT_EQ(cpu.Y, 0x02);
+    EXPECT_EQ(cpu.PS, 0x00);
+
+    EXPECT_EQ(cpu.execute(4).cycles, 4);
+    EXPECT_EQ(cpu.X, 0xFF);
+    EXPECT_EQ(cpu.PS, FLAG_N);
+
+    EXPECT_EQ(cpu.execute(2).cycles, 2);
+    EXPECT_EQ(cpu.Y, 0x01);
+    EXPECT_EQ(cpu.PS, 0x00);
+}
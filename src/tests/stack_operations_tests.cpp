@@ -29,7 +29,7 @@ TEST_F(StackOperationsTests, TSX)
 {
     cpu.SP = 0xF1;
     mem[0xFFFC] = CPU::INS_TSX;
-    auto cycles_used = cpu.execute(2);
+    auto cycles_used = cpu.execute(2).cycles;
     EXPECT_EQ(cycles_used, 2);
     EXPECT_EQ(cpu.X, cpu.SP);
 }
@@ -38,7 +38,7 @@ TEST_F(StackOperationsTests, TSX_ZERO_FLAG)
 {
     cpu.SP = 0x0;
     mem[0xFFFC] = CPU::INS_TSX;
-    auto cycles_used = cpu.execute(2);
+    auto cycles_used = cpu.execute(2).cycles;
     EXPECT_EQ(cycles_used, 2);
     EXPECT_EQ(cpu.X, cpu.SP);
     EXPECT_TRUE(cpu.flag.Z);
@@ -49,7 +49,7 @@ TEST_F(StackOperationsTests, TSX_NEG_FLAG)
 {
     cpu.SP = 0xFF;
     mem[0xFFFC] = CPU::INS_TSX;
-    auto cycles_used = cpu.execute(2);
+    auto cycles_used = cpu.execute(2).cycles;
     EXPECT_EQ(cycles_used, 2);
     EXPECT_EQ(cpu.X, cpu.SP);
     EXPECT_TRUE(cpu.flag.N);
@@ -60,7 +60,7 @@ TEST_F(StackOperationsTests, TXS)
 {
     cpu.X = 0xF1;
     mem[0xFFFC] = CPU::INS_TXS;
-    auto cycles_used = cpu.execute(2);
+    auto cycles_used = cpu.execute(2).cycles;
     EXPECT_EQ(cycles_used, 2);
     EXPECT_EQ(cpu.X, cpu.SP);
     flags_are_default();
@@ -70,7 +70,7 @@ TEST_F(StackOperationsTests, PHA)
 {
     mem[0xFFFC] = CPU::INS_PHA;
     cpu.A = 0x42;
-    auto cycles_used = cpu.execute(3);
+    auto cycles_used = cpu.execute(3).cycles;
     EXPECT_EQ(cycles_used, 3);
     EXPECT_EQ(cpu.A, mem[cpu.sp_to_address() + 1]);
     flags_are_default();
@@ -80,16 +80,18 @@ TEST_F(StackOperationsTests, PHP)
 {
     mem[0xFFFC] = CPU::INS_PHP;
     cpu.PS = 0x4C;
-    auto cycles_used = cpu.execute(3);
+    auto cycles_used = cpu.execute(3).cycles;
     EXPECT_EQ(cycles_used, 3);
-    EXPECT_EQ(mem[cpu.sp_to_address() + 1], cpu.PS);
+    // pushed with B and the unused bit set
+    EXPECT_EQ(mem[cpu.sp_to_address() + 1], cpu.PS | 0x30);
 }
 
 TEST_F(StackOperationsTests, PLA)
 {
     mem[0xFFFC] = CPU::INS_PLA;
+    cpu.SP = 0xFE;
     mem[0x01FF] = 0x42;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cycles_used, 4);
     EXPECT_EQ(cpu.A, 0x42);
 }
@@ -97,8 +99,9 @@ TEST_F(StackOperationsTests, PLA)
 TEST_F(StackOperationsTests, PLA_ZERO_FLAG)
 {
     mem[0xFFFC] = CPU::INS_PLA;
+    cpu.SP = 0xFE;
     mem[0x01FF] = 0x0;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cycles_used, 4);
     EXPECT_EQ(cpu.A, 0x0);
     EXPECT_TRUE(cpu.flag.Z);
@@ -108,8 +111,9 @@ TEST_F(StackOperationsTests, PLA_ZERO_FLAG)
 TEST_F(StackOperationsTests, PLA_NEG_FLAG)
 {
     mem[0xFFFC] = CPU::INS_PLA;
+    cpu.SP = 0xFE;
     mem[0x01FF] = 0xFF;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cycles_used, 4);
     EXPECT_EQ(cpu.A, 0xFF);
     EXPECT_TRUE(cpu.flag.N);
@@ -119,8 +123,26 @@ TEST_F(StackOperationsTests, PLA_NEG_FLAG)
 TEST_F(StackOperationsTests, PLP)
 {
     mem[0xFFFC] = CPU::INS_PLP;
+    cpu.SP = 0xFE;
     mem[0x01FF] = 0xF4;
-    auto cycles_used = cpu.execute(4);
+    auto cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(cycles_used, 4);
     EXPECT_EQ(cpu.PS, 0xF4);
-}
\ No newline at end of file
+}
+
+TEST_F(StackOperationsTests, PHA_PLA_WRAP)
+{
+    // the stack wraps within page 1
+    cpu.reset(0x0200);
+    cpu.SP = 0x00;
+    cpu.A = 0x42;
+    mem[0x0200] = CPU::INS_PHA;
+    mem[0x0201] = CPU::INS_LDA_IM;
+    mem[0x0202] = 0x00;
+    mem[0x0203] = CPU::INS_PLA;
+    auto cycles_used = cpu.execute(3 + 2 + 4).cycles;
+    EXPECT_EQ(cycles_used, 9);
+    EXPECT_EQ(mem[0x0100], 0x42);
+    EXPECT_EQ(cpu.A, 0x42);
+    EXPECT_EQ(cpu.SP, 0x00);
+}
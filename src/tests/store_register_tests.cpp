@@ -39,7 +39,7 @@ void StoreRegisterTests::test_store_register_zp(byte opcode, byte CPU::*reg)
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = 0x0F;
     cpu.*reg = 0x12;
-    s32 cycles_used = cpu.execute(3);
+    s32 cycles_used = cpu.execute(3).cycles;
     EXPECT_EQ(mem[0x0F], cpu.*reg);
     EXPECT_EQ(cycles_used, 3);
     flags_are_default();
@@ -51,7 +51,7 @@ void StoreRegisterTests::test_store_register_zp_(byte opcode, byte CPU::*store,
     mem[0xFFFD] = 0x0F;
     cpu.*store = 0x12;
     cpu.*offset = 0x01;
-    s32 cycles_used = cpu.execute(4);
+    s32 cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(mem[0x10], cpu.*store);
     EXPECT_EQ(cycles_used, 4);
     flags_are_default();
@@ -62,7 +62,7 @@ void StoreRegisterTests::test_store_register_abs(byte opcode, byte CPU::*reg)
     mem[0xFFFC] = opcode;
     mem.write_word(0xFF10, 0xFFFD);
     cpu.*reg = 0x12;
-    s32 cycles_used = cpu.execute(4);
+    s32 cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(mem[0xFF10], cpu.*reg);
     EXPECT_EQ(cycles_used, 4);
     flags_are_default();
@@ -74,7 +74,7 @@ void StoreRegisterTests::test_store_register_abs_(byte opcode, byte CPU::*store,
     mem.write_word(0xFF10, 0xFFFD);
     cpu.*store = 0x12;
     cpu.*offset = 0x1;
-    s32 cycles_used = cpu.execute(4);
+    s32 cycles_used = cpu.execute(4).cycles;
     EXPECT_EQ(mem[0xFF11], cpu.*store);
     EXPECT_EQ(cycles_used, 5);
     flags_are_default();
@@ -84,10 +84,12 @@ void StoreRegisterTests::test_store_register_i_(byte opcode, byte CPU::*store, b
 {
     mem[0xFFFC] = opcode;
     mem[0xFFFD] = 0x02;
-    mem.write_word(0x8000, 0x0003);
+    // (zp,X) reads its pointer at zp + X, (zp),Y adds Y to the pointer at zp
+    if (offset == &CPU::X) mem.write_word(0x8000, 0x0003);
+    else mem.write_word(0x7FFF, 0x0002);
     cpu.*store = 0x4;
     cpu.*offset = 0x1;
-    auto cycles_used = cpu.execute(6);
+    auto cycles_used = cpu.execute(6).cycles;
     EXPECT_EQ(mem[0x8000], 0x4);
     EXPECT_EQ(cycles_used, 6);
     flags_are_default();
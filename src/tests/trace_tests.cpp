@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "trace.h"
+
+using namespace emulator6502;
+
+class TraceTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    TraceTests()
+        : cpu(CPU(mem))
+    {}
+
+    virtual void SetUp()
+    {
+        cpu.reset(0x0200);
+        // LDA #$42, LDX $10, JMP $0200
+        mem[0x0200] = CPU::INS_LDA_IM;
+        mem[0x0201] = 0x42;
+        mem[0x0202] = CPU::INS_LDX_ZP;
+        mem[0x0203] = 0x10;
+        mem[0x0204] = CPU::INS_JMP_ABS;
+        mem[0x0205] = 0x00;
+        mem[0x0206] = 0x02;
+        mem[0x0010] = 0x80;
+    }
+};
+
+TEST_F(TraceTests, CapacityIsPowerOfTwo)
+{
+    EXPECT_EQ(TraceRing(5).capacity(), 8u);
+    EXPECT_EQ(TraceRing(64).capacity(), 64u);
+    EXPECT_EQ(TraceRing(0).capacity(), 1u);
+}
+
+TEST_F(TraceTests, RecordsStateBeforeEachInstruction)
+{
+    TraceRing trace(16);
+    s32 cycles = cpu.execute(8, trace).cycles;
+    EXPECT_EQ(cycles, 8);
+
+    ASSERT_EQ(trace.size(), 3u);
+    EXPECT_EQ(trace.total(), 3u);
+
+    EXPECT_EQ(trace[0].PC, 0x0200);
+    EXPECT_EQ(trace[0].opcode, CPU::INS_LDA_IM);
+    EXPECT_EQ(trace[0].operands[0], 0x42);
+    EXPECT_EQ(trace[0].A, 0x00);
+    EXPECT_EQ(trace[0].cycles, 8);
+
+    EXPECT_EQ(trace[1].PC, 0x0202);
+    EXPECT_EQ(trace[1].A, 0x42);
+    EXPECT_EQ(trace[1].cycles, 6);
+
+    EXPECT_EQ(trace[2].PC, 0x0204);
+    EXPECT_EQ(trace[2].opcode, CPU::INS_JMP_ABS);
+    EXPECT_EQ(trace[2].operands[0], 0x00);
+    EXPECT_EQ(trace[2].operands[1], 0x02);
+    EXPECT_EQ(trace[2].X, 0x80);
+    EXPECT_EQ(trace[2].PS, cpu.PS);
+    EXPECT_EQ(trace[2].cycles, 3);
+}
+
+TEST_F(TraceTests, KeepsMostRecentRecords)
+{
+    TraceRing trace(4);
+    cpu.execute(8 * 10, trace);
+
+    EXPECT_EQ(trace.total(), 30u);
+    ASSERT_EQ(trace.size(), 4u);
+    // the last four instructions: JMP, LDA, LDX, JMP
+    EXPECT_EQ(trace[0].PC, 0x0204);
+    EXPECT_EQ(trace[1].PC, 0x0200);
+    EXPECT_EQ(trace[2].PC, 0x0202);
+    EXPECT_EQ(trace[3].PC, 0x0204);
+    EXPECT_EQ(trace[3].cycles, 3);
+
+    trace.clear();
+    EXPECT_EQ(trace.size(), 0u);
+}
+
+TEST_F(TraceTests, TracedRunMatchesUntraced)
+{
+    Memory other_mem = mem;
+    CPU other(other_mem);
+    other.reset(0x0200);
+
+    TraceRing trace;
+    EXPECT_EQ(cpu.execute(100, trace).cycles, other.execute(100).cycles);
+    EXPECT_EQ(cpu.PC, other.PC);
+    EXPECT_EQ(cpu.A, other.A);
+    EXPECT_EQ(cpu.X, other.X);
+    EXPECT_EQ(cpu.PS, other.PS);
+}
+
+TEST_F(TraceTests, CountsInstructions)
+{
+    InstructionCount count;
+    EXPECT_EQ(cpu.execute(8 * 10, count).cycles, 8 * 10);
+    EXPECT_EQ(count.count, 30u);
+
+    // counts add up across runs
+    cpu.execute(8, count);
+    EXPECT_EQ(count.count, 33u);
+}
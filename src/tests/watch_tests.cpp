@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+#include "m6502.h"
+#include "block_cache.h"
+
+#include <vector>
+
+using namespace emulator6502;
+
+class WatchTests : public testing::Test
+{
+public:
+    Memory mem;
+    CPU cpu;
+
+    WatchTests()
+        : cpu(CPU(mem))
+    {}
+
+    struct Hit
+    {
+        word address;
+        byte value;
+        bool write;
+    };
+    std::vector<Hit> hits;
+
+    static void record(void* context, word address, byte value, bool write)
+    {
+        static_cast<std::vector<Hit>*>(context)->push_back({ address, value, write });
+    }
+
+    void load(word address, const std::vector<byte>& program)
+    {
+        for (byte b : program)
+        {
+            mem[address++] = b;
+        }
+    }
+
+    // counts X down from 3 into the mailbox at 0x0400, then spins
+    void load_countdown()
+    {
+        load(0x0200, {
+            CPU::INS_LDX_IM,  0x03,             // 0x0200
+            CPU::INS_DEX,                       // 0x0202
+            CPU::INS_STX_ABS, 0x00, 0x04,       // 0x0203
+            CPU::INS_BNE,     0xFA,             // 0x0206
+            CPU::INS_JMP_ABS, 0x08, 0x02,       // 0x0208
+        });
+        mem[0x0400] = 0xFF;
+        cpu.reset(0x0200);
+    }
+};
+
+TEST_F(WatchTests, ObserverSeesWatchedAccesses)
+{
+    load(0x0200, {
+        CPU::INS_LDA_ABS, 0x00, 0x03,
+        CPU::INS_STA_ABS, 0x01, 0x03,
+        CPU::INS_LDX_IM,  0x07,
+        CPU::INS_STX_ABS, 0x00, 0x03,
+        CPU::INS_LDY_ABS, 0x02, 0x03,
+    });
+    mem[0x0300] = 0x42;
+    mem[0x0302] = 0x43;
+    mem.set_watch_observer(&WatchTests::record, &hits);
+    mem.watch(0x0300, true, true);
+    mem.watch(0x0302, false, true);
+    EXPECT_TRUE(mem.is_watched(0x0300, false));
+    EXPECT_FALSE(mem.is_watched(0x0302, false));
+    EXPECT_TRUE(mem.is_watched(0x0302, true));
+
+    cpu.reset(0x0200);
+    EXPECT_EQ(cpu.execute(4 + 4 + 2 + 4 + 4).reason, StopReason::BUDGET);
+
+    // unwatched addresses in a watched page read and write as usual
+    ASSERT_EQ(hits.size(), 2u);
+    EXPECT_EQ(hits[0].address, 0x0300);
+    EXPECT_EQ(hits[0].value, 0x42);
+    EXPECT_FALSE(hits[0].write);
+    EXPECT_EQ(hits[1].address, 0x0300);
+    EXPECT_EQ(hits[1].value, 0x07);
+    EXPECT_TRUE(hits[1].write);
+    EXPECT_EQ(mem[0x0301], 0x42);
+    EXPECT_EQ(mem[0x0300], 0x07);
+    EXPECT_EQ(cpu.Y, 0x43);
+}
+
+TEST_F(WatchTests, UnwatchRestoresPages)
+{
+    mem.watch(0x0300, true, false);
+    EXPECT_TRUE(mem.is_io_page(0x03));
+    mem.write(0x0300, 0x11);
+    EXPECT_EQ(mem.read(0x0300), 0x11);
+    EXPECT_EQ(mem.peek(0x0300), 0x11);
+
+    // mapping a watched page keeps it watched
+    byte rom[Memory::PAGE_SIZE] = { 0x99 };
+    mem.map_rom(0x03, 0x03, rom);
+    mem.write(0x0300, 0x22);
+    EXPECT_EQ(mem.read(0x0300), 0x99);
+    EXPECT_EQ(mem.peek(0x0300), 0x99);
+    EXPECT_TRUE(mem.is_io_page(0x03));
+
+    mem.unwatch(0x0300);
+    EXPECT_FALSE(mem.is_io_page(0x03));
+    EXPECT_EQ(mem.read(0x0300), 0x99);
+
+    mem.map_ram(0x03, 0x03);
+    mem.watch(0x0310, false, true);
+    EXPECT_FALSE(mem.is_io_page(0x03));
+    mem.clear_watches();
+    EXPECT_FALSE(mem.is_watched(0x0310, true));
+    mem.write(0x0310, 0x33);
+    EXPECT_EQ(mem[0x0310], 0x33);
+
+    // copies leave the watches behind
+    mem.watch(0x0300, true, true);
+    Memory copy = mem;
+    EXPECT_FALSE(copy.is_watched(0x0300, true));
+    EXPECT_FALSE(copy.is_io_page(0x03));
+    EXPECT_EQ(copy.read(0x0310), 0x33);
+}
+
+TEST_F(WatchTests, StopOnWatch)
+{
+    load_countdown();
+    mem.set_watch_observer(&CPU::stop_on_watch, &cpu);
+    mem.watch(0x0400, false, true);
+
+    // stops after the store, charging all of it. On the interpreter
+    // whatever the engine, StopOnWatchBlocks covers blocks and the JIT
+    ExecuteResult result = cpu.execute<CycleExact>(1000);
+    EXPECT_EQ(result.reason, StopReason::WATCHPOINT);
+    EXPECT_EQ(result.cycles, 2 + 2 + 4);
+    EXPECT_EQ(result.PC, 0x0206);
+    EXPECT_EQ(mem[0x0400], 0x02);
+
+    result = cpu.execute<CycleExact>(1000);
+    EXPECT_EQ(result.reason, StopReason::WATCHPOINT);
+    EXPECT_EQ(result.cycles, 3 + 2 + 4);
+    EXPECT_EQ(mem[0x0400], 0x01);
+
+    // a budget running out on the same instruction still reports the watch
+    result = cpu.execute<CycleExact>(3 + 2 + 1);
+    EXPECT_EQ(result.reason, StopReason::WATCHPOINT);
+    EXPECT_EQ(result.cycles, 3 + 2 + 4);
+    EXPECT_EQ(mem[0x0400], 0x00);
+}
+
+TEST_F(WatchTests, StopOnWatchBlocks)
+{
+    load_countdown();
+    mem.set_watch_observer(&CPU::stop_on_watch, &cpu);
+    mem.watch(0x0400, false, true);
+
+    BlockCache cache(mem);
+    ExecuteResult result = cpu.execute(1000, cache);
+    EXPECT_EQ(result.reason, StopReason::WATCHPOINT);
+    EXPECT_EQ(result.cycles, 2 + 2 + 4);
+    EXPECT_EQ(result.PC, 0x0206);
+
+#if M6502_HAS_JIT
+    // native blocks stop at their end, here after the branch back
+    load_countdown();
+    BlockCache jit_cache(mem);
+    ASSERT_TRUE(jit_cache.enable_jit(0));
+    result = cpu.execute(1000, jit_cache);
+    EXPECT_EQ(result.reason, StopReason::WATCHPOINT);
+    EXPECT_EQ(mem[0x0400], 0x02);
+    EXPECT_EQ(result.cycles, 2 + 2 + 4 + 3);
+    EXPECT_EQ(result.PC, 0x0202);
+    EXPECT_EQ(jit_cache.compiled_blocks(), 1u);
+#endif
+}
@@ -0,0 +1,74 @@
+#ifndef _H_TRACE
+#define _H_TRACE
+
+#include "m6502.h"
+
+#include <memory>
+
+namespace emulator6502 {
+
+    // CPU state at the start of one instruction
+    struct TraceRecord
+    {
+        word PC;
+        byte opcode;
+        byte operands[2]; // the two bytes after the opcode, used or not
+        byte A, X, Y, SP, PS;
+        s32 cycles; // cycles left before the instruction
+    };
+
+    /**
+     * Execution policies for the CPU dispatch loops. The loop calls
+     * next() once per instruction only when enabled is set, so NoTrace
+     * compiles to the untraced loop.
+    */
+    struct NoTrace
+    {
+        static constexpr bool enabled = false;
+    };
+
+    // counts the instructions run and records nothing else
+    struct InstructionCount
+    {
+        static constexpr bool enabled = true;
+        u64 count = 0;
+    };
+
+    /**
+     * Holds the most recent TraceRecords. Storage is allocated once by the
+     * constructor, recording only copies a record into the next slot.
+    */
+    class TraceRing
+    {
+    public:
+        static constexpr bool enabled = true;
+
+        // capacity is rounded up to a power of two
+        explicit TraceRing(u32 capacity = 4096)
+            : mask(std::bit_ceil(std::max(capacity, 1u)) - 1),
+              records(new TraceRecord[mask + 1])
+        {}
+
+        u32 capacity() const { return mask + 1; }
+        /** @return number of records held */
+        u32 size() const { return count < capacity() ? (u32)count : capacity(); }
+        /** @return number of records written since the last clear */
+        u64 total() const { return count; }
+        void clear() { count = 0; }
+
+        // 0 is the oldest record held, size() - 1 the most recent
+        const TraceRecord& operator[](u32 index) const
+        {
+            return records[(count - size() + index) & mask];
+        }
+
+        M6502_ALWAYS_INLINE TraceRecord& next() { return records[count++ & mask]; }
+
+    private:
+        u64 mask;
+        u64 count = 0;
+        std::unique_ptr<TraceRecord[]> records;
+    };
+}
+
+#endif